@@ -0,0 +1,76 @@
+/// @file batched.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Compares the throughput of one object per instance (array of
+/// structures) against a single batched object (structure of arrays).
+
+#include <symsolbin/simulation/analog_pair.hpp>
+#include <symsolbin/simulation/simulation.hpp>
+
+using namespace symsolbin;
+
+#include "double_rlc_aos.hpp"
+#include "double_rlc_soa.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/// @brief Returns the value of the i-th instance, so that the instances
+/// differ from each other.
+static inline double __spread(double value, std::size_t i)
+{
+    return value * (1.0 + 0.001 * static_cast<double>(i % 100));
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t instances = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 4096;
+    const std::size_t steps     = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000;
+
+    _system_timestep() = 1e-06;
+
+    // Array of structures.
+    std::vector<double_rlc_aos_t> aos(instances);
+    for (std::size_t i = 0; i < instances; ++i) {
+        aos[i].r0 = __spread(1e03, i), aos[i].c0 = __spread(1e-06, i), aos[i].l0 = __spread(1e-03, i);
+        aos[i].r1 = __spread(2e03, i), aos[i].c1 = __spread(2e-06, i), aos[i].l1 = __spread(2e-03, i);
+        aos[i].vin = 1.0;
+        aos[i].update_parameters();
+    }
+    // Structure of arrays.
+    double_rlc_soa_t soa(instances);
+    for (std::size_t i = 0; i < instances; ++i) {
+        soa.r0[i] = __spread(1e03, i), soa.c0[i] = __spread(1e-06, i), soa.l0[i] = __spread(1e-03, i);
+        soa.r1[i] = __spread(2e03, i), soa.c1[i] = __spread(2e-06, i), soa.l1[i] = __spread(2e-03, i);
+        soa.vin[i] = 1.0;
+    }
+    soa.update_parameters();
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t step = 0; step < steps; ++step)
+        for (auto &instance : aos)
+            instance.run();
+    std::chrono::duration<double> aos_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (std::size_t step = 0; step < steps; ++step)
+        soa.run_batch(instances);
+    std::chrono::duration<double> soa_time = std::chrono::steady_clock::now() - start;
+
+    // Check that both computed the same values.
+    double error = 0;
+    for (std::size_t i = 0; i < instances; ++i)
+        error = std::max(error, std::abs(aos[i].C1.pot - soa.C1_pot[i]));
+
+    const double points = static_cast<double>(instances * steps);
+    std::cout << "Instances        : " << instances << "\n";
+    std::cout << "Steps            : " << steps << "\n";
+    std::cout << "AoS (ns/step)    : " << 1e09 * aos_time.count() / points << "\n";
+    std::cout << "SoA (ns/step)    : " << 1e09 * soa_time.count() / points << "\n";
+    std::cout << "Speedup          : " << aos_time.count() / soa_time.count() << "\n";
+    std::cout << "Max difference   : " << error << "\n";
+    return 0;
+}
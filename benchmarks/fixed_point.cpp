@@ -0,0 +1,57 @@
+/// @file fixed_point.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Checks the accuracy of the fixed-point class against the double
+/// tape, and compares their speed.
+
+#include "double_rlc_model.hpp"
+
+#include <symsolbin/model/model_gen.hpp>
+#include <symsolbin/simulation/analog_pair.hpp>
+#include <symsolbin/simulation/fixed_point_accuracy.hpp>
+
+using namespace symsolbin;
+
+#include "double_rlc_fixed.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+int main(int argc, char *argv[])
+{
+    const std::size_t steps = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    double_rlc_model_t model;
+    model.run_solver();
+
+    tape_t reference = generate_tape(model);
+    if (!reference.valid())
+        return 1;
+    for (const auto &parameter : std::vector<std::pair<std::string, double>>{
+             { "r0", 1e03 }, { "c0", 1e-06 }, { "l0", 1e-03 }, { "r1", 2e03 }, { "c1", 2e-06 }, { "l1", 2e-03 } })
+        reference.set(parameter.first, parameter.second);
+
+    // A square wave, which excites the resonance of both stages.
+    auto stimulus = [](std::size_t step, std::map<std::string, double> &inputs) {
+        inputs["vin"] = ((step / 2000) % 2) ? -1.0 : 1.0;
+    };
+    double_rlc_fixed_t fixed;
+    auto start  = std::chrono::steady_clock::now();
+    auto errors = fixed_point_accuracy(fixed, reference, steps, stimulus);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Steps              : " << steps << "\n";
+    std::cout << "Elapsed (s)        : " << elapsed.count() << "\n";
+    std::cout << std::setw(12) << "Variable" << std::setw(6) << "Q" << std::setw(14) << "Max value"
+              << std::setw(14) << "Max error" << std::setw(14) << "Relative" << "\n";
+    int result = 0;
+    for (const auto &error : errors) {
+        std::cout << std::setw(12) << error.name << std::setw(6) << error.fraction << std::setw(14) << error.max_value
+                  << std::setw(14) << error.max_error << std::setw(14) << error.relative() << "\n";
+        // Flag the variables which lost more than one part in a thousand.
+        if ((error.max_value > 0) && (error.relative() > 1e-03))
+            result = 1;
+    }
+    return result;
+}
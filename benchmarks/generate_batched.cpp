@@ -0,0 +1,28 @@
+/// @file generate_batched.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Generates the classes compared by the batched benchmark.
+
+#include "double_rlc_model.hpp"
+
+#include <symsolbin/model/model_gen.hpp>
+
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <output directory>\n";
+        return 1;
+    }
+    std::string directory(argv[1]);
+
+    double_rlc_model_t model;
+    model.run_solver();
+
+    std::ofstream aos(directory + "/double_rlc_aos.hpp");
+    aos << symsolbin::generate_class(model, "double_rlc_aos_t");
+    std::ofstream soa(directory + "/double_rlc_soa.hpp");
+    soa << symsolbin::generate_class_batched(model, "double_rlc_soa_t", 4);
+    return (aos && soa) ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+/// @file generate_fixed_point.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Generates the fixed-point class checked by the accuracy benchmark.
+
+#include "double_rlc_model.hpp"
+
+#include <symsolbin/model/model_gen.hpp>
+#include <symsolbin/solver/ginac_helper.hpp>
+
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <output directory>\n";
+        return 1;
+    }
+    std::string directory(argv[1]);
+
+    double_rlc_model_t model;
+    model.run_solver();
+
+    // The parameters can change by a factor of two around their nominal
+    // value, the source swings between -1 and 1 volts.
+    model.r0.set_range(0.5e03, 2e03), model.c0.set_range(0.5e-06, 2e-06), model.l0.set_range(0.5e-03, 2e-03);
+    model.r1.set_range(1e03, 4e03), model.c1.set_range(1e-06, 4e-06), model.l1.set_range(1e-03, 4e-03);
+    model.vin.set_range(-1.0, 1.0);
+    symsolbin::ts.set_value(1e-06);
+
+    symsolbin::fixed_point_options_t options;
+    options.default_range = 4.0;
+    for (const auto &edge : model.get_structure().edges) {
+        options.ranges[edge.get_alias() + ".pot"] = { -4.0, 4.0 };
+        options.ranges[edge.get_alias() + ".flw"] = { -4e-03, 4e-03 };
+    }
+
+    std::string code = symsolbin::generate_fixed_point(model, "double_rlc_fixed_t", options);
+    if (code.empty())
+        return 1;
+    std::ofstream out(directory + "/double_rlc_fixed.hpp");
+    out << code;
+    return out ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+/// @file ladder_model.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief The RC ladder used by the solver benchmarks.
+
+#pragma once
+
+#include <symsolbin/solver/analog_model.hpp>
+
+#include <string>
+#include <vector>
+
+/// @brief A voltage source driving a chain of RC sections, where each
+/// section has its own resistance and capacitance. Every section adds four
+/// unknowns, so ten sections give a system of 42 unknowns.
+class ladder_model_t : public symsolbin::analog_model_t {
+public:
+    symsolbin::node_t gnd;
+    std::vector<symsolbin::node_t> nodes;
+    std::vector<symsolbin::edge_t> resistors, capacitors;
+    std::vector<symsolbin::value_t> r, c;
+    symsolbin::edge_t V0;
+    symsolbin::value_t vin;
+
+    explicit ladder_model_t(std::size_t sections)
+        : gnd("gnd", true),
+          nodes(),
+          resistors(),
+          capacitors(),
+          r(),
+          c(),
+          V0(gnd, symsolbin::node_t("n0"), "V0"),
+          vin("vin")
+    {
+        nodes.emplace_back("n0");
+        for (std::size_t i = 0; i < sections; ++i) {
+            const std::string index = std::to_string(i);
+            nodes.emplace_back("n" + std::to_string(i + 1));
+            resistors.emplace_back(nodes[i], nodes[i + 1], "R" + index);
+            capacitors.emplace_back(nodes[i + 1], gnd, "C" + index);
+            r.emplace_back("r" + index);
+            c.emplace_back("c" + index);
+        }
+    }
+
+    inline void setup() override
+    {
+        equations(P(V0) == vin);
+        unknowns(P(V0), F(V0));
+        for (std::size_t i = 0; i < resistors.size(); ++i) {
+            equations(P(resistors[i]) == r[i] * F(resistors[i]));
+            equations(P(capacitors[i]) == (1 / c[i]) * idt(F(capacitors[i])));
+            unknowns(P(resistors[i]), F(resistors[i]), P(capacitors[i]), F(capacitors[i]));
+            values(r[i], c[i]);
+        }
+        inputs(vin);
+    }
+};
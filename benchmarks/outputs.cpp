@@ -0,0 +1,91 @@
+/// @file outputs.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Shows how the solution shrinks when the model declares its
+/// outputs, on a voltage divider driving a buffered load.
+
+#include <symsolbin/solver/analog_model.hpp>
+
+#include <iostream>
+
+using namespace symsolbin;
+
+/// @brief A voltage divider, whose middle node drives an ideal buffer
+/// loaded by a resistor. The load does not affect the divider, so only the
+/// blocks up to the declared outputs have to be solved.
+class buffered_divider_t : public analog_model_t {
+public:
+    node_t gnd, in, mid, out;
+    edge_t V0, R0, R1, E0, R2;
+    value_t vin, r0, r1, g, r2;
+    /// The output of the model: 0 for none, 1 for the divider, 2 for the load.
+    int output;
+
+    explicit buffered_divider_t(int _output)
+        : gnd("gnd", true),
+          in("in"),
+          mid("mid"),
+          out("out"),
+          V0(gnd, in, "V0"),
+          R0(in, mid, "R0"),
+          R1(mid, gnd, "R1"),
+          E0(gnd, out, "E0"),
+          R2(out, gnd, "R2"),
+          vin("vin"),
+          r0("r0"),
+          r1("r1"),
+          g("g"),
+          r2("r2"),
+          output(_output)
+    {
+        // Nothing to do.
+    }
+
+    inline void setup() override
+    {
+        equations(
+            P(V0) == vin,
+            P(R0) == r0 * F(R0),
+            P(R1) == r1 * F(R1),
+            P(E0) == g * P(R1),
+            P(R2) == r2 * F(R2));
+        unknowns(
+            P(V0), F(V0),
+            P(R0), F(R0),
+            P(R1), F(R1),
+            P(E0), F(E0),
+            P(R2), F(R2));
+        values(r0, r1, g, r2);
+        inputs(vin);
+        if (output == 1)
+            outputs(P(R1));
+        else if (output == 2)
+            outputs(P(R2));
+    }
+};
+
+/// @brief Solves the model with the given output, and prints the equations
+/// of the solution.
+/// @return the number of equations of the solution.
+static inline std::size_t __measure(const char *name, int output)
+{
+    buffered_divider_t model(output);
+    model.run_solver();
+    const auto &equations = model.get_solution().equations;
+    std::cout << name << ": " << equations.size() << " equations\n";
+    for (const auto &equation : equations)
+        std::cout << "    " << equation << "\n";
+    return equations.size();
+}
+
+int main(int, char *[])
+{
+    const std::size_t all     = __measure("No outputs     ", 0);
+    const std::size_t divider = __measure("Divider output ", 1);
+    const std::size_t load    = __measure("Load output    ", 2);
+    // The divider reads only the source, the load also the buffer.
+    if ((divider >= load) || (load >= all)) {
+        std::cerr << "The outputs did not shrink the solution.\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+/// @file solve.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Compares the time taken by the solvers, and the size of the
+/// expressions they produce, on an RC ladder.
+
+#include "ladder_model.hpp"
+
+#include <symsolbin/solver/ginac_helper.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace symsolbin;
+
+/// @brief Counts the nodes of an expression.
+static inline std::size_t __size(const GiNaC::ex &e)
+{
+    std::size_t size = 1;
+    for (std::size_t i = 0; i < e.nops(); ++i)
+        size += __size(e.op(i));
+    return size;
+}
+
+/// @brief Solves a new ladder with the given options, and prints the time it
+/// took and the size of the solution.
+static inline void __measure(const char *name, std::size_t sections, const solver_options_t &options)
+{
+    ladder_model_t model(sections);
+    auto start = std::chrono::steady_clock::now();
+    model.run_solver(GiNaC::exmap(), options);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::size_t size                      = 0;
+    for (const auto &equation : model.get_solution().equations)
+        size += __size(equation.rhs());
+    std::cout << name << ": " << elapsed.count() << " s, " << size << " expression nodes\n";
+    for (const auto &choice : model.get_solution().choices) {
+        for (const auto &timing : choice.timings)
+            std::cout << "    " << algorithm_name(timing.first) << ": " << timing.second << " s\n";
+        if (options.tuning != solver_tuning_t::none)
+            std::cout << "    using " << algorithm_name(choice.algorithm) << (choice.remembered ? ", remembered" : "") << "\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t sections = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 10;
+    std::cout << "RC ladder with " << sections << " sections, " << (4 * sections + 2) << " unknowns.\n";
+
+    // The whole system at once, which is what the solvers are compared on.
+    solver_options_t options;
+    options.blt    = false;
+    options.method = solve_method_t::sparse;
+    __measure("Sparse fraction-free", sections, options);
+    options.method = solve_method_t::closed_form;
+    __measure("GiNaC::lsolve       ", sections, options);
+    // The second race finds the winner of the first one.
+    options.tuning        = solver_tuning_t::race;
+    options.tuning_budget = 60.0;
+    __measure("GiNaC::lsolve, race ", sections, options);
+    __measure("GiNaC::lsolve, again", sections, options);
+    return 0;
+}
@@ -0,0 +1,114 @@
+/// @file tape.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Compares the bytecode tape against the JIT-compiled model, and
+/// against the substitution of the values inside the GiNaC expressions.
+
+#include "double_rlc_model.hpp"
+
+#include <symsolbin/model/model_gen.hpp>
+#include <symsolbin/model/jit.hpp>
+#include <symsolbin/solver/ginac_helper.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace symsolbin;
+
+/// @brief The values of the parameters.
+static const std::vector<std::pair<std::string, double>> parameters = {
+    { "r0", 1e03 }, { "c0", 1e-06 }, { "l0", 1e-03 }, { "r1", 2e03 }, { "c1", 2e-06 }, { "l1", 2e-03 }, { "vin", 1.0 }
+};
+
+/// @brief Runs the steps, and returns the seconds per step.
+template <typename Step>
+static inline double __measure(std::size_t steps, Step step)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < steps; ++i)
+        step();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(steps);
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t steps = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const double timestep   = 1e-06;
+
+    double_rlc_model_t model;
+    model.run_solver();
+
+    // Bytecode tape.
+    tape_t tape = generate_tape(model);
+    if (!tape.valid())
+        return 1;
+    for (const auto &parameter : parameters)
+        tape.set(parameter.first, parameter.second);
+    tape.update_parameters();
+    double tape_time = __measure(steps, [&]() { tape.step(timestep); });
+
+    // JIT-compiled model.
+    jit_model_t jit = jit_compile(model);
+    double jit_time = 0;
+    if (jit.valid()) {
+        for (const auto &parameter : parameters)
+            jit.set(parameter.first, parameter.second);
+        jit.update_parameters();
+        jit_time = __measure(steps, [&]() { jit.step(timestep); });
+    }
+
+    // Substitution inside the GiNaC expressions, which is much slower, so
+    // it runs fewer steps.
+    auto solution = model.get_solution();
+    GiNaC::exmap values;
+    for (const auto &equation : solution.elimination)
+        values[equation.lhs()] = 0;
+    for (const auto &equation : solution.equations)
+        values[equation.lhs()] = 0;
+    for (const auto &equation : solution.support)
+        values[equation.lhs()] = 0;
+    values[model.r0.get_symbol()]  = 1e03;
+    values[model.c0.get_symbol()]  = 1e-06;
+    values[model.l0.get_symbol()]  = 1e-03;
+    values[model.r1.get_symbol()]  = 2e03;
+    values[model.c1.get_symbol()]  = 2e-06;
+    values[model.l1.get_symbol()]  = 2e-03;
+    values[model.vin.get_symbol()] = 1.0;
+    values[ts.get_symbol()]        = timestep;
+    auto evaluate = [&](const GiNaC::relational &equation) {
+        GiNaC::ex value = equation.rhs().subs(values).evalf();
+        values[equation.lhs()] = GiNaC::is_a<GiNaC::numeric>(value) ? value : GiNaC::ex(0);
+    };
+    double ginac_time = __measure(std::max<std::size_t>(steps / 1000, 1), [&]() {
+        for (const auto &equation : solution.elimination)
+            evaluate(equation);
+        for (const auto &equation : solution.equations)
+            evaluate(equation);
+        for (const auto &equation : solution.support)
+            evaluate(equation);
+    });
+
+    std::cout << "Steps              : " << steps << "\n";
+    std::cout << "Tape (ns/step)     : " << 1e09 * tape_time << "\n";
+    if (jit.valid()) {
+        std::cout << "JIT (ns/step)      : " << 1e09 * jit_time << "\n";
+        std::cout << "Tape / JIT         : " << tape_time / jit_time << "\n";
+        std::cout << "Max difference     : ";
+        double error = 0;
+        for (const auto &name : jit.variables())
+            error = std::max(error, std::abs(jit.get(name) - tape.get(name)));
+        std::cout << error << "\n";
+    }
+    std::cout << "GiNaC (ns/step)    : " << 1e09 * ginac_time << "\n";
+    std::cout << "GiNaC / Tape       : " << ginac_time / tape_time << "\n";
+    // The tape must be at least an order of magnitude faster than the
+    // substitution, or it is not worth having.
+    if (ginac_time < 10 * tape_time) {
+        std::cerr << "The tape is less than 10 times faster than GiNaC.\n";
+        return 1;
+    }
+    return 0;
+}
@@ -49,7 +49,8 @@ public:
             P(V0), F(V0),
             P(D0), F(D0),
             P(RL), F(RL));
-        values(vin, rd0, rl, phi, rf);
+        values(rd0, rl, phi, rf);
+        inputs(vin);
     }
 };
 
@@ -66,6 +67,7 @@ int main(int, char *[])
 }
 
 //==============================================================================
+
 #include <symsolbin/simulation/analog_pair.hpp>
 #include <symsolbin/simulation/simulation.hpp>
 
@@ -74,26 +76,51 @@ public:
     /// Analog edges.
     analog_pair_t D0, RL, V0;
     /// System variables.
-    analog_value_t vin, rd0, rl, phi, rf;
+    analog_value_t phi, rd0, rf, rl;
+    /// System inputs.
+    analog_value_t vin;
+    /// Coefficients which depend only on the system variables.
+    analog_value_t _kp0, _kp1, _kp2, _kp3, _kp4, _kp5;
+    /// If the coefficients must be computed before the next step.
+    bool _parameters_dirty;
     /// Constructor.
-    diode_t()
-        : D0(), RL(), V0(),
-          vin(), rd0(), rl(), phi(), rf()
+    diode_t() :
+        D0(), RL(), V0(),
+        phi(), rd0(), rf(), rl(),
+        vin(),
+        _kp0(), _kp1(), _kp2(), _kp3(), _kp4(), _kp5(),
+        _parameters_dirty(true)
     {
     }
-    void run()
-    {
+    /// Computes the coefficients which depend only on the system
+    /// variables, run() calls it before the first step, then it
+    /// must be called every time one of them changes.
+    void update_parameters() {
+        _kp0 = 1.0 / (rl + rf);
+        _kp1 = -(phi * _kp0);
+        _kp2 = phi * rl * _kp0;
+        _kp3 = rf * _kp0;
+        _kp4 = -_kp2;
+        _kp5 = rl * _kp0;
+        _parameters_dirty = false;
+    }
+    void run() {
         // Get the system timestep.
         analog_time_t ts = _system_timestep();
+        if (_parameters_dirty)
+            this->update_parameters();
         // Evaluate the analog values.
         V0.pot = vin;
+        // The generated code covers only the conducting diode, the blocking
+        // branch is written by hand.
         if (V0.pot > phi) {
-            V0.flw = -(phi + vin) / (rl + rf);
-            D0.pot = -1.0 / (rl + rf) * (vin * rf - rl * phi);
-            D0.flw = -(phi + vin) / (rl + rf);
-            RL.pot = -(phi + vin) * rl / (rl + rf);
-            RL.flw = -(phi + vin) / (rl + rf);
-        } else{
+            const analog_value_t t0 = _kp1 - vin * _kp0;
+            V0.flw = t0;
+            D0.pot = _kp2 - vin * _kp3;
+            D0.flw = t0;
+            RL.pot = _kp4 - vin * _kp5;
+            RL.flw = t0;
+        } else {
             V0.flw = 0;
             D0.pot = V0.pot;
             D0.flw = 0;
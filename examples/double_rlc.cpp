@@ -61,7 +61,8 @@ public:
             P(R1), F(R1),
             P(L1), F(L1),
             P(C1), F(C1));
-        values(r0, c0, l0, r1, c1, l1, vin);
+        values(r0, c0, l0, r1, c1, l1);
+        inputs(vin);
     }
 };
 
@@ -80,11 +81,14 @@ int main(int, char *[])
     std::cout << "\n";
     std::cout << model << "\n";
     std::cout << "\n";
-    std::cout << generate_class(model, "double_rlc_t") << "\n";
+    codegen_report_t report;
+    std::cout << generate_class(model, "double_rlc_t", codegen_options_t(), &report) << "\n";
+    std::cout << report << "\n";
     return 0;
 }
 
 //==============================================================================
+// Abridged, the coefficients and most of the statements are elided.
 
 #include <symsolbin/simulation/analog_pair.hpp>
 #include <symsolbin/simulation/simulation.hpp>
@@ -94,40 +98,60 @@ public:
     /// Analog edges.
     analog_pair_t C0, C1, L0, L1, R0, R1, V0;
     /// System variables.
-    analog_value_t r0, c0, l0, r1, c1, l1, vin;
+    analog_value_t c0, c1, l0, l1, r0, r1;
+    /// System inputs.
+    analog_value_t vin;
     /// Support variables.
-    analog_value_t idt0, ddt0, idt1, ddt1;
+    analog_value_t ddt0, ddt1, idt0, idt1;
+    /// Coefficients which depend only on the system variables.
+    analog_value_t _kp0; // ...
+    /// Coefficients which depend also on the timestep.
+    analog_value_t _kt0, _kt1, _kt2, _kt3, _kt4; // ...
+    /// The timestep used to compute the coefficients, negative if they must be computed.
+    analog_time_t _timestep;
+    /// If the coefficients must be computed before the next step.
+    bool _parameters_dirty;
     /// Constructor.
-    double_rlc_t()
-        : C0(), C1(), L0(), L1(), R0(), R1(), V0(),
-          r0(), c0(), l0(), r1(), c1(), l1(), vin(),
-          idt0(), ddt0(), idt1(), ddt1()
+    double_rlc_t() :
+        C0(), C1(), L0(), L1(), R0(), R1(), V0(),
+        c0(), c1(), l0(), l1(), r0(), r1(),
+        vin(),
+        ddt0(), ddt1(), idt0(), idt1(),
+        _kp0(),
+        _kt0(), _kt1(), _kt2(), _kt3(), _kt4(),
+        _timestep(-1.0),
+        _parameters_dirty(true)
     {
     }
-    void run()
-    {
+    /// Computes the coefficients which depend only on the system
+    /// variables, run() calls it before the first step, then it
+    /// must be called every time one of them changes.
+    void update_parameters() {
+        _kp0 = c0 * c1 * l0 * l1;
+        // ...
+        _parameters_dirty = false;
+        _timestep = -1.0;
+    }
+    /// Computes the coefficients which depend on the timestep.
+    void update_timestep(analog_time_t ts) {
+        // ...
+        _timestep = ts;
+    }
+    void run() {
         // Get the system timestep.
         analog_time_t ts = _system_timestep();
+        if (_parameters_dirty)
+            this->update_parameters();
+        if (ts != _timestep)
+            this->update_timestep(ts);
         // Evaluate the analog values.
         V0.pot = vin;
-        V0.flw = 1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (ddt1 * c1 * c0 * l1 * l0 + r1 * ddt1 * c1 * c0 * l0 * ts + r1 * c1 * c0 * ddt0 * l1 * ts - c0 * idt0 * l1 * ts - c1 * c0 * l1 * ts * vin - idt1 * c1 * l1 * ts - r1 * idt1 * c1 * (ts * ts) + c0 * ddt0 * l1 * (ts * ts) - r1 * c1 * c0 * (ts * ts) * vin - c0 * (ts * ts * ts) * vin + ddt1 * c0 * l0 * (ts * ts) - idt1 * (ts * ts * ts));
-        R0.pot = r0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (ddt1 * c1 * c0 * l1 * l0 + r1 * ddt1 * c1 * c0 * l0 * ts + r1 * c1 * c0 * ddt0 * l1 * ts - c0 * idt0 * l1 * ts - c1 * c0 * l1 * ts * vin - idt1 * c1 * l1 * ts - r1 * idt1 * c1 * (ts * ts) + c0 * ddt0 * l1 * (ts * ts) - r1 * c1 * c0 * (ts * ts) * vin - c0 * (ts * ts * ts) * vin + ddt1 * c0 * l0 * (ts * ts) - idt1 * (ts * ts * ts));
-        R0.flw = 1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (ddt1 * c1 * c0 * l1 * l0 + r1 * ddt1 * c1 * c0 * l0 * ts + r1 * c1 * c0 * ddt0 * l1 * ts - c0 * idt0 * l1 * ts - c1 * c0 * l1 * ts * vin - idt1 * c1 * l1 * ts - r1 * idt1 * c1 * (ts * ts) + c0 * ddt0 * l1 * (ts * ts) - r1 * c1 * c0 * (ts * ts) * vin - c0 * (ts * ts * ts) * vin + ddt1 * c0 * l0 * (ts * ts) - idt1 * (ts * ts * ts));
-        L0.pot = -1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (idt1 * l0 * (ts * ts) + ddt1 * r0 * c0 * l0 * (ts * ts) + c0 * l0 * (ts * ts) * vin + r1 * ddt1 * r0 * c1 * c0 * l0 * ts + idt1 * c1 * l1 * l0 - c0 * ddt0 * l1 * l0 * ts + r1 * c1 * c0 * l0 * ts * vin + ddt1 * c1 * l1 * l0 * ts + c0 * idt0 * l1 * l0 + r1 * ddt1 * c1 * c0 * l1 * l0 + r1 * idt1 * c1 * l0 * ts + ddt1 * r0 * c1 * c0 * l1 * l0 + ddt1 * c0 * l1 * l0 * ts + ddt1 * l0 * (ts * ts * ts) - r1 * c1 * c0 * ddt0 * l1 * l0 + c1 * c0 * l1 * l0 * vin + r1 * ddt1 * c1 * l0 * (ts * ts));
-        L0.flw = 1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (ddt1 * c1 * c0 * l1 * l0 + r1 * ddt1 * c1 * c0 * l0 * ts + r1 * c1 * c0 * ddt0 * l1 * ts - c0 * idt0 * l1 * ts - c1 * c0 * l1 * ts * vin - idt1 * c1 * l1 * ts - r1 * idt1 * c1 * (ts * ts) + c0 * ddt0 * l1 * (ts * ts) - r1 * c1 * c0 * (ts * ts) * vin - c0 * (ts * ts * ts) * vin + ddt1 * c0 * l0 * (ts * ts) - idt1 * (ts * ts * ts));
-        C0.pot = 1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (idt1 * l0 * (ts * ts) + r0 * idt1 * (ts * ts * ts) + r1 * r0 * idt1 * c1 * (ts * ts) + r0 * idt1 * c1 * l1 * ts + ddt0 * l1 * (ts * ts * ts) + idt1 * l1 * (ts * ts) - ((ts * ts) * (ts * ts)) * vin + idt1 * c1 * l1 * l0 + r1 * c1 * ddt0 * l1 * (ts * ts) - c1 * l1 * (ts * ts) * vin + ddt1 * c1 * l1 * l0 * ts - r1 * c1 * (ts * ts * ts) * vin + r1 * idt1 * c1 * l0 * ts + ddt1 * l0 * (ts * ts * ts) + r1 * idt1 * c1 * l1 * ts + r1 * ddt1 * c1 * l0 * (ts * ts) - idt0 * l1 * (ts * ts));
-        C0.flw = 1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (ddt1 * c1 * c0 * l1 * l0 + r1 * ddt1 * c1 * c0 * l0 * ts + r1 * c1 * c0 * ddt0 * l1 * ts - c0 * idt0 * l1 * ts - c1 * c0 * l1 * ts * vin - idt1 * c1 * l1 * ts - r1 * idt1 * c1 * (ts * ts) + c0 * ddt0 * l1 * (ts * ts) - r1 * c1 * c0 * (ts * ts) * vin - c0 * (ts * ts * ts) * vin + ddt1 * c0 * l0 * (ts * ts) - idt1 * (ts * ts * ts));
-        R1.pot = r1 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (ddt1 * c1 * c0 * l1 * l0 - c1 * ddt0 * l1 * (ts * ts) - c0 * idt0 * l0 * ts - idt0 * (ts * ts * ts) - c1 * c0 * ddt0 * l1 * l0 - c0 * idt0 * l1 * ts - c1 * c0 * l1 * ts * vin - idt1 * c1 * l1 * ts - r0 * c0 * idt0 * (ts * ts) - r0 * c1 * c0 * ddt0 * l1 * ts);
-        R1.flw = 1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (ddt1 * c1 * c0 * l1 * l0 - c1 * ddt0 * l1 * (ts * ts) - c0 * idt0 * l0 * ts - idt0 * (ts * ts * ts) - c1 * c0 * ddt0 * l1 * l0 - c0 * idt0 * l1 * ts - c1 * c0 * l1 * ts * vin - idt1 * c1 * l1 * ts - r0 * c0 * idt0 * (ts * ts) - r0 * c1 * c0 * ddt0 * l1 * ts);
-        L1.pot = -(ddt0 * l1 * (ts * ts * ts) + idt1 * l1 * (ts * ts) + c0 * ddt0 * l1 * l0 * ts + r1 * c1 * ddt0 * l1 * (ts * ts) + r0 * c0 * ddt0 * l1 * (ts * ts) - c0 * idt0 * l1 * l0 - r1 * ddt1 * c1 * c0 * l1 * l0 - ddt1 * c0 * l1 * l0 * ts + c0 * l1 * (ts * ts) * vin + r1 * c1 * c0 * ddt0 * l1 * l0 + r1 * idt1 * c1 * l1 * ts - r0 * c0 * idt0 * l1 * ts + r1 * c1 * c0 * l1 * ts * vin - idt0 * l1 * (ts * ts) + r1 * r0 * c1 * c0 * ddt0 * l1 * ts) / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts));
-        L1.flw = 1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (c1 * ddt0 * l1 * (ts * ts) + c0 * idt0 * l0 * ts + r1 * ddt1 * c1 * c0 * l0 * ts + r1 * c1 * c0 * ddt0 * l1 * ts + idt0 * (ts * ts * ts) + c1 * c0 * ddt0 * l1 * l0 - r1 * idt1 * c1 * (ts * ts) + r0 * c0 * idt0 * (ts * ts) + c0 * ddt0 * l1 * (ts * ts) - r1 * c1 * c0 * (ts * ts) * vin - c0 * (ts * ts * ts) * vin + ddt1 * c0 * l0 * (ts * ts) + r0 * c1 * c0 * ddt0 * l1 * ts - idt1 * (ts * ts * ts));
-        C1.pot = 1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (r1 * c0 * idt0 * l1 * ts - ddt0 * l1 * (ts * ts * ts) - idt1 * l1 * (ts * ts) - c0 * ddt0 * l1 * l0 * ts + r1 * c0 * idt0 * l0 * ts - r0 * c0 * ddt0 * l1 * (ts * ts) + c0 * idt0 * l1 * l0 + ddt1 * c0 * l1 * l0 * ts - c0 * l1 * (ts * ts) * vin + r1 * idt0 * (ts * ts * ts) + r0 * c0 * idt0 * l1 * ts + idt0 * l1 * (ts * ts) + r1 * r0 * c0 * idt0 * (ts * ts));
-        C1.flw = 1.0 / (c1 * c0 * l1 * l0 + r1 * r0 * c1 * c0 * (ts * ts) + ((ts * ts) * (ts * ts)) + r0 * c0 * (ts * ts * ts) + r0 * c1 * c0 * l1 * ts + r1 * c1 * c0 * l1 * ts + r1 * c1 * (ts * ts * ts) + c0 * l1 * (ts * ts) + c1 * l1 * (ts * ts) + r1 * c1 * c0 * l0 * ts + c0 * l0 * (ts * ts)) * (ddt1 * c1 * c0 * l1 * l0 - c1 * ddt0 * l1 * (ts * ts) - c0 * idt0 * l0 * ts - idt0 * (ts * ts * ts) - c1 * c0 * ddt0 * l1 * l0 - c0 * idt0 * l1 * ts - c1 * c0 * l1 * ts * vin - idt1 * c1 * l1 * ts - r0 * c0 * idt0 * (ts * ts) - r0 * c1 * c0 * ddt0 * l1 * ts);
+        const analog_value_t t0 = ddt0 * _kt0 + ddt1 * _kt1 + idt0 * _kt2 + idt1 * _kt3 - vin * _kt4;
+        V0.flw = t0;
+        // ...
         // Update support variables.
-        idt0 = C1.flw * ts;
-        ddt0 = 1.0 / ts * (L1.flw - ddt0);
-        idt1 = ts * C0.flw;
-        ddt1 = -1.0 / ts * (ddt1 - L0.flw);
+        idt0 = ts * C1.flw;
+        // ...
     }
 };
 // =============================================================================
@@ -47,7 +47,8 @@ public:
             P(V0), F(V0),
             P(M0), F(M0),
             P(RL), F(RL));
-        values(vin, G, rl);
+        values(rl);
+        inputs(vin, G);
     }
 };
 
@@ -75,7 +76,9 @@ public:
     /// Analog edges.
     analog_pair_t M0, RL, V0;
     /// System variables.
-    analog_value_t vin, G, rl;
+    analog_value_t rl;
+    /// System inputs.
+    analog_value_t G, vin;
 
     // Parameters.
     const analog_value_t Roff;
@@ -102,7 +105,8 @@ public:
     /// Constructor.
     memristor_t()
         : M0(), RL(), V0(),
-          vin(), G(), rl(),
+          rl(),
+          G(), vin(),
           Roff(16000),
           Ron(100),
           Rinit(11000),
@@ -121,6 +125,11 @@ public:
         w_last    = ((Roff - Rinit) / (Roff - Ron)) * D;
         time_last = 0;
     }
+    /// Computes the coefficients which depend only on the system
+    /// variables, run() calls it before the first step, then it
+    /// must be called every time one of them changes.
+    void update_parameters() {
+    }
 
     void run()
     {
@@ -157,11 +166,13 @@ public:
 
         // set the current.
         V0.pot = vin;
-        V0.flw = -vin / (rl * G + 1.0) * G;
-        M0.pot = -vin / (rl * G + 1.0);
-        M0.flw = -vin / (rl * G + 1.0) * G;
-        RL.pot = -rl * vin / (rl * G + 1.0) * G;
-        RL.flw = -vin / (rl * G + 1.0) * G;
+        const analog_value_t t0 = 1.0 / (rl * G + 1.0);
+        const analog_value_t t1 = -(vin * G * t0);
+        V0.flw = t1;
+        M0.pot = -(vin * t0);
+        M0.flw = t1;
+        RL.pot = -(rl * vin * G * t0);
+        RL.flw = t1;
 
         // persist variables
         w_last    = w;
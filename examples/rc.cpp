@@ -43,7 +43,8 @@ public:
             P(V0), F(V0),
             P(R0), F(R0),
             P(C0), F(C0));
-        values(vin, r0, c0);
+        values(r0, c0);
+        inputs(vin);
     }
 };
 
@@ -69,29 +70,66 @@ public:
     /// Analog edges.
     analog_pair_t C0, R0, V0;
     /// System variables.
-    analog_value_t vin, r0, c0;
+    analog_value_t c0, r0;
+    /// System inputs.
+    analog_value_t vin;
     /// Support variables.
     analog_value_t ddt0;
+    /// Coefficients which depend only on the system variables.
+    analog_value_t _kp0;
+    /// Coefficients which depend also on the timestep.
+    analog_value_t _kt0, _kt1, _kt2, _kt3;
+    /// The timestep used to compute the coefficients, negative if they must be computed.
+    analog_time_t _timestep;
+    /// If the coefficients must be computed before the next step.
+    bool _parameters_dirty;
     /// Constructor.
-    rc_t()
-        : C0(), R0(), V0(),
-          vin(), r0(), c0(),
-          ddt0()
+    rc_t() :
+        C0(), R0(), V0(),
+        c0(), r0(),
+        vin(),
+        ddt0(),
+        _kp0(),
+        _kt0(), _kt1(), _kt2(), _kt3(),
+        _timestep(-1.0),
+        _parameters_dirty(true)
     {
     }
-    void run()
-    {
+    /// Computes the coefficients which depend only on the system
+    /// variables, run() calls it before the first step, then it
+    /// must be called every time one of them changes.
+    void update_parameters() {
+        _kp0 = c0 * r0;
+        _parameters_dirty = false;
+        _timestep = -1.0;
+    }
+    /// Computes the coefficients which depend on the timestep.
+    void update_timestep(analog_time_t ts) {
+        const analog_value_t t0 = 1.0 / (_kp0 + ts);
+        _kt0 = c0 * t0;
+        _kt1 = _kp0 * t0;
+        _kt2 = ts * t0;
+        _kt3 = 1.0 / ts;
+        _timestep = ts;
+    }
+    void run() {
         // Get the system timestep.
         analog_time_t ts = _system_timestep();
+        if (_parameters_dirty)
+            this->update_parameters();
+        if (ts != _timestep)
+            this->update_timestep(ts);
         // Evaluate the analog values.
         V0.pot = vin;
-        V0.flw = -(vin + ddt0) * c0 / (r0 * c0 + ts);
-        R0.pot = -(vin + ddt0) * r0 * c0 / (r0 * c0 + ts);
-        R0.flw = -(vin + ddt0) * c0 / (r0 * c0 + ts);
-        C0.pot = (ddt0 * r0 * c0 - vin * ts) / (r0 * c0 + ts);
-        C0.flw = -(vin + ddt0) * c0 / (r0 * c0 + ts);
+        const analog_value_t t0 = -(vin * _kt0 + ddt0 * _kt0);
+        V0.flw = t0;
+        const analog_value_t t1 = ddt0 * _kt1;
+        R0.pot = -(vin * _kt1 + t1);
+        R0.flw = t0;
+        C0.pot = t1 - vin * _kt2;
+        C0.flw = t0;
         // Update support variables.
-        ddt0 = -(ddt0 - C0.pot) / ts;
+        ddt0 = C0.pot * _kt3 - ddt0 * _kt3;
     }
 };
 // =============================================================================
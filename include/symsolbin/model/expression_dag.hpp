@@ -0,0 +1,382 @@
+/// @file expression_dag.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Hash-consed expression DAG used between the solver and the emitters.
+
+#pragma once
+
+#include <ginac/ginac.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <map>
+#include <set>
+
+namespace symsolbin
+{
+
+/// @brief The operations supported by the expression DAG.
+enum class dag_op_t {
+    constant, ///< A numerical constant.
+    symbol,   ///< A read of a variable.
+    add,      ///< N-ary summation.
+    sub,      ///< Binary subtraction.
+    mul,      ///< N-ary multiplication.
+    div,      ///< Binary division.
+    neg,      ///< Unary negation.
+    pow,      ///< Power with an integer exponent.
+    call      ///< Call to a function (e.g., exp, log).
+};
+
+/// @brief What a node depends on, ordered from the least to the most
+/// frequently changing value.
+enum class dag_stage_t {
+    constant,  ///< Depends on nothing.
+    parameter, ///< Depends only on the parameters of the model.
+    timestep,  ///< Depends on the parameters and on the timestep.
+    state      ///< Depends on the state or on the inputs of the model.
+};
+
+/// @brief A node of the expression DAG.
+struct dag_node_t {
+    /// The operation.
+    dag_op_t op;
+    /// The operands of the operation.
+    std::vector<std::size_t> args;
+    /// The value of a constant, or the exponent of a power.
+    double value;
+    /// The name of a symbol, or the name of a called function.
+    std::string name;
+    /// The version of a symbol, incremented every time it is assigned.
+    unsigned version;
+    /// What the node depends on.
+    dag_stage_t stage;
+};
+
+/// @brief Static count of the operations needed to evaluate some code.
+struct cost_report_t {
+    /// Summations, subtractions and negations.
+    std::size_t adds = 0;
+    /// Multiplications.
+    std::size_t muls = 0;
+    /// Divisions.
+    std::size_t divs = 0;
+    /// Calls to transcendental (and other library) functions.
+    std::size_t calls = 0;
+
+    /// @brief Returns the total number of operations.
+    inline std::size_t total() const
+    {
+        return adds + muls + divs + calls;
+    }
+
+    /// @brief Accumulates the operations of another report.
+    inline cost_report_t &operator+=(const cost_report_t &other)
+    {
+        adds += other.adds;
+        muls += other.muls;
+        divs += other.divs;
+        calls += other.calls;
+        return *this;
+    }
+
+    /// @brief Stream operator for the report.
+    friend std::ostream &operator<<(std::ostream &lhs, const cost_report_t &rhs);
+};
+
+/// @brief An assignment of a DAG node to a variable.
+struct dag_statement_t {
+    /// The assigned variable.
+    std::string target;
+    /// The assigned node.
+    std::size_t node;
+};
+
+/// @brief Expression DAG where structurally identical subexpressions are
+/// stored only once (hash-consing).
+class expression_dag_t {
+public:
+    /// @brief Constructor.
+    expression_dag_t();
+
+    /// @brief Adds a numerical constant.
+    /// @param value the value of the constant.
+    /// @return the index of the node.
+    std::size_t constant(double value);
+
+    /// @brief Adds a read of a variable, at its current version.
+    /// @param name the name of the variable.
+    /// @return the index of the node.
+    std::size_t symbol(const std::string &name);
+
+    /// @brief Adds an operation, returning the existing node if an identical
+    /// one was already added.
+    /// @param op the operation.
+    /// @param args the operands.
+    /// @param value the exponent, only for powers.
+    /// @param name the name of the function, only for calls.
+    /// @return the index of the node.
+    std::size_t make(dag_op_t op, std::vector<std::size_t> args, double value = .0, const std::string &name = std::string());
+
+    /// @brief Lowers a GiNaC expression inside the DAG.
+    /// @param e the expression.
+    /// @return the index of the root node.
+    std::size_t lower(const GiNaC::ex &e);
+
+    /// @brief Appends the assignment `target = e` to the list of statements.
+    /// @details Reads of `target` lowered after this call refer to the
+    /// newly assigned value.
+    /// @param target the assigned variable.
+    /// @param e the assigned expression.
+    void assign(const std::string &target, const GiNaC::ex &e);
+
+    /// @brief Appends the assignment `target = node` to the list of statements.
+    /// @param target the assigned variable.
+    /// @param node the assigned node.
+    void assign(const std::string &target, std::size_t node);
+
+    /// @brief Makes the reads of `name` lowered after this call refer to the
+    /// value of `e`, without appending any statement, e.g., for the
+    /// intermediate values of an elimination.
+    /// @param name the name of the value.
+    /// @param e its expression.
+    void define(const std::string &name, const GiNaC::ex &e);
+
+    /// @brief Returns the nodes of the DAG.
+    inline const std::vector<dag_node_t> &nodes() const
+    {
+        return _nodes;
+    }
+
+    /// @brief Returns the statements, in evaluation order.
+    inline const std::vector<dag_statement_t> &statements() const
+    {
+        return _statements;
+    }
+
+    /// @brief Returns the variables read by the expression of a node.
+    /// @param node the node.
+    /// @return the names of the variables, sorted.
+    std::set<std::string> reads(std::size_t node) const;
+
+    /// @brief Returns the variables read or assigned by the statements.
+    std::set<std::string> variables() const;
+
+    /// @brief Returns the functions called by the reachable nodes.
+    std::set<std::string> functions() const;
+
+    /// @brief Removes the statements, the nodes they alone used stay inside
+    /// the DAG but are no longer reachable.
+    /// @param keep if each statement must be kept.
+    void keep_statements(const std::vector<bool> &keep);
+
+    /// @brief Counts how many times each node is referenced, either by other
+    /// reachable nodes or by statements.
+    std::vector<unsigned> count_uses() const;
+
+    /// @brief Returns the operations performed by a node alone, excluding
+    /// its operands.
+    cost_report_t operations(std::size_t node) const;
+
+    /// @brief Returns the operations needed to evaluate every statement as an
+    /// independent expression tree.
+    cost_report_t tree_cost() const;
+
+    /// @brief Returns the operations needed to evaluate every statement when
+    /// each reachable node is evaluated only once.
+    cost_report_t dag_cost() const;
+
+    /// @brief Sets what a variable depends on, to be called before lowering
+    /// any expression that reads it. Variables default to the state stage.
+    /// @param name the name of the variable.
+    /// @param stage its stage.
+    inline void set_stage(const std::string &name, dag_stage_t stage)
+    {
+        _stages[name] = stage;
+    }
+
+    /// @brief Returns what a node depends on.
+    inline dag_stage_t stage(std::size_t node) const
+    {
+        return _nodes[node].stage;
+    }
+
+    /// @brief Returns the nodes that are computed in an earlier stage but
+    /// read by a later one, or directly by a statement.
+    /// @param stage the stage producing the values.
+    /// @return the nodes, operands before their users.
+    std::vector<std::size_t> frontier(dag_stage_t stage) const;
+
+    /// @brief Enables the Horner form for the polynomials lowered from now on.
+    /// @param horner if polynomials should be rewritten in Horner form.
+    inline void set_horner(bool horner)
+    {
+        _horner = horner;
+    }
+
+    /// @brief Returns a copy of the DAG with cheaper operations:
+    ///  - integer powers become chains of repeated squaring, so that `x^2`
+    ///    is shared by `x^3` and `x^4`;
+    ///  - when a denominator is shared by several divisions, its reciprocal
+    ///    is computed once and the divisions become multiplications.
+    /// @return the new DAG.
+    expression_dag_t strength_reduce() const;
+
+private:
+    /// @brief The key used to find identical nodes.
+    using key_t = std::tuple<dag_op_t, std::vector<std::size_t>, double, std::string, unsigned>;
+
+    /// The nodes.
+    std::vector<dag_node_t> _nodes;
+    /// Index of the nodes, used for hash-consing.
+    std::map<key_t, std::size_t> _index;
+    /// The current version of each variable.
+    std::map<std::string, unsigned> _versions;
+    /// Already lowered GiNaC expressions, valid until the next assignment.
+    std::map<GiNaC::ex, std::size_t, GiNaC::ex_is_less> _lowered;
+    /// The statements.
+    std::vector<dag_statement_t> _statements;
+    /// The node of each defined value.
+    std::map<std::string, std::size_t> _definitions;
+    /// The stage of each variable.
+    std::map<std::string, dag_stage_t> _stages;
+    /// If polynomials are lowered in Horner form.
+    bool _horner;
+
+    /// @brief Adds a node, or returns the index of an identical one.
+    std::size_t __insert(dag_node_t node);
+
+    /// @brief Lowers a polynomial in Horner form with respect to a variable.
+    std::size_t __lower_horner(const GiNaC::ex &e, const GiNaC::ex &variable, int degree);
+
+    /// @brief Lowers a summation, grouping the terms by stage so that the
+    /// ones of the earlier stages are combined first, e.g., `(r0 + r1) + x`.
+    std::size_t __lower_add(const GiNaC::ex &e);
+
+    /// @brief Lowers a multiplication, grouping the factors by stage.
+    std::size_t __lower_mul(const GiNaC::ex &e);
+};
+
+/// @brief Prints the DAG as C++ statements, sharing common subexpressions
+/// through `const` temporaries.
+class dag_printer_t {
+public:
+    /// @brief Constructor.
+    /// @param dag the DAG to print.
+    /// @param cse if false, every expression is printed in full.
+    dag_printer_t(const expression_dag_t &dag, bool cse = true);
+
+    /// @brief Prints a statement, preceded by the temporaries it needs and
+    /// that have not been printed yet.
+    /// @param out the output stream.
+    /// @param statement the statement.
+    /// @param indent the indentation.
+    void print_statement(std::ostream &out, const dag_statement_t &statement, const std::string &indent);
+
+    /// @brief Prints the statement without storing its root inside a
+    /// temporary, the following reads of the root then refer to the target.
+    /// @param out the output stream.
+    /// @param statement the statement.
+    /// @param indent the indentation.
+    void print_binding(std::ostream &out, const dag_statement_t &statement, const std::string &indent);
+
+    /// @brief Makes the printer refer to a node with the given name, e.g.,
+    /// because it has been computed somewhere else.
+    /// @param node the node.
+    /// @param name the name of the variable holding its value.
+    inline void bind(std::size_t node, const std::string &name)
+    {
+        _temporaries[node] = name;
+        ++_bound;
+    }
+
+    /// @brief Makes the printer write a variable with another name, both
+    /// when it is read and when it is assigned, e.g., to index an array.
+    /// @param name the name of the variable inside the DAG.
+    /// @param replacement the printed name.
+    inline void rename(const std::string &name, const std::string &replacement)
+    {
+        _names[name] = replacement;
+    }
+
+    /// @brief Prints the code for a generic scalar type: temporaries and
+    /// constants get that type, and functions are called unqualified so that
+    /// the overloads of the type are found through argument-dependent lookup.
+    /// @param type the name of the type, e.g., `T`.
+    inline void set_scalar_type(const std::string &type)
+    {
+        _scalar = type;
+    }
+
+    /// @brief Prints C code: temporaries are `double`, and functions are
+    /// the ones of `math.h`.
+    inline void set_plain_c()
+    {
+        _c = true;
+    }
+
+    /// @brief Prints the using-declarations of the standard functions called
+    /// by the DAG, needed by the unqualified calls of a generic scalar type.
+    /// @param out the output stream.
+    /// @param indent the indentation.
+    void print_using(std::ostream &out, const std::string &indent) const;
+
+    /// @brief Prints the expression of a node.
+    /// @param node the node.
+    /// @return the C++ expression.
+    std::string print_expression(std::size_t node) const;
+
+    /// @brief Returns the number of temporaries printed so far.
+    inline std::size_t temporaries() const
+    {
+        return _temporaries.size() - _bound;
+    }
+
+    /// @brief Returns the operations printed so far.
+    inline const cost_report_t &cost() const
+    {
+        return _cost;
+    }
+
+private:
+    /// The DAG.
+    const expression_dag_t &_dag;
+    /// The number of uses of each node.
+    std::vector<unsigned> _uses;
+    /// If we are sharing subexpressions.
+    bool _cse;
+    /// The name of the temporaries printed so far, and of the bound nodes.
+    std::map<std::size_t, std::string> _temporaries;
+    /// The number of bound nodes.
+    std::size_t _bound;
+    /// The operations printed so far.
+    cost_report_t _cost;
+    /// The printed name of the renamed variables.
+    std::map<std::string, std::string> _names;
+    /// The generic scalar type, empty when printing analog_value_t.
+    std::string _scalar;
+    /// If we are printing C code.
+    bool _c;
+
+    /// @brief Returns the printed name of a variable.
+    std::string __print_name(const std::string &name) const;
+
+    /// @brief Returns the operations needed to print a node inline.
+    cost_report_t __inline_cost(std::size_t node) const;
+
+    /// @brief Checks if the node must be stored inside a temporary.
+    bool __is_shared(std::size_t node) const;
+
+    /// @brief Prints the temporaries required by the node.
+    void __print_temporaries(std::ostream &out, std::size_t node, const std::string &indent);
+
+    /// @brief Prints an operand, adding parenthesis when required.
+    std::string __print_operand(std::size_t node, int precedence, bool right) const;
+};
+
+/// @brief Prints a double as a C++ floating-point literal.
+/// @param value the value.
+/// @return the shortest literal that preserves the value.
+std::string print_double_literal(double value);
+
+} // namespace symsolbin
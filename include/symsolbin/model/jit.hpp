@@ -0,0 +1,157 @@
+/// @file jit.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Compiles the generated code into a shared object and loads it.
+
+#pragma once
+
+#include "symsolbin/solver/analog_model.hpp"
+#include "symsolbin/model/model_gen.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace symsolbin
+{
+
+/// @brief C-ABI function that advances the model by one step.
+/// @param instance the instance of the model.
+/// @param ts the timestep.
+using jit_step_t = void (*)(void *instance, double ts);
+
+/// @brief Options used to compile the generated code.
+struct jit_options_t {
+    /// The C++ compiler.
+    std::string compiler = "c++";
+    /// The compilation flags.
+    std::string flags = "-std=c++17 -O3";
+    /// The directory containing the `symsolbin/simulation` headers. If empty,
+    /// it is `$SYMSOLBIN_JIT_INCLUDE`, or the include directory of the source
+    /// tree the library was built from, or of its installation prefix, the
+    /// first one which contains the headers.
+    std::string include_directory;
+    /// The directory where the compiled objects are cached. If empty, it is
+    /// `$SYMSOLBIN_JIT_CACHE`, `$XDG_CACHE_HOME/symsolbin/jit`, or
+    /// `$HOME/.cache/symsolbin/jit`, in this order.
+    std::string cache_directory;
+    /// The options used to generate the code, parameters are always hoisted
+    /// so that the object exposes `update_parameters()`, and the class always
+    /// works with analog_value_t and keeps its variables as plain members.
+    codegen_options_t codegen;
+};
+
+/// @brief A compiled model, loaded from a shared object.
+class jit_model_t {
+public:
+    /// @brief Creates an invalid model.
+    jit_model_t();
+
+    /// @brief Destroys the instance and unloads the shared object.
+    ~jit_model_t();
+
+    jit_model_t(const jit_model_t &other) = delete;
+
+    jit_model_t &operator=(const jit_model_t &other) = delete;
+
+    /// @brief Move constructor.
+    jit_model_t(jit_model_t &&other) noexcept;
+
+    /// @brief Move assignment.
+    jit_model_t &operator=(jit_model_t &&other) noexcept;
+
+    /// @brief Checks if the model was compiled and loaded correctly.
+    inline bool valid() const
+    {
+        return _instance != nullptr;
+    }
+
+    /// @brief Advances the model by one step, does nothing if the model is
+    /// not valid.
+    /// @param ts the timestep.
+    inline void step(double ts)
+    {
+        if (this->valid())
+            _step(_instance, ts);
+    }
+
+    /// @brief Computes the coefficients which depend only on the system
+    /// variables, must be called every time one of them changes. Does
+    /// nothing if the model is not valid.
+    void update_parameters();
+
+    /// @brief Returns the C-ABI step function, to be called with instance().
+    /// Requires a valid() model.
+    inline jit_step_t step_function() const
+    {
+        return _step;
+    }
+
+    /// @brief Returns the instance of the model inside the shared object.
+    inline void *instance() const
+    {
+        return _instance;
+    }
+
+    /// @brief Returns a pointer to a variable of the model, e.g., `R0.pot`
+    /// or `vin`, which stays valid as long as the model exists.
+    /// @param name the name of the variable.
+    /// @return the pointer, or nullptr if there is no such variable.
+    double *variable(const std::string &name) const;
+
+    /// @brief Returns the value of a variable.
+    /// @param name the name of the variable.
+    /// @return the value, or zero if there is no such variable.
+    double get(const std::string &name) const;
+
+    /// @brief Sets the value of a variable.
+    /// @param name the name of the variable.
+    /// @param value the new value.
+    /// @return true if the variable exists, false otherwise.
+    bool set(const std::string &name, double value);
+
+    /// @brief Returns the names of the variables.
+    inline const std::vector<std::string> &variables() const
+    {
+        return _names;
+    }
+
+    /// @brief Returns the path of the loaded shared object.
+    inline const std::string &path() const
+    {
+        return _path;
+    }
+
+    friend jit_model_t jit_compile(const analog_model_t &model, const jit_options_t &options);
+
+private:
+    /// The handle returned by dlopen.
+    void *_library;
+    /// The instance of the model.
+    void *_instance;
+    /// Advances the instance.
+    jit_step_t _step;
+    /// Updates the coefficients of the instance.
+    void (*_update_parameters)(void *);
+    /// Destroys the instance.
+    void (*_destroy)(void *);
+    /// The names of the variables.
+    std::vector<std::string> _names;
+    /// The pointers to the variables.
+    std::map<std::string, double *> _variables;
+    /// The path of the shared object.
+    std::string _path;
+
+    /// @brief Destroys the instance and unloads the shared object.
+    void __release();
+};
+
+/// @brief Generates the code of the model, compiles it into a shared object
+/// and loads it. The object is cached on disk under the hash of the
+/// generated code, so the compiler runs only when the code changes.
+/// @param model the solved analog model.
+/// @param options the compilation options.
+/// @return the loaded model, which is not valid if something failed.
+jit_model_t jit_compile(const analog_model_t &model, const jit_options_t &options = jit_options_t());
+
+} // namespace symsolbin
@@ -5,26 +5,347 @@
 #pragma once
 
 #include "symsolbin/solver/analog_model.hpp"
+#include "symsolbin/model/expression_dag.hpp"
+#include "symsolbin/simulation/tape.hpp"
+
+#include <map>
+#include <string>
 
 namespace symsolbin
 {
 
+/// @brief Options controlling the code generation.
+struct codegen_options_t {
+    /// Shares the subexpressions common to all the emitted equations through
+    /// `const` temporaries.
+    bool cse = true;
+    /// Replaces powers with chains of repeated squaring and divisions by a
+    /// shared denominator with multiplications by its reciprocal.
+    bool strength_reduction = true;
+    /// Writes polynomials in Horner form.
+    bool horner = true;
+    /// Moves the values which depend only on the parameters inside an
+    /// `update_parameters()` method, and writes the equations which are
+    /// linear in the state as combinations of those cached coefficients.
+    /// The generated class calls it before its first step, afterwards it
+    /// must be called every time a system variable changes.
+    bool hoist_parameters = true;
+    /// Moves the values which depend on the timestep inside an
+    /// `update_timestep()` method, called by `run()` only when the timestep
+    /// differs from the one used the last time.
+    bool cache_timestep = true;
+    /// Replaces the timestep with the value set through `ts.set_value()`,
+    /// so that the generated code works only with that timestep.
+    bool fixed_timestep = false;
+    /// Removes the statements whose value is neither an output of the model
+    /// nor read afterwards, also in the next step, and the edges and support
+    /// variables that nothing reads or assigns.
+    bool liveness = true;
+    /// Makes the class generated by generate_class() and
+    /// generate_class_batched() a template on its scalar type `T`, which
+    /// defaults to analog_value_t, so that the same code runs with `float`,
+    /// `long double`, or a dual number. The type must be constructible from
+    /// a double, and its functions are found through argument-dependent
+    /// lookup.
+    bool scalar_template = false;
+    /// Stores all the values of the class generated by generate_class()
+    /// inside one aligned buffer, `_data`, split in regions: the state
+    /// carried between the steps (the support values of the integrals and
+    /// derivatives), the edges, the inputs, the coefficients and the system
+    /// variables, each one ordered by first use inside run(). The values are
+    /// reached through accessors, e.g., `C0_pot()`, and the carried state is
+    /// copied with save_state() and load_state().
+    bool contiguous_state = false;
+    /// Surrounds every statement of run() generated by generate_class(),
+    /// together with its temporaries, with cycle counters, and adds a
+    /// `dump_profile()` which ranks the statements by their cost, next to
+    /// the equation they come from. The counters compile to nothing unless
+    /// `SYMSOLBIN_PROFILE` is defined when compiling the generated code.
+    bool profile = false;
+};
+
+/// @brief Options controlling the generation of fixed-point code.
+struct fixed_point_options_t {
+    /// The options used to lower the model, the timestep is always fixed to
+    /// the value set through `ts.set_value()`.
+    codegen_options_t codegen;
+    /// The range of the variables, e.g., `{ "C0.pot", { -5.0, 5.0 } }`,
+    /// which takes precedence over the one set through value_t::set_range().
+    std::map<std::string, std::pair<double, double>> ranges;
+    /// The magnitude assumed for the variables which are read before being
+    /// assigned, and have no range, with a warning. This includes the system
+    /// variables and the inputs without value_t::set_range(): their current
+    /// value is not used as range, since they can change at runtime.
+    double default_range = 1.0;
+    /// The bits left free above the range of each value, against values
+    /// slightly outside their range.
+    int guard_bits = 1;
+    /// The function calls are evaluated through tables spanning the range
+    /// of their argument, with at most `2^table_bits` segments, between 1
+    /// and 16.
+    int table_bits = 8;
+};
+
+/// @brief Statistics collected while generating the code.
+struct codegen_report_t {
+    /// Operations needed when each equation is evaluated on its own.
+    std::size_t tree_operations = 0;
+    /// Operations needed after common subexpression elimination.
+    std::size_t dag_operations = 0;
+    /// Temporaries introduced by common subexpression elimination.
+    std::size_t temporaries = 0;
+    /// Operations performed by each call to `run()`.
+    cost_report_t cost;
+    /// Operations performed by each call to `update_parameters()`.
+    cost_report_t parameter_cost;
+    /// Operations performed by each call to `update_timestep()`.
+    cost_report_t timestep_cost;
+    /// Values stored by an instance for the variables of the model, before
+    /// removing the unused ones.
+    std::size_t state_before = 0;
+    /// Values stored by an instance for the variables of the model.
+    std::size_t state_after = 0;
+
+    /// @brief Returns the number of operations removed by common
+    /// subexpression elimination.
+    inline std::size_t removed_operations() const
+    {
+        return tree_operations - dag_operations;
+    }
+
+    /// @brief Stream operator for the report.
+    friend std::ostream &operator<<(std::ostream &lhs, const codegen_report_t &rhs);
+};
+
+/// @brief The variables of the model stored by the generated classes.
+struct model_members_t {
+    /// The aliases of the edges, each one is an `analog_pair_t`.
+    std::vector<std::string> edges;
+    /// The system variables.
+    std::vector<std::string> values;
+    /// The system inputs.
+    std::vector<std::string> inputs;
+    /// The support variables.
+    std::vector<std::string> support;
+
+    /// @brief Returns the number of values stored by an instance.
+    inline std::size_t state_size() const
+    {
+        return 2 * edges.size() + values.size() + inputs.size() + support.size();
+    }
+};
+
+/// A list of assignments `target = expression`, in evaluation order.
+using assignment_list_t = std::vector<std::pair<std::string, GiNaC::ex>>;
+
+/// @brief Lowers a list of assignments, which read the variables of the
+/// model, inside an expression DAG whose statements follow the same order.
+/// @details The system variables belong to the parameter stage, the
+/// timestep to the timestep stage, and the rest to the state stage.
+/// @param model the analog model.
+/// @param assignments the assignments.
+/// @param options the code generation options.
+/// @param report if not null, filled with the size of the expressions.
+/// @return the DAG.
+expression_dag_t lower_assignments(const analog_model_t &model,
+                                   const assignment_list_t &assignments,
+                                   const codegen_options_t &options,
+                                   codegen_report_t *report = nullptr);
+
+/// @brief Lowers a list of assignments, preceded by the definition of some
+/// intermediate values (see expression_dag_t::define), which do not become
+/// statements but are shared by the assignments that read them.
+/// @param model the analog model.
+/// @param definitions the intermediate values, in evaluation order.
+/// @param assignments the assignments.
+/// @param options the code generation options.
+/// @param report if not null, filled with the size of the expressions.
+/// @return the DAG.
+expression_dag_t lower_assignments(const analog_model_t &model,
+                                   const assignment_list_t &definitions,
+                                   const assignment_list_t &assignments,
+                                   const codegen_options_t &options,
+                                   codegen_report_t *report = nullptr);
+
+/// @brief Lowers the solution of the model inside an expression DAG, whose
+/// statements are the solved equations followed by the support ones. The
+/// intermediate values of an elimination become shared nodes of the DAG.
+/// With liveness enabled, the statements whose value is never used are
+/// removed.
+/// @param model the analog model.
+/// @param options the code generation options.
+/// @param report if not null, filled with the size of the expressions.
+/// @return the DAG.
+expression_dag_t lower_model(const analog_model_t &model,
+                             const codegen_options_t &options,
+                             codegen_report_t *report = nullptr);
+
+/// @brief Gathers the variables of the model, sorted, which the generated
+/// classes store. With liveness enabled, the edges and the support variables
+/// which the statements of the DAG neither read nor assign are skipped,
+/// system variables and inputs are always kept since they are set from
+/// outside.
+/// @param model the analog model.
+/// @param dag the lowered model.
+/// @param options the code generation options.
+/// @param report if not null, filled with the size of the state.
+/// @return the members.
+model_members_t collect_members(const analog_model_t &model,
+                                const expression_dag_t &dag,
+                                const codegen_options_t &options,
+                                codegen_report_t *report = nullptr);
+
 /// @brief Creates a C++ simulation code.
 /// @param model the analog model we want to print.
 /// @param name the name of the output class.
+/// @param options the code generation options.
+/// @param report if not null, filled with statistics about the generated code.
 /// @return the generated code.
-std::string generate_class(const analog_model_t &model, const std::string &name);
+std::string generate_class(const analog_model_t &model,
+                           const std::string &name,
+                           const codegen_options_t &options = codegen_options_t(),
+                           codegen_report_t *report         = nullptr);
 
-/// @brief Creates a simulation code that uses dense matrices from Eigen3.
+/// @brief Creates a C++ simulation code for several instances of the same
+/// model, which differ by the values of their variables.
+/// @details Every variable is stored as an array with one entry per instance
+/// (structure of arrays), and `run_batch(n)` advances the first `n` instances
+/// by processing them in blocks of `width`, a loop that the compiler can
+/// vectorize.
 /// @param model the analog model we want to print.
 /// @param name the name of the output class.
+/// @param width the number of instances processed together, e.g., the
+/// number of doubles inside a vector register.
+/// @param options the code generation options.
+/// @param report if not null, filled with statistics about the generated code.
 /// @return the generated code.
-std::string generate_class_dense(const analog_model_t &model, const std::string &name);
+std::string generate_class_batched(const analog_model_t &model,
+                                   const std::string &name,
+                                   std::size_t width                 = 4,
+                                   const codegen_options_t &options = codegen_options_t(),
+                                   codegen_report_t *report         = nullptr);
 
-/// @brief Creates a simulation code that uses sparse matrices from Eigen3.
+/// @brief Creates a C++ simulation code split among several files, for
+/// models whose run() would be too large to compile as a single function.
+/// @details The statements of the step are split in consecutive parts with
+/// a similar amount of work, each one becomes the method `run_partN()`
+/// inside the file `<name>_partN.cpp`, and is printed by its own thread. The
+/// values shared by different parts are stored inside members. The files
+/// are `<name>.hpp`, `<name>.cpp`, the parts, and the CMake fragment
+/// `<name>.cmake` which lists them. The options scalar_template,
+/// contiguous_state and profile are not supported.
 /// @param model the analog model we want to print.
 /// @param name the name of the output class.
+/// @param directory the existing directory where the files are written.
+/// @param parts the number of parts, if zero one for each hardware thread.
+/// @param options the code generation options.
+/// @param report if not null, filled with statistics about the generated code.
+/// @return true on success, false if an option is not supported or a file
+/// could not be written.
+bool generate_class_split(const analog_model_t &model,
+                          const std::string &name,
+                          const std::string &directory,
+                          std::size_t parts                = 0,
+                          const codegen_options_t &options = codegen_options_t(),
+                          codegen_report_t *report         = nullptr);
+
+/// @brief Creates the step of the model as a pure C function, which can be
+/// compiled both as C and as C++, and called through the C ABI.
+/// @details The function `<name>_step(params, state, out, ts)` works only on
+/// its arguments, which are restrict-qualified: `params` holds the system
+/// variables followed by the inputs, `state` the support variables carried
+/// between steps, and `out` receives the outputs of the model, or all its
+/// unknowns if none was declared. The edges are computed again by every
+/// step, inside a local array. The enumerators
+/// `<name>_param_<variable>`, `<name>_state_<variable>` and
+/// `<name>_out_<variable>` are the indices of the entries, and
+/// `<name>_layout()` describes the arrays at runtime. Nothing is cached
+/// between calls, so the coefficients are never hoisted.
+/// @param model the analog model we want to print.
+/// @param name the prefix of the functions.
+/// @param options the code generation options.
+/// @param report if not null, filled with statistics about the generated code.
 /// @return the generated code.
-std::string generate_class_sparse(const analog_model_t &model, const std::string &name);
+std::string generate_kernel(const analog_model_t &model,
+                            const std::string &name,
+                            const codegen_options_t &options = codegen_options_t(),
+                            codegen_report_t *report         = nullptr);
+
+/// @brief Lowers the solution of the model into a bytecode tape, which can
+/// be evaluated without a compiler. The registers of the system variables
+/// start from their value.
+/// @param model the analog model.
+/// @param options the code generation options.
+/// @param report if not null, filled with statistics about the tape.
+/// @return the tape, not valid if the model reads a variable or calls a
+/// function that the tape cannot evaluate.
+tape_t generate_tape(const analog_model_t &model,
+                     const codegen_options_t &options = codegen_options_t(),
+                     codegen_report_t *report         = nullptr);
+
+/// @brief Creates a C++ simulation code which works only with integers, in
+/// Q format, for processors without a floating-point unit.
+/// @details Every variable, coefficient and temporary is a fixed_t with its
+/// own fractional bits, chosen from the range of its values. The ranges of
+/// the variables come from the options, from value_t::set_range(), or from
+/// the default range, see fixed_point_options_t; the ranges of the
+/// intermediate values are computed through interval arithmetic.
+/// Intermediate results are wide integers, rescaled with rounding and
+/// saturated when stored. Function calls are evaluated by linear
+/// interpolation inside a table computed at generation time, see
+/// fx_lookup(). The class exposes `set()`, `get()` and `variable()` to
+/// access the variables by name, and can be checked against the double tape
+/// through fixed_point_accuracy().
+/// @param model the analog model we want to print.
+/// @param name the name of the output class.
+/// @param options the fixed-point options.
+/// @param report if not null, filled with statistics about the generated code.
+/// @return the generated code, empty if a function call cannot be tabulated.
+std::string generate_fixed_point(const analog_model_t &model,
+                                 const std::string &name,
+                                 const fixed_point_options_t &options = fixed_point_options_t(),
+                                 codegen_report_t *report             = nullptr);
+
+/// @brief Stores the solved model inside a binary file, which can be loaded
+/// by model_file_t without GiNaC. The file holds the tape the model is
+/// lowered into, not its expression DAG.
+/// @param model the analog model.
+/// @param path the path of the file.
+/// @param options the options used to lower the model into a tape.
+/// @return true on success, false otherwise.
+bool save_model(const analog_model_t &model,
+                const std::string &path,
+                const codegen_options_t &options = codegen_options_t());
+
+/// @brief Creates a simulation code that uses dense matrices from Eigen3.
+/// @details The entries of `A` which depend only on the parameters and on
+/// the timestep are computed, and `A` is LU-factorized, only when those
+/// change. The right-hand side is evaluated at every step, so each step
+/// costs two triangular solves, unless `A` depends on the state.
+/// @param model the analog model we want to print.
+/// @param name the name of the output class.
+/// @param options the code generation options.
+/// @param report if not null, filled with statistics about the generated code.
+/// @return the generated code, empty if the system is not square.
+std::string generate_class_dense(const analog_model_t &model,
+                                 const std::string &name,
+                                 const codegen_options_t &options = codegen_options_t(),
+                                 codegen_report_t *report         = nullptr);
+
+/// @brief Creates a simulation code that uses sparse matrices from Eigen3.
+/// @details Only the structural non-zeros of `A` are stored, and their
+/// pattern is analyzed once in the constructor. The entries are written
+/// directly inside the compressed storage: the ones which depend only on the
+/// parameters and on the timestep when those change, the ones which depend
+/// on the state at every step, followed by a numeric-only factorization.
+/// @param model the analog model we want to print.
+/// @param name the name of the output class.
+/// @param options the code generation options.
+/// @param report if not null, filled with statistics about the generated code.
+/// @return the generated code, empty if the system is not square.
+std::string generate_class_sparse(const analog_model_t &model,
+                                  const std::string &name,
+                                  const codegen_options_t &options = codegen_options_t(),
+                                  codegen_report_t *report         = nullptr);
 
 } // namespace symsolbin
\ No newline at end of file
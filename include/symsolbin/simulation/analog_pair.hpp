@@ -16,14 +16,16 @@ namespace symsolbin
 using analog_value_t = double;
 
 /// @brief Keeps track of potential and flow an analog edge.
-struct analog_pair_t {
+/// @tparam T the type of the values, e.g., float, double, or a dual number.
+template <typename T>
+struct basic_analog_pair_t {
     /// @brief Potential value.
-    analog_value_t pot;
+    T pot;
     /// @brief Flow value.
-    analog_value_t flw;
+    T flw;
 
     /// @brief Construct a new pair of values.
-    analog_pair_t()
+    basic_analog_pair_t()
         : pot(),
           flw()
     {
@@ -33,17 +35,17 @@ struct analog_pair_t {
     /// @brief Construct and initializes a new pair of values.
     /// @param _pot initial potential value.
     /// @param _flw initial flow value.
-    analog_pair_t(analog_value_t _pot, analog_value_t _flw)
+    basic_analog_pair_t(T _pot, T _flw)
         : pot(_pot),
           flw(_flw)
     {
         // Nothing to do.
     }
 
-    ~analog_pair_t() = default;
+    ~basic_analog_pair_t() = default;
 
     /// @brief Computes power for the given analog edge.
-    inline analog_value_t power() const
+    inline T power() const
     {
         return (pot * flw);
     }
@@ -51,7 +53,7 @@ struct analog_pair_t {
     /// @brief Checks equality between two analog edges.
     /// @param other the other analog edge.
     /// @return if the values between the two analog edges are equal.
-    inline bool operator==(const analog_pair_t &other) const
+    inline bool operator==(const basic_analog_pair_t &other) const
     {
         return is_equal(pot, other.pot) && is_equal(flw, other.flw);
     }
@@ -59,7 +61,7 @@ struct analog_pair_t {
     /// @brief Checks inequality between two analog edges.
     /// @param other the other analog edge.
     /// @return if the values between the two analog edges are different.
-    inline bool operator!=(const analog_pair_t &other) const
+    inline bool operator!=(const basic_analog_pair_t &other) const
     {
         return (!is_equal(pot, other.pot)) || (!is_equal(flw, other.flw));
     }
@@ -67,7 +69,7 @@ struct analog_pair_t {
     /// @brief Sums the potential and flow values of two analog edges.
     /// @param other the other analog edge.
     /// @return this edge.
-    inline analog_pair_t &operator+=(const analog_pair_t &other)
+    inline basic_analog_pair_t &operator+=(const basic_analog_pair_t &other)
     {
         pot += other.pot;
         flw += other.flw;
@@ -77,7 +79,7 @@ struct analog_pair_t {
     /// @brief Substracts the potential and flow values of two analog edges.
     /// @param other the other analog edge.
     /// @return this edge.
-    inline analog_pair_t &operator-=(const analog_pair_t &other)
+    inline basic_analog_pair_t &operator-=(const basic_analog_pair_t &other)
     {
         pot -= other.pot;
         flw -= other.flw;
@@ -87,7 +89,7 @@ struct analog_pair_t {
     /// @brief Multiplies the potential and flow values of two analog edges.
     /// @param other the other analog edge.
     /// @return this edge.
-    inline analog_pair_t &operator*=(const analog_pair_t &other)
+    inline basic_analog_pair_t &operator*=(const basic_analog_pair_t &other)
     {
         pot *= other.pot;
         flw *= other.flw;
@@ -95,11 +97,14 @@ struct analog_pair_t {
     }
 
     /// @brief Stream operator.
-    inline friend std::ostream &operator<<(std::ostream &out, const analog_pair_t &other)
+    inline friend std::ostream &operator<<(std::ostream &out, const basic_analog_pair_t &other)
     {
         out << other.pot << ";" << other.flw;
         return out;
     }
 };
 
+/// @brief Keeps track of potential and flow an analog edge, as analog_value_t.
+using analog_pair_t = basic_analog_pair_t<analog_value_t>;
+
 } // namespace symsolbin
\ No newline at end of file
@@ -0,0 +1,128 @@
+/// @file fixed_point.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Arithmetic used by the fixed-point code. The generated classes
+/// include this header, so it must not depend on anything else of the
+/// library, see fixed_point_accuracy.hpp for the host-side harness.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace symsolbin
+{
+
+/// @brief A value in Q format, `raw / 2^fraction`, where each variable has
+/// its own number of fractional bits.
+using fixed_t = std::int32_t;
+
+/// @brief The type of the intermediate results, wide enough to hold the
+/// product of two fixed-point values.
+using fixed_wide_t = std::int64_t;
+
+/// @brief Clamps a wide value inside the range of fixed_t.
+inline fixed_t fx_saturate(fixed_wide_t value)
+{
+    if (value > std::numeric_limits<fixed_t>::max())
+        return std::numeric_limits<fixed_t>::max();
+    if (value < std::numeric_limits<fixed_t>::min())
+        return std::numeric_limits<fixed_t>::min();
+    return static_cast<fixed_t>(value);
+}
+
+/// @brief Multiplies a value by `2^shift`, saturating on overflow, or
+/// divides it by `2^-shift` rounding to the nearest.
+inline fixed_wide_t fx_shift(fixed_wide_t value, int shift)
+{
+    if (shift >= 0) {
+        const fixed_wide_t limit = (shift >= 63) ? 0 : (std::numeric_limits<fixed_wide_t>::max() >> shift);
+        if (value > limit)
+            return std::numeric_limits<fixed_wide_t>::max();
+        if (value < -limit)
+            return std::numeric_limits<fixed_wide_t>::min();
+        return value * (static_cast<fixed_wide_t>(1) << shift);
+    }
+    if (shift <= -63)
+        return 0;
+    return (value + (static_cast<fixed_wide_t>(1) << (-shift - 1))) >> -shift;
+}
+
+/// @brief Computes `(a * 2^shift) / b`, rounded toward zero, saturating
+/// when b is zero or the quotient does not fit a fixed_t.
+inline fixed_wide_t fx_div(fixed_wide_t a, fixed_wide_t b, int shift)
+{
+    const fixed_wide_t lowest  = std::numeric_limits<fixed_t>::min();
+    const fixed_wide_t highest = std::numeric_limits<fixed_t>::max();
+    if (b == 0)
+        return (a >= 0) ? highest : lowest;
+    if (shift < 0)
+        return (shift < -31) ? 0 : (a / fx_shift(b, -shift));
+    const bool negative = (a < 0) != (b < 0);
+    std::uint64_t n     = (a < 0) ? (0 - static_cast<std::uint64_t>(a)) : static_cast<std::uint64_t>(a);
+    std::uint64_t d     = (b < 0) ? (0 - static_cast<std::uint64_t>(b)) : static_cast<std::uint64_t>(b);
+    // The dividend is moved up as far as it fits, and the bits of the shift
+    // which are left are computed from the remainder, one at a time, so that
+    // no fractional bit is lost.
+    int done = 0;
+    while ((done < shift) && (n < (static_cast<std::uint64_t>(1) << 62))) {
+        n <<= 1;
+        ++done;
+    }
+    std::uint64_t quotient = n / d, remainder = n % d;
+    const std::uint64_t limit = static_cast<std::uint64_t>(highest) + 1;
+    for (; (done < shift) && (quotient < limit); ++done) {
+        quotient <<= 1;
+        remainder <<= 1;
+        if (remainder >= d) {
+            remainder -= d;
+            quotient |= 1;
+        }
+    }
+    if (quotient >= limit)
+        return negative ? lowest : highest;
+    return negative ? -static_cast<fixed_wide_t>(quotient) : static_cast<fixed_wide_t>(quotient);
+}
+
+/// @brief Evaluates a function through its table, by linear interpolation
+/// between the two closest points, see generate_fixed_point().
+/// @param table the values of the function at the points `origin + i *
+/// 2^step` of the argument, in the format of the result.
+/// @param size the number of points.
+/// @param x the argument, clamped inside the points of the table.
+/// @param origin the first point, in the format of the argument.
+/// @param step the distance between two points, as a power of two.
+inline fixed_wide_t fx_lookup(const fixed_t *table, std::size_t size, fixed_wide_t x, fixed_wide_t origin, int step)
+{
+    const fixed_wide_t last   = static_cast<fixed_wide_t>(size - 1) << step;
+    const fixed_wide_t offset = (x < origin) ? 0 : (((x - origin) > last) ? last : (x - origin));
+    const std::size_t index   = static_cast<std::size_t>(offset >> step);
+    if (index + 1 >= size)
+        return table[size - 1];
+    const fixed_wide_t rest = offset - (static_cast<fixed_wide_t>(index) << step);
+    return table[index] + (((static_cast<fixed_wide_t>(table[index + 1]) - table[index]) * rest) >> step);
+}
+
+/// @brief Converts a double to a fixed-point value.
+/// @param value the value.
+/// @param fraction the fractional bits.
+inline fixed_t fx_from_double(double value, int fraction)
+{
+    double scaled = std::round(std::ldexp(value, fraction));
+    if (scaled >= static_cast<double>(std::numeric_limits<fixed_t>::max()))
+        return std::numeric_limits<fixed_t>::max();
+    if (scaled <= static_cast<double>(std::numeric_limits<fixed_t>::min()))
+        return std::numeric_limits<fixed_t>::min();
+    return static_cast<fixed_t>(scaled);
+}
+
+/// @brief Converts a fixed-point value to a double.
+/// @param value the value.
+/// @param fraction the fractional bits.
+inline double fx_to_double(fixed_wide_t value, int fraction)
+{
+    return std::ldexp(static_cast<double>(value), -fraction);
+}
+
+} // namespace symsolbin
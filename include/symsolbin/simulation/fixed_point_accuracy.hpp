@@ -0,0 +1,93 @@
+/// @file fixed_point_accuracy.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Harness which measures the accuracy of the fixed-point code
+/// against the double reference, on the host.
+
+#pragma once
+
+#include "symsolbin/simulation/fixed_point.hpp"
+#include "symsolbin/simulation/tape.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace symsolbin
+{
+
+/// @brief The error of a fixed-point variable against the double reference.
+struct fixed_point_error_t {
+    /// The name of the variable.
+    std::string name;
+    /// Its fractional bits.
+    int fraction = 0;
+    /// The largest absolute error.
+    double max_error = 0;
+    /// The largest absolute value of the reference.
+    double max_value = 0;
+
+    /// @brief Returns the largest error relative to the largest value.
+    inline double relative() const
+    {
+        return (max_value > 0) ? (max_error / max_value) : max_error;
+    }
+};
+
+/// @brief Sets the inputs of a step, e.g., `inputs["vin"] = 1.0`.
+using fixed_point_stimulus_t = std::function<void(std::size_t step, std::map<std::string, double> &inputs)>;
+
+/// @brief Runs the class generated by generate_fixed_point() next to the
+/// double tape of the same model, and measures the error of every variable
+/// they share.
+/// @details The fixed-point model starts from the values of the reference,
+/// and both are advanced with the timestep the class was generated for.
+/// @param model the fixed-point model.
+/// @param reference the tape of the model, with its variables already set.
+/// @param steps the number of steps.
+/// @param stimulus if set, called before each step to change the inputs.
+/// @return the error of each variable.
+template <typename Model>
+std::vector<fixed_point_error_t> fixed_point_accuracy(Model &model,
+                                                      tape_t &reference,
+                                                      std::size_t steps,
+                                                      const fixed_point_stimulus_t &stimulus = nullptr)
+{
+    std::vector<fixed_point_error_t> errors;
+    std::vector<const fixed_t *> values;
+    for (const auto &variable : reference.variables()) {
+        fixed_point_error_t error;
+        error.name = variable.first;
+        if (const fixed_t *value = model.variable(error.name.c_str(), error.fraction)) {
+            model.set(error.name.c_str(), reference.values()[variable.second]);
+            errors.emplace_back(error);
+            values.emplace_back(value);
+        }
+    }
+    reference.update_parameters();
+    model.update_parameters();
+    std::map<std::string, double> inputs;
+    for (std::size_t step = 0; step < steps; ++step) {
+        if (stimulus) {
+            inputs.clear();
+            stimulus(step, inputs);
+            for (const auto &input : inputs) {
+                reference.set(input.first, input.second);
+                model.set(input.first.c_str(), input.second);
+            }
+        }
+        reference.step(Model::timestep);
+        model.run();
+        for (std::size_t i = 0; i < errors.size(); ++i) {
+            double expected     = reference.get(errors[i].name);
+            double actual       = fx_to_double(*values[i], errors[i].fraction);
+            errors[i].max_error = std::max(errors[i].max_error, std::abs(actual - expected));
+            errors[i].max_value = std::max(errors[i].max_value, std::abs(expected));
+        }
+    }
+    return errors;
+}
+
+} // namespace symsolbin
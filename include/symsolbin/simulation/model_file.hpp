@@ -0,0 +1,328 @@
+/// @file model_file.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Binary format of a solved model, and a runtime which memory-maps
+/// and evaluates it, without depending on GiNaC.
+/// @details The file is made of, in order:
+///  - the header;
+///  - the initial value of each register (doubles);
+///  - the variables of the model;
+///  - the instructions of the parameter, timestep and step sections;
+///  - the names of the variables (not null-terminated).
+/// The values are stored with the byte order of the machine that wrote
+/// the file, which is checked when the file is opened.
+/// The file stores the tape the solution is lowered into, not its
+/// expression DAG: the tape is already flat and bounded, so it can be
+/// validated once and then executed straight from the mapping, while the
+/// DAG would have to be lowered again by every loader.
+
+#pragma once
+
+#include "symsolbin/simulation/tape.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace symsolbin
+{
+
+/// The magic number of the files, i.e., "SSBM".
+#define MODEL_FILE_MAGIC 0x4D425353U
+/// The version of the format.
+#define MODEL_FILE_VERSION 1U
+
+/// @brief What a variable of the model represents.
+enum class model_variable_kind_t : std::uint32_t {
+    potential, ///< The potential of an edge.
+    flow,      ///< The flow of an edge.
+    value,     ///< A system variable (parameter).
+    input,     ///< A system input.
+    support    ///< A support variable.
+};
+
+/// @brief The header of the file.
+struct model_file_header_t {
+    /// Must be MODEL_FILE_MAGIC.
+    std::uint32_t magic;
+    /// Must be MODEL_FILE_VERSION.
+    std::uint32_t version;
+    /// The number of registers.
+    std::uint32_t registers;
+    /// The number of variables.
+    std::uint32_t variables;
+    /// The number of instructions of the parameter section.
+    std::uint32_t parameter_instructions;
+    /// The number of instructions of the timestep section.
+    std::uint32_t timestep_instructions;
+    /// The number of instructions of the step section.
+    std::uint32_t step_instructions;
+    /// The size of the names, in bytes.
+    std::uint32_t names_size;
+    /// The register holding the timestep.
+    std::uint32_t timestep_register;
+    /// Unused, keeps the registers aligned.
+    std::uint32_t reserved;
+};
+
+/// @brief A variable of the model.
+struct model_file_variable_t {
+    /// The offset of the name.
+    std::uint32_t name_offset;
+    /// The length of the name.
+    std::uint32_t name_length;
+    /// The register holding the variable.
+    std::uint32_t index;
+    /// What the variable represents.
+    model_variable_kind_t kind;
+};
+
+/// @brief A solved model loaded from a file. The instructions are read
+/// directly from the mapped file, only the registers are copied.
+class model_file_t {
+public:
+    /// @brief Creates an empty model.
+    model_file_t()
+        : _data(nullptr),
+          _size(),
+          _header(nullptr),
+          _parameter(nullptr),
+          _timestep(nullptr),
+          _step(nullptr),
+          _registers(),
+          _variables(),
+          _kinds(),
+          _cached_timestep(-1.0)
+    {
+        // Nothing to do.
+    }
+
+    /// @brief Opens the model stored inside the file.
+    explicit model_file_t(const std::string &path)
+        : model_file_t()
+    {
+        this->open(path);
+    }
+
+    model_file_t(const model_file_t &other) = delete;
+
+    model_file_t &operator=(const model_file_t &other) = delete;
+
+    /// @brief Move constructor.
+    model_file_t(model_file_t &&other) noexcept
+        : model_file_t()
+    {
+        *this = std::move(other);
+    }
+
+    /// @brief Move assignment.
+    model_file_t &operator=(model_file_t &&other) noexcept
+    {
+        if (this != &other) {
+            this->close();
+            _data            = other._data;
+            _size            = other._size;
+            _header          = other._header;
+            _parameter       = other._parameter;
+            _timestep        = other._timestep;
+            _step            = other._step;
+            _registers       = std::move(other._registers);
+            _variables       = std::move(other._variables);
+            _kinds           = std::move(other._kinds);
+            _cached_timestep = other._cached_timestep;
+            other._data      = nullptr;
+            other._header    = nullptr;
+            other.close();
+        }
+        return *this;
+    }
+
+    /// @brief Unmaps the file.
+    ~model_file_t()
+    {
+        this->close();
+    }
+
+    /// @brief Maps the file and checks its content.
+    /// @param path the path of the file.
+    /// @return true if the file is a valid model, false otherwise.
+    inline bool open(const std::string &path)
+    {
+        this->close();
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat info;
+        if ((fstat(descriptor, &info) != 0) || (info.st_size < static_cast<off_t>(sizeof(model_file_header_t)))) {
+            ::close(descriptor);
+            return false;
+        }
+        _size = static_cast<std::size_t>(info.st_size);
+        _data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);
+        if (_data == MAP_FAILED) {
+            _data = nullptr;
+            return false;
+        }
+        if (!this->__load()) {
+            this->close();
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief Unmaps the file.
+    inline void close()
+    {
+        if (_data)
+            munmap(_data, _size);
+        _data   = nullptr;
+        _header = nullptr;
+        _registers.clear();
+        _variables.clear();
+        _kinds.clear();
+    }
+
+    /// @brief Checks if a valid model is loaded.
+    inline bool valid() const
+    {
+        return _header != nullptr;
+    }
+
+    /// @brief Returns the variables of the model, and their registers.
+    inline const std::map<std::string, std::uint32_t> &variables() const
+    {
+        return _variables;
+    }
+
+    /// @brief Returns what a variable represents.
+    inline model_variable_kind_t kind(const std::string &name) const
+    {
+        return _kinds.at(name);
+    }
+
+    /// @brief Returns a pointer to a variable, e.g., `R0.pot` or `vin`.
+    /// @param name the name of the variable.
+    /// @return the pointer, or nullptr if there is no such variable.
+    inline double *variable(const std::string &name)
+    {
+        auto it = _variables.find(name);
+        return (it == _variables.end()) ? nullptr : &_registers[it->second];
+    }
+
+    /// @brief Returns the value of a variable, or zero if it does not exist.
+    inline double get(const std::string &name) const
+    {
+        auto it = _variables.find(name);
+        return (it == _variables.end()) ? 0.0 : _registers[it->second];
+    }
+
+    /// @brief Sets the value of a variable.
+    /// @return true if the variable exists, false otherwise.
+    inline bool set(const std::string &name, double value)
+    {
+        double *variable = this->variable(name);
+        if (variable)
+            *variable = value;
+        return variable != nullptr;
+    }
+
+    /// @brief Computes the values which depend only on the parameters, must
+    /// be called every time one of them changes. Does nothing if the model
+    /// is not valid.
+    inline void update_parameters()
+    {
+        if (!this->valid())
+            return;
+        tape_execute(_parameter, _header->parameter_instructions, _registers.data());
+        _cached_timestep = -1.0;
+    }
+
+    /// @brief Advances the model by one step, does nothing if the model is
+    /// not valid.
+    /// @param ts the timestep.
+    inline void step(double ts)
+    {
+        if (!this->valid())
+            return;
+        _registers[_header->timestep_register] = ts;
+        if (ts != _cached_timestep) {
+            tape_execute(_timestep, _header->timestep_instructions, _registers.data());
+            _cached_timestep = ts;
+        }
+        tape_execute(_step, _header->step_instructions, _registers.data());
+    }
+
+private:
+    /// The mapped file.
+    void *_data;
+    /// The size of the mapped file.
+    std::size_t _size;
+    /// The header, null if the model is not valid.
+    const model_file_header_t *_header;
+    /// The instructions of the parameter section.
+    const tape_instruction_t *_parameter;
+    /// The instructions of the timestep section.
+    const tape_instruction_t *_timestep;
+    /// The instructions of the step section.
+    const tape_instruction_t *_step;
+    /// The register file.
+    std::vector<double> _registers;
+    /// The register of each variable.
+    std::map<std::string, std::uint32_t> _variables;
+    /// What each variable represents.
+    std::map<std::string, model_variable_kind_t> _kinds;
+    /// The timestep used by the last execution of the timestep section.
+    double _cached_timestep;
+
+    /// @brief Checks the content of the mapped file, and sets the pointers.
+    inline bool __load()
+    {
+        const auto *bytes  = static_cast<const char *>(_data);
+        const auto *header = reinterpret_cast<const model_file_header_t *>(bytes);
+        if ((header->magic != MODEL_FILE_MAGIC) || (header->version != MODEL_FILE_VERSION))
+            return false;
+        std::size_t instructions = std::size_t(header->parameter_instructions) + header->timestep_instructions + header->step_instructions;
+        std::size_t registers    = sizeof(model_file_header_t);
+        std::size_t variables    = registers + header->registers * sizeof(double);
+        std::size_t code         = variables + header->variables * sizeof(model_file_variable_t);
+        std::size_t names        = code + instructions * sizeof(tape_instruction_t);
+        if ((names + header->names_size != _size) || (header->timestep_register >= header->registers))
+            return false;
+        // Check every register index, so that a corrupted file cannot make
+        // the interpreter write outside of the register file.
+        const auto *first = reinterpret_cast<const tape_instruction_t *>(bytes + code);
+        for (std::size_t i = 0; i < instructions; ++i) {
+            const tape_instruction_t &instruction = first[i];
+            if ((instruction.op > tape_op_t::atan2) || (instruction.dst >= header->registers) || (instruction.a >= header->registers))
+                return false;
+            if ((instruction.op != tape_op_t::powi) && (instruction.b >= header->registers))
+                return false;
+        }
+        const auto *variable = reinterpret_cast<const model_file_variable_t *>(bytes + variables);
+        for (std::size_t i = 0; i < header->variables; ++i) {
+            if ((std::size_t(variable[i].name_offset) + variable[i].name_length > header->names_size) || (variable[i].index >= header->registers))
+                return false;
+            std::string name(bytes + names + variable[i].name_offset, variable[i].name_length);
+            _variables[name] = variable[i].index;
+            _kinds[name]     = variable[i].kind;
+        }
+        _registers.resize(header->registers);
+        std::memcpy(_registers.data(), bytes + registers, header->registers * sizeof(double));
+        _parameter       = first;
+        _timestep        = _parameter + header->parameter_instructions;
+        _step            = _timestep + header->timestep_instructions;
+        _header          = header;
+        _cached_timestep = -1.0;
+        return true;
+    }
+};
+
+} // namespace symsolbin
@@ -0,0 +1,261 @@
+/// @file tape.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Register-based bytecode which evaluates a solved model without
+/// compiling it, and without depending on GiNaC.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace symsolbin
+{
+
+/// @brief The operations of the tape.
+enum class tape_op_t : std::uint8_t {
+    copy,  ///< r[dst] = r[a]
+    add,   ///< r[dst] = r[a] + r[b]
+    sub,   ///< r[dst] = r[a] - r[b]
+    mul,   ///< r[dst] = r[a] * r[b]
+    div,   ///< r[dst] = r[a] / r[b]
+    neg,   ///< r[dst] = -r[a]
+    powi,  ///< r[dst] = r[a]^b, with b an integer exponent
+    pow,   ///< r[dst] = pow(r[a], r[b])
+    sqrt,  ///< r[dst] = sqrt(r[a])
+    exp,   ///< r[dst] = exp(r[a])
+    log,   ///< r[dst] = log(r[a])
+    sin,   ///< r[dst] = sin(r[a])
+    cos,   ///< r[dst] = cos(r[a])
+    tan,   ///< r[dst] = tan(r[a])
+    asin,  ///< r[dst] = asin(r[a])
+    acos,  ///< r[dst] = acos(r[a])
+    atan,  ///< r[dst] = atan(r[a])
+    sinh,  ///< r[dst] = sinh(r[a])
+    cosh,  ///< r[dst] = cosh(r[a])
+    tanh,  ///< r[dst] = tanh(r[a])
+    abs,   ///< r[dst] = |r[a]|
+    atan2, ///< r[dst] = atan2(r[a], r[b])
+};
+
+/// @brief An instruction of the tape.
+struct tape_instruction_t {
+    /// The operation.
+    tape_op_t op;
+    /// The destination register.
+    std::uint32_t dst;
+    /// The first operand.
+    std::uint32_t a;
+    /// The second operand, or the exponent of powi.
+    std::uint32_t b;
+};
+
+/// @brief Computes an integer power by repeated squaring.
+inline double tape_powi(double base, std::uint32_t exponent)
+{
+    double result = 1.0;
+    for (; exponent; exponent >>= 1, base *= base)
+        if (exponent & 1U)
+            result *= base;
+    return result;
+}
+
+/// @brief Executes a sequence of instructions.
+/// @param code the instructions.
+/// @param size the number of instructions.
+/// @param r the register file.
+inline void tape_execute(const tape_instruction_t *code, std::size_t size, double *r)
+{
+    for (const tape_instruction_t *i = code, *end = code + size; i != end; ++i) {
+        switch (i->op) {
+        case tape_op_t::copy: r[i->dst] = r[i->a]; break;
+        case tape_op_t::add: r[i->dst] = r[i->a] + r[i->b]; break;
+        case tape_op_t::sub: r[i->dst] = r[i->a] - r[i->b]; break;
+        case tape_op_t::mul: r[i->dst] = r[i->a] * r[i->b]; break;
+        case tape_op_t::div: r[i->dst] = r[i->a] / r[i->b]; break;
+        case tape_op_t::neg: r[i->dst] = -r[i->a]; break;
+        case tape_op_t::powi: r[i->dst] = tape_powi(r[i->a], i->b); break;
+        case tape_op_t::pow: r[i->dst] = std::pow(r[i->a], r[i->b]); break;
+        case tape_op_t::sqrt: r[i->dst] = std::sqrt(r[i->a]); break;
+        case tape_op_t::exp: r[i->dst] = std::exp(r[i->a]); break;
+        case tape_op_t::log: r[i->dst] = std::log(r[i->a]); break;
+        case tape_op_t::sin: r[i->dst] = std::sin(r[i->a]); break;
+        case tape_op_t::cos: r[i->dst] = std::cos(r[i->a]); break;
+        case tape_op_t::tan: r[i->dst] = std::tan(r[i->a]); break;
+        case tape_op_t::asin: r[i->dst] = std::asin(r[i->a]); break;
+        case tape_op_t::acos: r[i->dst] = std::acos(r[i->a]); break;
+        case tape_op_t::atan: r[i->dst] = std::atan(r[i->a]); break;
+        case tape_op_t::sinh: r[i->dst] = std::sinh(r[i->a]); break;
+        case tape_op_t::cosh: r[i->dst] = std::cosh(r[i->a]); break;
+        case tape_op_t::tanh: r[i->dst] = std::tanh(r[i->a]); break;
+        case tape_op_t::abs: r[i->dst] = std::abs(r[i->a]); break;
+        case tape_op_t::atan2: r[i->dst] = std::atan2(r[i->a], r[i->b]); break;
+        }
+    }
+}
+
+/// @brief The sections of the tape, executed at different rates.
+enum class tape_section_t {
+    parameter, ///< Executed when the parameters change.
+    timestep,  ///< Executed when the timestep changes.
+    step       ///< Executed at every step.
+};
+
+/// @brief A sequence of instructions working on a dense register file. The
+/// variables of the model and the constants live in their own registers,
+/// so a step only executes arithmetic instructions and never allocates.
+class tape_t {
+public:
+    /// @brief Constructor.
+    tape_t()
+        : _registers(),
+          _parameter(),
+          _timestep(),
+          _step(),
+          _variables(),
+          _timestep_register(),
+          _cached_timestep(-1.0)
+    {
+        // The first register always holds the timestep.
+        _registers.emplace_back(0.0);
+    }
+
+    /// @brief Adds a register.
+    /// @param value its initial value.
+    /// @return its index.
+    inline std::uint32_t add_register(double value = 0.0)
+    {
+        _registers.emplace_back(value);
+        return static_cast<std::uint32_t>(_registers.size() - 1);
+    }
+
+    /// @brief Associates a register to a variable of the model.
+    /// @param name the name of the variable.
+    /// @param index the register.
+    inline void add_variable(const std::string &name, std::uint32_t index)
+    {
+        _variables[name] = index;
+    }
+
+    /// @brief Checks if the tape holds a model, generate_tape() returns an
+    /// empty tape when the model cannot be lowered.
+    inline bool valid() const
+    {
+        return !_variables.empty();
+    }
+
+    /// @brief Returns the register holding the timestep.
+    inline std::uint32_t timestep_register() const
+    {
+        return _timestep_register;
+    }
+
+    /// @brief Appends an instruction to a section.
+    /// @param section the section.
+    /// @param instruction the instruction.
+    inline void emit(tape_section_t section, const tape_instruction_t &instruction)
+    {
+        this->__code(section).emplace_back(instruction);
+    }
+
+    /// @brief Returns the instructions of a section.
+    inline const std::vector<tape_instruction_t> &code(tape_section_t section) const
+    {
+        return const_cast<tape_t *>(this)->__code(section);
+    }
+
+    /// @brief Returns the number of registers.
+    inline std::size_t registers() const
+    {
+        return _registers.size();
+    }
+
+    /// @brief Returns the current value of every register.
+    inline const std::vector<double> &values() const
+    {
+        return _registers;
+    }
+
+    /// @brief Returns the variables of the model, and their registers.
+    inline const std::map<std::string, std::uint32_t> &variables() const
+    {
+        return _variables;
+    }
+
+    /// @brief Returns a pointer to a variable, e.g., `R0.pot` or `vin`,
+    /// which stays valid until registers are added.
+    /// @param name the name of the variable.
+    /// @return the pointer, or nullptr if there is no such variable.
+    inline double *variable(const std::string &name)
+    {
+        auto it = _variables.find(name);
+        return (it == _variables.end()) ? nullptr : &_registers[it->second];
+    }
+
+    /// @brief Returns the value of a variable, or zero if it does not exist.
+    inline double get(const std::string &name) const
+    {
+        auto it = _variables.find(name);
+        return (it == _variables.end()) ? 0.0 : _registers[it->second];
+    }
+
+    /// @brief Sets the value of a variable.
+    /// @return true if the variable exists, false otherwise.
+    inline bool set(const std::string &name, double value)
+    {
+        double *variable = this->variable(name);
+        if (variable)
+            *variable = value;
+        return variable != nullptr;
+    }
+
+    /// @brief Computes the values which depend only on the parameters, must
+    /// be called every time one of them changes.
+    inline void update_parameters()
+    {
+        tape_execute(_parameter.data(), _parameter.size(), _registers.data());
+        _cached_timestep = -1.0;
+    }
+
+    /// @brief Advances the model by one step.
+    /// @param ts the timestep.
+    inline void step(double ts)
+    {
+        _registers[_timestep_register] = ts;
+        if (ts != _cached_timestep) {
+            tape_execute(_timestep.data(), _timestep.size(), _registers.data());
+            _cached_timestep = ts;
+        }
+        tape_execute(_step.data(), _step.size(), _registers.data());
+    }
+
+private:
+    /// The register file.
+    std::vector<double> _registers;
+    /// The instructions executed when the parameters change.
+    std::vector<tape_instruction_t> _parameter;
+    /// The instructions executed when the timestep changes.
+    std::vector<tape_instruction_t> _timestep;
+    /// The instructions executed at every step.
+    std::vector<tape_instruction_t> _step;
+    /// The register of each variable.
+    std::map<std::string, std::uint32_t> _variables;
+    /// The register holding the timestep.
+    std::uint32_t _timestep_register;
+    /// The timestep used by the last execution of the timestep section.
+    double _cached_timestep;
+
+    /// @brief Returns the instructions of a section.
+    inline std::vector<tape_instruction_t> &__code(tape_section_t section)
+    {
+        if (section == tape_section_t::parameter)
+            return _parameter;
+        if (section == tape_section_t::timestep)
+            return _timestep;
+        return _step;
+    }
+};
+
+} // namespace symsolbin
@@ -8,6 +8,11 @@
 
 #include "symsolbin/structure/value.hpp"
 #include "symsolbin/structure/edge.hpp"
+#include "symsolbin/solver/tuner.hpp"
+
+#include <map>
+#include <set>
+#include <string>
 
 namespace symsolbin
 {
@@ -35,18 +40,82 @@ struct system_t {
     equation_set_t kfl;
     /// The unknowns of the system.
     symbol_set_t unknowns;
+    /// The unknowns observed from outside the model, if empty every unknown
+    /// is computed.
+    symbol_set_t outputs;
     /// The list of values.
     value_list_t values;
+    /// The list of inputs, values which are expected to change at every step.
+    value_list_t inputs;
+};
+
+/// @brief How the solver computes the unknowns.
+enum class solve_method_t {
+    /// Each unknown is a single closed-form expression, computed by GiNaC.
+    closed_form,
+    /// The steps of a Gaussian elimination are kept as intermediate values,
+    /// see eliminate().
+    elimination,
+    /// Each unknown is a single closed-form expression, computed by a sparse
+    /// fraction-free elimination, see sparse_solve().
+    sparse
+};
+
+/// @brief Options of the solver.
+struct solver_options_t {
+    /// How the unknowns are computed.
+    solve_method_t method = solve_method_t::closed_form;
+    /// If the system is split in the blocks of its block-lower-triangular
+    /// form, which are solved one after the other, see blt_decompose().
+    bool blt = true;
+    /// The algorithm used by GiNaC for the closed form, see GiNaC::solve_algo.
+    unsigned algorithm = GiNaC::solve_algo::automatic;
+    /// How the algorithm is chosen for each block, see tune_algorithm().
+    solver_tuning_t tuning = solver_tuning_t::none;
+    /// The seconds each algorithm can run during a race.
+    double tuning_budget = 10.0;
+    /// If the connected components of the system, which share no unknown,
+    /// are solved at the same time by worker processes.
+    bool parallel = false;
+    /// The number of workers, zero for one per hardware thread.
+    std::size_t workers = 0;
+    /// If the solutions are stored on disk, and loaded instead of being
+    /// computed when the same system is solved again, see solution_key().
+    /// The winners of the races are stored next to them.
+    bool cache = false;
+    /// The directory of the cached solutions, see solution_cache_directory().
+    std::string cache_directory;
 };
 
 /// @brief Details about a solved system of equations.
 struct solved_systyem_t {
+    /// Intermediate values of the elimination, computed in order before the
+    /// solved equations, empty for closed-form solutions.
+    equation_set_t elimination;
     /// The solved set of equations.
     equation_set_t equations;
+    /// The number of solved equations of each block, in order.
+    std::vector<std::size_t> blocks;
+    /// How the algorithm of each block solved in closed form was chosen.
+    std::vector<solver_choice_t> choices;
     /// Support equations for the solved set.
     equation_set_t support;
     /// The list of support values.
     value_list_t values;
+    /// The symbol replacement applied to the equations before solving them.
+    GiNaC::exmap replacement;
+};
+
+/// @brief The solution of a single block, kept by the model so that
+/// resolve() can reuse it while the block does not change.
+struct solved_block_t {
+    /// Intermediate values of the elimination.
+    equation_set_t elimination;
+    /// The solved equations, one for each unknown of the block.
+    equation_set_t equations;
+    /// If every equation is needed, as in the back substitution of an
+    /// elimination.
+    bool complete = false;
 };
 
 /// @brief An analog model.
@@ -56,8 +125,49 @@ public:
     analog_model_t();
 
     /// @brief runs the solver.
-    /// @return the solved set of equations.
-    void run_solver(const GiNaC::exmap &replacement = GiNaC::exmap());
+    /// @param replacement symbol replacement.
+    /// @param options the options of the solver.
+    void run_solver(const GiNaC::exmap &replacement = GiNaC::exmap(), const solver_options_t &options = solver_options_t());
+
+    /// @brief Solves the system again after it has been edited, through the
+    /// functions below. Only Kirchhoff's flow law of the nodes whose edges
+    /// changed is computed again, the potential law only if the edges
+    /// changed, and the blocks of the system which did not change reuse the
+    /// solution of the previous call. Runs the solver from scratch if it has
+    /// never been run.
+    /// @param replacement symbol replacement.
+    /// @param options the options of the solver.
+    void resolve(const GiNaC::exmap &replacement = GiNaC::exmap(), const solver_options_t &options = solver_options_t());
+
+    /// @brief Adds an equation to the system.
+    /// @param e the equation.
+    /// @return true if the equation was added.
+    bool add_equation(const GiNaC::ex &e);
+
+    /// @brief Removes an equation from the system, together with the support
+    /// equations and values of its integrals and derivatives.
+    /// @param e the equation, as it was added.
+    /// @return true if the equation was found.
+    bool remove_equation(const GiNaC::ex &e);
+
+    /// @brief Replaces an equation of the system. The system does not change
+    /// if the new equation is rejected.
+    /// @param previous the equation to replace, as it was added.
+    /// @param e the new equation.
+    /// @return true if the equation was found, and the new one added.
+    bool replace_equation(const GiNaC::ex &previous, const GiNaC::ex &e);
+
+    /// @brief Adds an edge to the circuit, with its potential and its flow
+    /// as unknowns. Its equation must be added too.
+    /// @param edge the edge.
+    void add_edge(const edge_t &edge);
+
+    /// @brief Removes an edge from the circuit, with its unknowns and the
+    /// nodes left without edges. The equations which read its potential or
+    /// its flow must be removed, or replaced, too.
+    /// @param edge the edge.
+    /// @return true if the edge was found.
+    bool remove_edge(const edge_t &edge);
 
     /// @brief Streams operator for an analog model.
     friend std::ostream &operator<<(std::ostream &lhs, const analog_model_t &rhs);
@@ -144,6 +254,22 @@ protected:
         unknowns(args...);
     }
 
+    /// @brief Marks an unknown as an output of the model. When there are
+    /// outputs, the solver computes only them and the unknowns they, or the
+    /// support equations, depend on.
+    /// @param sym the symbol.
+    void outputs(const GiNaC::symbol &sym);
+
+    /// @brief Marks a set of unknowns as outputs of the model.
+    /// @param sym the symbol.
+    /// @param args the other outputs.
+    template <typename... Args>
+    void outputs(const GiNaC::symbol &sym, Args... args)
+    {
+        outputs(sym);
+        outputs(args...);
+    }
+
     /// @brief Registers a value in the system.
     /// @param value the value we want to register.
     void values(const value_t &value);
@@ -158,6 +284,21 @@ protected:
         values(args...);
     }
 
+    /// @brief Registers an input of the system, i.e., a value which changes
+    /// during the simulation (e.g., the voltage of a source).
+    /// @param value the value we want to register.
+    void inputs(const value_t &value);
+
+    /// @brief Registers an input of the system.
+    /// @param value the value we want to register.
+    /// @param args the other inputs.
+    template <typename... Args>
+    void inputs(const value_t &value, Args... args)
+    {
+        inputs(value);
+        inputs(args...);
+    }
+
     /// @brief Replaces the symbols inside the equations.
     /// @param equations the equations to edit.
     /// @param replacement the replacement for symbols.
@@ -171,6 +312,22 @@ private:
     structure_t structure;
     /// @brief Solution to the system of equations.
     solved_systyem_t solution;
+    /// @brief Kirchhoff's flow law of each node, by name.
+    std::map<std::string, GiNaC::ex> kfl_rows;
+    /// @brief The nodes whose edges changed since compute_kfl().
+    std::set<std::string> touched_nodes;
+    /// @brief If the edges changed since compute_kpl().
+    bool kpl_outdated;
+    /// @brief If the solver has been run, and the system is set up.
+    bool is_setup;
+    /// @brief The solution of each block, reused while it does not change.
+    std::map<std::string, solved_block_t> solved_blocks;
+    /// @brief The names of the support values, in the order idt() and ddt()
+    /// created them, which are given again by the next setup(), so that the
+    /// blocks reading them keep their key.
+    std::vector<std::string> support_names;
+    /// @brief The support values created since the last setup().
+    std::size_t support_count;
 
     void __register_node(const node_t &node);
 
@@ -178,14 +335,22 @@ private:
 
     void __register_value(const value_t &value);
 
-    /// @brief
+    /// @brief Returns the name of the next support value, the one it had the
+    /// previous time the model was set up, or a new one.
+    std::string __support_name(const std::string &prefix);
+
+    /// @brief Removes the support equations and values which no equation
+    /// reads anymore, e.g., the ones created for a removed equation.
+    void __remove_unused_support();
+
+    /// @brief Computes Kirchhoff's flow law of the nodes whose edges changed.
     void compute_kfl();
 
-    /// @brief
+    /// @brief Computes Kirchhoff's potential law, if the edges changed.
     void compute_kpl();
 
     /// @brief Solves the system of equations.
-    void solve(const GiNaC::exmap &replacement = GiNaC::exmap());
+    void solve(const GiNaC::exmap &replacement, const solver_options_t &options);
 };
 
 } // namespace symsolbin
\ No newline at end of file
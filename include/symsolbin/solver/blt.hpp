@@ -0,0 +1,33 @@
+/// @file blt.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Block-lower-triangular decomposition of a system of equations.
+
+#pragma once
+
+#include "symsolbin/solver/ginac_helper.hpp"
+
+namespace symsolbin
+{
+
+/// @brief A block of equations which must be solved together.
+struct blt_block_t {
+    /// The equations of the block.
+    equation_set_t equations;
+    /// The unknowns computed by the block.
+    std::vector<GiNaC::symbol> unknowns;
+};
+
+/// @brief Splits the system into the blocks of its block-lower-triangular
+/// form: each equation is matched to the unknown it computes, and the
+/// strongly connected components of the resulting dependency graph become
+/// the blocks. Each block reads only its own unknowns and the ones of the
+/// blocks which precede it.
+/// @param equations the equations.
+/// @param unknowns the unknowns.
+/// @param blocks the blocks, in evaluation order.
+/// @return true on success, false if the system is structurally singular.
+bool blt_decompose(const equation_set_t &equations,
+                   const std::vector<GiNaC::symbol> &unknowns,
+                   std::vector<blt_block_t> &blocks);
+
+} // namespace symsolbin
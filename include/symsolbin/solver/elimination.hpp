@@ -0,0 +1,58 @@
+/// @file elimination.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Symbolic Gaussian elimination, recorded as a sequence of steps,
+/// and a sparse fraction-free solver.
+
+#pragma once
+
+#include "symsolbin/solver/ginac_helper.hpp"
+
+namespace symsolbin
+{
+
+/// @brief The steps of a symbolic Gaussian elimination.
+struct elimination_t {
+    /// The intermediate values, `temporary == expression`, in the order in
+    /// which they must be computed. Each expression reads only the
+    /// coefficients of the system and the previous intermediate values.
+    equation_set_t temporaries;
+    /// The unknowns, `unknown == expression`, in back-substitution order,
+    /// i.e., each expression reads the intermediate values and the unknowns
+    /// which precede it.
+    equation_set_t equations;
+};
+
+/// @brief Solves the linear system through a Gaussian elimination, where
+/// every updated entry of the matrix is stored inside an intermediate value
+/// instead of being expanded. The size of the result grows polynomially with
+/// the size of the system, while the closed form computed by GiNaC::lsolve
+/// grows combinatorially.
+/// @details The pivots are chosen on the structure of the matrix alone:
+/// numbers first, then the coefficients of the system, and the intermediate
+/// values last. An intermediate value which is identically zero, e.g.,
+/// `r - r` spread across several steps, is not detected, so the result may
+/// divide by zero where GiNaC::lsolve would have chosen another pivot. The
+/// same holds for a coefficient which vanishes for the given parameters.
+/// @param equations the equations.
+/// @param unknowns the unknowns.
+/// @param result the recorded steps.
+/// @return true on success, false if the system is singular or not linear.
+bool eliminate(const equation_set_t &equations,
+               const std::vector<GiNaC::symbol> &unknowns,
+               elimination_t &result);
+
+/// @brief Solves the linear system in closed form, like GiNaC::lsolve, with
+/// a fraction-free elimination on the sparse rows of the system. The pivots
+/// follow the Markowitz ordering, which keeps the fill-in low and does not
+/// depend on the order of the unknowns. Each row is scaled to polynomial
+/// entries, and divided by their greatest common divisor after every update.
+/// @param equations the equations.
+/// @param unknowns the unknowns.
+/// @param result the unknowns, `unknown == expression`, where each expression
+/// reads only the coefficients of the system.
+/// @return true on success, false if the system is singular or not linear.
+bool sparse_solve(const equation_set_t &equations,
+                  const std::vector<GiNaC::symbol> &unknowns,
+                  equation_set_t &result);
+
+} // namespace symsolbin
@@ -87,6 +87,54 @@ inline equation_set_t split_solved(const GiNaC::ex &equations)
     return set;
 }
 
+/// @brief Builds the matrices `A x = b` of a linear system of equations.
+/// @param equations the equations.
+/// @param symbols the unknowns.
+/// @param A the coefficients of the unknowns.
+/// @param b the right-hand side.
+/// @return false if the system is not linear in the unknowns, i.e., if an
+/// entry of A or b still contains one of them.
+inline bool matrix_from_equations(const equation_set_t &equations,
+                                  const std::vector<GiNaC::symbol> &symbols,
+                                  GiNaC::matrix &A,
+                                  GiNaC::matrix &b)
+{
+    unsigned equ_size = static_cast<unsigned>(equations.size());
+    unsigned sym_size = static_cast<unsigned>(symbols.size());
+
+    // build matrix from equation system
+    GiNaC::matrix sys(equ_size, sym_size);
+    GiNaC::matrix rhs(equ_size, 1);
+
+    // Checks if an expression contains one of the unknowns.
+    auto has_unknowns = [&symbols](const GiNaC::ex &e) {
+        for (const auto &symbol : symbols)
+            if (e.has(symbol))
+                return true;
+        return false;
+    };
+    for (unsigned r = 0; r < equ_size; r++) {
+        // lhs-rhs==0, expanded so that coeff() sees every term, e.g., of
+        // R * (F1 + F2).
+        const GiNaC::ex eq = (equations[r].op(0) - equations[r].op(1)).expand();
+        GiNaC::ex linpart  = eq;
+        for (unsigned c = 0; c < sym_size; c++) {
+            const GiNaC::ex co = eq.coeff(symbols[c], 1);
+            if (has_unknowns(co))
+                return false;
+            linpart -= co * symbols[c];
+            sys(r, c) = co;
+        }
+        linpart = linpart.expand();
+        if (has_unknowns(linpart))
+            return false;
+        rhs(r, 0) = -linpart;
+    }
+    A = sys;
+    b = rhs;
+    return true;
+}
+
 } // namespace ginac_helper
 
 } // namespace symsolbin
\ No newline at end of file
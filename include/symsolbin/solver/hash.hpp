@@ -0,0 +1,71 @@
+/// @file hash.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Stable hash used to name cached files.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace symsolbin
+{
+
+/// @brief Incremental 64-bit FNV-1a hash. Unlike std::hash, its value does
+/// not change between runs, compilers, or platforms.
+class hash_t {
+public:
+    /// @brief Constructor.
+    hash_t()
+        : _value(14695981039346656037ULL)
+    {
+        // Nothing to do.
+    }
+
+    /// @brief Adds the given bytes to the hash.
+    /// @param data the bytes.
+    /// @param size the number of bytes.
+    /// @return a reference to this hash.
+    inline hash_t &update(const void *data, std::size_t size)
+    {
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            _value ^= bytes[i];
+            _value *= 1099511628211ULL;
+        }
+        return *this;
+    }
+
+    /// @brief Adds a string to the hash, preceded by its length, so that
+    /// ("ab", "c") and ("a", "bc") give different hashes.
+    /// @param data the string.
+    /// @return a reference to this hash.
+    inline hash_t &update(const std::string &data)
+    {
+        std::uint64_t size = data.size();
+        this->update(&size, sizeof(size));
+        return this->update(data.data(), data.size());
+    }
+
+    /// @brief Returns the value of the hash.
+    inline std::uint64_t value() const
+    {
+        return _value;
+    }
+
+    /// @brief Returns the value of the hash as 16 hexadecimal digits.
+    inline std::string str() const
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string result(16, '0');
+        for (std::size_t i = 0; i < 16; ++i)
+            result[15 - i] = digits[(_value >> (4 * i)) & 0xF];
+        return result;
+    }
+
+private:
+    /// The current value.
+    std::uint64_t _value;
+};
+
+} // namespace symsolbin
@@ -4,30 +4,32 @@
 
 #pragma once
 
-#include <string>
 #include <map>
+#include <set>
+#include <string>
 
 namespace symsolbin::name_gen
 {
 
-/// @brief Randomizes the name.
+/// @brief Generates a unique name, by appending to the prefix the number of
+/// names generated with the same prefix so far (e.g., a0, a1, a2, ...). The
+/// names depend only on the order of the calls, so a model builds the same
+/// names in every run. The function is not static, so that every translation
+/// unit shares the same counters.
 /// @param prefix the prefix of the name.
-/// @return a random, but unique name.
-static inline std::string get_name(std::string const &prefix)
+/// @return a unique name.
+inline std::string get_name(std::string const &prefix)
 {
-    // Keeps track of used name.
-    static std::map<std::string, bool> used;
-    // We add postfix at the end of the prefix to make unique names (e.g., a1,
-    // a2, a3, ...).
-    long long int postfix = 0;
-    // The unique lable we are generating.
-    std::string label = prefix + std::to_string(postfix);
-    // Keep generating label until we find an unused one.
-    while (used[label]) {
-        label = prefix + std::to_string(postfix++);
-    }
-    // Set the label as used.
-    used[label] = true;
+    // The next number of each prefix.
+    static std::map<std::string, long long int> next;
+    // Keeps track of used names, since a prefix followed by a number can be
+    // another prefix (e.g., a1 and 1 against a and 11).
+    static std::set<std::string> used;
+    // The unique label we are generating.
+    std::string label;
+    do {
+        label = prefix + std::to_string(next[prefix]++);
+    } while (!used.insert(label).second);
     return label;
 }
 
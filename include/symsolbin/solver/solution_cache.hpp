@@ -0,0 +1,82 @@
+/// @file solution_cache.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Persistent cache of the solutions, keyed by a canonical hash of
+/// the system they solve.
+
+#pragma once
+
+#include "symsolbin/solver/analog_model.hpp"
+
+#include <string>
+
+namespace symsolbin
+{
+
+/// @brief Returns the directory where the solutions are cached: the one
+/// inside the options or, if empty, `$SYMSOLBIN_SOLVER_CACHE`,
+/// `$XDG_CACHE_HOME/symsolbin/solutions`, or
+/// `$HOME/.cache/symsolbin/solutions`, in this order.
+/// @param options the options of the solver.
+/// @return the directory, or an empty string if none is set, in which case
+/// the cache is disabled.
+std::string solution_cache_directory(const solver_options_t &options);
+
+/// @brief Computes the key of the solution of a system. The key does not
+/// depend on the order of the equations, unknowns, outputs, values and
+/// replacements, nor on the order of the operands inside the expressions,
+/// nor on the numbers that name_gen appended to the support values, so that
+/// it stays the same between runs.
+/// @param equations the equations, Kirchhoff's laws included, after the
+/// replacement.
+/// @param system the system, only its unknowns, outputs, values and inputs
+/// are read.
+/// @param solution the solution, only its support equations and values are
+/// read.
+/// @param replacement the replacement applied to the equations.
+/// @param options the options of the solver.
+/// @return the key, as 16 hexadecimal digits.
+std::string solution_key(const equation_set_t &equations,
+                         const system_t &system,
+                         const solved_systyem_t &solution,
+                         const GiNaC::exmap &replacement,
+                         const solver_options_t &options);
+
+/// @brief Loads a cached solution.
+/// @param directory the cache directory.
+/// @param key the key of the solution.
+/// @param equations the equations, whose symbols are shared with the
+/// solution.
+/// @param system the system, only its unknowns are read.
+/// @param solution where the solved equations are stored, its support
+/// equations and values must already be set.
+/// @return true on a cache hit.
+bool load_solution(const std::string &directory,
+                   const std::string &key,
+                   const equation_set_t &equations,
+                   const system_t &system,
+                   solved_systyem_t &solution);
+
+/// @brief Stores a solution inside the cache.
+/// @param directory the cache directory, created if missing.
+/// @param key the key of the solution.
+/// @param solution the solution.
+/// @return true on success.
+bool store_solution(const std::string &directory, const std::string &key, const solved_systyem_t &solution);
+
+/// @brief Loads the algorithm which won the race on the systems with the
+/// given structure, see tune_algorithm().
+/// @param directory the cache directory.
+/// @param hash the structural hash of the system.
+/// @param algorithm the algorithm, see GiNaC::solve_algo.
+/// @return true if a winner was stored.
+bool load_winner(const std::string &directory, const std::string &hash, unsigned &algorithm);
+
+/// @brief Stores the algorithm which won the race on the systems with the
+/// given structure, next to the cached solutions.
+/// @param directory the cache directory, created if missing.
+/// @param hash the structural hash of the system.
+/// @param algorithm the algorithm, see GiNaC::solve_algo.
+/// @return true on success.
+bool store_winner(const std::string &directory, const std::string &hash, unsigned algorithm);
+
+} // namespace symsolbin
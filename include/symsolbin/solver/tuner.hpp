@@ -0,0 +1,110 @@
+/// @file tuner.hpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Chooses the algorithm used by GiNaC to solve a system, from its
+/// shape or by racing the algorithms against each other.
+
+#pragma once
+
+#include "symsolbin/solver/ginac_helper.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace symsolbin
+{
+
+/// @brief How the algorithm used by GiNaC is chosen.
+enum class solver_tuning_t {
+    /// The algorithm set inside the options is always used.
+    none,
+    /// The algorithm is predicted from the shape of the system, see
+    /// predict_algorithm().
+    predict,
+    /// Every algorithm solves the system inside its own process, one after
+    /// the other, and the solution of the fastest one is used. The winner is
+    /// remembered for the systems with the same structure, which are not
+    /// raced again, inside the process and, if the solutions are cached, on
+    /// disk.
+    race
+};
+
+/// @brief The shape of a linear system.
+struct system_shape_t {
+    /// The number of unknowns.
+    std::size_t size = 0;
+    /// The number of non-zero coefficients.
+    std::size_t nonzeros = 0;
+    /// The number of coefficients which are not numbers.
+    std::size_t symbolic = 0;
+    /// The highest degree of a symbol inside a coefficient.
+    int degree = 0;
+
+    /// @brief Returns the fraction of coefficients which are not zero.
+    inline double density() const
+    {
+        return (size > 0) ? (static_cast<double>(nonzeros) / static_cast<double>(size * size)) : 0.0;
+    }
+};
+
+/// @brief How the algorithm of a system was chosen.
+struct solver_choice_t {
+    /// The block of the system, in evaluation order.
+    std::size_t block = 0;
+    /// The shape of the block.
+    system_shape_t shape;
+    /// The chosen algorithm, see GiNaC::solve_algo.
+    unsigned algorithm = GiNaC::solve_algo::automatic;
+    /// If the choice comes from a previous race on the same structure.
+    bool remembered = false;
+    /// The seconds taken by each algorithm of the race, negative if it
+    /// failed, ran out of time, or was slower than the winner; empty if there
+    /// was no race.
+    std::vector<std::pair<unsigned, double>> timings;
+    /// The solution computed by the winner of the race, so that the system is
+    /// not solved again; empty if there was no race or nobody won it.
+    equation_set_t solution;
+};
+
+/// @brief Returns the name of an algorithm, e.g., `markowitz`.
+/// @param algorithm the algorithm, see GiNaC::solve_algo.
+/// @return the name.
+const char *algorithm_name(unsigned algorithm);
+
+/// @brief Measures the shape of a linear system.
+/// @param equations the equations.
+/// @param unknowns the unknowns.
+/// @return the shape.
+system_shape_t measure_shape(const equation_set_t &equations, const std::vector<GiNaC::symbol> &unknowns);
+
+/// @brief Predicts the fastest algorithm for a system: Gaussian elimination
+/// when every coefficient is a number, Markowitz for the sparse systems,
+/// Bareiss when the coefficients have a high degree, and the division-free
+/// elimination otherwise.
+/// @param shape the shape of the system.
+/// @return the algorithm, see GiNaC::solve_algo.
+unsigned predict_algorithm(const system_shape_t &shape);
+
+/// @brief Chooses the algorithm for a system.
+/// @details Since GiNaC is not thread-safe, and a solve cannot be
+/// interrupted, each algorithm of a race runs inside a forked process, which
+/// is killed once it exceeds the budget, or the time of the fastest one so
+/// far. The algorithms run one at a time, starting from the predicted one,
+/// so that they do not compete for the processor. When all of them fail, or
+/// run out of time, the predicted algorithm is used.
+/// @param equations the equations.
+/// @param unknowns the unknowns.
+/// @param tuning how the algorithm is chosen.
+/// @param fallback the algorithm used when tuning is none.
+/// @param budget the seconds each algorithm of a race can run.
+/// @param directory the directory where the winners are stored, see
+/// load_winner(); if empty, they are remembered only by this process.
+/// @return the choice.
+solver_choice_t tune_algorithm(const equation_set_t &equations,
+                               const std::vector<GiNaC::symbol> &unknowns,
+                               solver_tuning_t tuning,
+                               unsigned fallback,
+                               double budget,
+                               const std::string &directory = std::string());
+
+} // namespace symsolbin
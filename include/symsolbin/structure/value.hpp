@@ -38,6 +38,18 @@ public:
         return *this;
     }
 
+    /// @brief Returns the GiNaC symbol of the value.
+    inline const GiNaC::symbol &get_symbol() const
+    {
+        return _symbol;
+    }
+
+    /// @brief Returns the name of the value.
+    inline std::string get_name() const
+    {
+        return _symbol.get_name();
+    }
+
     /// @brief Returns the stored numerical value.
     inline double get_value() const
     {
@@ -61,6 +73,36 @@ public:
         return _replace;
     }
 
+    /// @brief Sets the range of values the variable takes at runtime, used
+    /// to choose the scaling of the fixed-point code.
+    /// @param min the lowest value.
+    /// @param max the highest value.
+    /// @return a reference to this value.
+    inline value_t &set_range(double min, double max)
+    {
+        _min = min;
+        _max = max;
+        return *this;
+    }
+
+    /// @brief Checks if the range of the value has been set.
+    inline bool has_range() const
+    {
+        return _min < _max;
+    }
+
+    /// @brief Returns the lowest value of the range.
+    inline double get_min() const
+    {
+        return _min;
+    }
+
+    /// @brief Returns the highest value of the range.
+    inline double get_max() const
+    {
+        return _max;
+    }
+
     /// @brief Multiplies an expression by the value.
     inline friend GiNaC::ex operator*(const GiNaC::ex &lhs, const value_t &rhs)
     {
@@ -153,6 +195,10 @@ private:
     double _value;
     /// @brief If we need to replace the symbol with the numerical value.
     bool _replace;
+    /// @brief The lowest value taken at runtime.
+    double _min;
+    /// @brief The highest value taken at runtime.
+    double _max;
 };
 
 /// A list of values.
@@ -0,0 +1,695 @@
+/// @file expression_dag.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief
+
+#include "symsolbin/model/expression_dag.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+
+namespace symsolbin
+{
+
+/// @brief Checks if the GiNaC expression is printed with a leading minus.
+static inline bool __is_negative(const GiNaC::ex &e)
+{
+    if (GiNaC::is_a<GiNaC::numeric>(e))
+        return GiNaC::ex_to<GiNaC::numeric>(e).is_negative();
+    if (GiNaC::is_a<GiNaC::mul>(e)) {
+        for (std::size_t i = 0; i < e.nops(); ++i)
+            if (GiNaC::is_a<GiNaC::numeric>(e.op(i)) && GiNaC::ex_to<GiNaC::numeric>(e.op(i)).is_negative())
+                return true;
+    }
+    return false;
+}
+
+/// @brief Collects the degree of each symbol inside a monomial.
+/// @return false if the expression is not a monomial.
+static inline bool __monomial_degrees(const GiNaC::ex &e, std::map<GiNaC::ex, int, GiNaC::ex_is_less> &degrees)
+{
+    if (GiNaC::is_a<GiNaC::numeric>(e))
+        return true;
+    if (GiNaC::is_a<GiNaC::symbol>(e)) {
+        degrees[e] = std::max(degrees[e], 1);
+        return true;
+    }
+    if (GiNaC::is_a<GiNaC::power>(e)) {
+        if (!GiNaC::is_a<GiNaC::symbol>(e.op(0)) || !GiNaC::is_a<GiNaC::numeric>(e.op(1)))
+            return false;
+        const GiNaC::numeric &exponent = GiNaC::ex_to<GiNaC::numeric>(e.op(1));
+        if (!exponent.is_pos_integer())
+            return false;
+        degrees[e.op(0)] = std::max(degrees[e.op(0)], exponent.to_int());
+        return true;
+    }
+    if (GiNaC::is_a<GiNaC::mul>(e)) {
+        for (std::size_t i = 0; i < e.nops(); ++i)
+            if (GiNaC::is_a<GiNaC::mul>(e.op(i)) || !__monomial_degrees(e.op(i), degrees))
+                return false;
+        return true;
+    }
+    return false;
+}
+
+/// @brief Selects the variable used to write an expanded polynomial in Horner
+/// form, i.e., the one with the highest degree.
+/// @return false if the expression is not an expanded polynomial of degree
+/// two or more.
+static inline bool __horner_variable(const GiNaC::ex &e, GiNaC::ex &variable, int &degree)
+{
+    std::map<GiNaC::ex, int, GiNaC::ex_is_less> degrees;
+    for (std::size_t i = 0; i < e.nops(); ++i)
+        if (!__monomial_degrees(e.op(i), degrees))
+            return false;
+    degree = 1;
+    for (const auto &it : degrees) {
+        if (it.second > degree) {
+            variable = it.first;
+            degree   = it.second;
+        }
+    }
+    return degree > 1;
+}
+
+expression_dag_t::expression_dag_t()
+    : _nodes(),
+      _index(),
+      _versions(),
+      _lowered(),
+      _statements(),
+      _definitions(),
+      _stages(),
+      _horner()
+{
+    // Nothing to do.
+}
+
+std::size_t expression_dag_t::__insert(dag_node_t node)
+{
+    key_t key(node.op, node.args, node.value, node.name, node.version);
+    auto it = _index.find(key);
+    if (it != _index.end())
+        return it->second;
+    // Compute what the node depends on.
+    if (node.op == dag_op_t::symbol) {
+        auto stage = _stages.find(node.name);
+        node.stage = (stage == _stages.end()) ? dag_stage_t::state : stage->second;
+    } else {
+        node.stage = dag_stage_t::constant;
+        for (std::size_t arg : node.args)
+            node.stage = std::max(node.stage, _nodes[arg].stage);
+    }
+    _nodes.emplace_back(std::move(node));
+    _index[key] = _nodes.size() - 1;
+    return _nodes.size() - 1;
+}
+
+std::size_t expression_dag_t::constant(double value)
+{
+    return this->__insert(dag_node_t{ dag_op_t::constant, {}, value, std::string(), 0, dag_stage_t::constant });
+}
+
+std::size_t expression_dag_t::symbol(const std::string &name)
+{
+    auto definition = _definitions.find(name);
+    if (definition != _definitions.end())
+        return definition->second;
+    return this->__insert(dag_node_t{ dag_op_t::symbol, {}, .0, name, _versions[name], dag_stage_t::state });
+}
+
+std::size_t expression_dag_t::make(dag_op_t op, std::vector<std::size_t> args, double value, const std::string &name)
+{
+    // Summations and multiplications are commutative, sort their operands so
+    // that the same terms in a different order are shared.
+    if ((op == dag_op_t::add) || (op == dag_op_t::mul))
+        std::sort(args.begin(), args.end());
+    return this->__insert(dag_node_t{ op, std::move(args), value, name, 0, dag_stage_t::constant });
+}
+
+std::size_t expression_dag_t::lower(const GiNaC::ex &e)
+{
+    auto it = _lowered.find(e);
+    if (it != _lowered.end())
+        return it->second;
+    std::size_t node;
+    GiNaC::ex variable;
+    int degree = 0;
+    if (GiNaC::is_a<GiNaC::numeric>(e)) {
+        double value = GiNaC::ex_to<GiNaC::numeric>(e).to_double();
+        if (value < 0)
+            node = this->make(dag_op_t::neg, { this->constant(-value) });
+        else
+            node = this->constant(value);
+    } else if (GiNaC::is_a<GiNaC::symbol>(e)) {
+        node = this->symbol(GiNaC::ex_to<GiNaC::symbol>(e).get_name());
+    } else if (GiNaC::is_a<GiNaC::constant>(e)) {
+        node = this->constant(GiNaC::ex_to<GiNaC::numeric>(e.evalf()).to_double());
+    } else if (GiNaC::is_a<GiNaC::add>(e) && _horner && __horner_variable(e, variable, degree)) {
+        node = this->__lower_horner(e, variable, degree);
+    } else if (GiNaC::is_a<GiNaC::add>(e)) {
+        node = this->__lower_add(e);
+    } else if (GiNaC::is_a<GiNaC::mul>(e)) {
+        node = this->__lower_mul(e);
+    } else if (GiNaC::is_a<GiNaC::power>(e)) {
+        const GiNaC::ex &basis = e.op(0), &exponent = e.op(1);
+        if (GiNaC::is_a<GiNaC::numeric>(exponent) && GiNaC::ex_to<GiNaC::numeric>(exponent).is_integer()) {
+            int n = GiNaC::ex_to<GiNaC::numeric>(exponent).to_int();
+            if (n < 0)
+                node = this->make(dag_op_t::div, { this->constant(1.0), this->lower(GiNaC::pow(basis, -n)) });
+            else
+                node = this->make(dag_op_t::pow, { this->lower(basis) }, n);
+        } else if (exponent.is_equal(GiNaC::numeric(1) / 2)) {
+            node = this->make(dag_op_t::call, { this->lower(basis) }, .0, "sqrt");
+        } else {
+            node = this->make(dag_op_t::call, { this->lower(basis), this->lower(exponent) }, .0, "pow");
+        }
+    } else if (GiNaC::is_a<GiNaC::function>(e)) {
+        std::vector<std::size_t> args;
+        for (std::size_t i = 0; i < e.nops(); ++i)
+            args.emplace_back(this->lower(e.op(i)));
+        node = this->make(dag_op_t::call, args, .0, GiNaC::ex_to<GiNaC::function>(e).get_name());
+    } else {
+        // Keep whatever GiNaC prints for it, as an opaque variable.
+        std::stringstream ss;
+        ss << GiNaC::csrc_double << e;
+        std::cerr << "expression_dag_t: GiNaC expression not handled `" << e << "`...\n";
+        node = this->__insert(dag_node_t{ dag_op_t::symbol, {}, .0, ss.str(), 0, dag_stage_t::state });
+    }
+    _lowered[e] = node;
+    return node;
+}
+
+std::size_t expression_dag_t::__lower_add(const GiNaC::ex &e)
+{
+    // Split the terms between positive and negative ones, so that we print
+    // `a - b` instead of `a + -b`, and group them by stage, so that the terms
+    // of the earlier stages are summed first, e.g., `(r0 + r1) + x`.
+    std::map<dag_stage_t, std::pair<std::vector<std::size_t>, std::vector<std::size_t>>> stages;
+    for (std::size_t i = 0; i < e.nops(); ++i) {
+        if (__is_negative(e.op(i))) {
+            std::size_t term = this->lower(-e.op(i));
+            stages[_nodes[term].stage].second.emplace_back(term);
+        } else {
+            std::size_t term = this->lower(e.op(i));
+            stages[_nodes[term].stage].first.emplace_back(term);
+        }
+    }
+    // Sum the terms stage by stage, from the earliest one.
+    bool first         = true;
+    std::size_t result = 0;
+    for (auto &stage : stages) {
+        auto &positive = stage.second.first;
+        auto &negative = stage.second.second;
+        if (!first)
+            positive.insert(positive.begin(), result);
+        first = false;
+        std::size_t pos = 0, neg = 0;
+        if (!positive.empty())
+            pos = (positive.size() == 1) ? positive.front() : this->make(dag_op_t::add, positive);
+        if (!negative.empty())
+            neg = (negative.size() == 1) ? negative.front() : this->make(dag_op_t::add, negative);
+        if (positive.empty())
+            result = this->make(dag_op_t::neg, { neg });
+        else if (negative.empty())
+            result = pos;
+        else
+            result = this->make(dag_op_t::sub, { pos, neg });
+    }
+    return result;
+}
+
+std::size_t expression_dag_t::__lower_mul(const GiNaC::ex &e)
+{
+    if (__is_negative(e))
+        return this->make(dag_op_t::neg, { this->lower(-e) });
+    // Split the factors between numerator and denominator, grouped by stage.
+    std::map<dag_stage_t, std::pair<std::vector<std::size_t>, std::vector<std::size_t>>> stages;
+    for (std::size_t i = 0; i < e.nops(); ++i) {
+        const GiNaC::ex &factor = e.op(i);
+        if (GiNaC::is_a<GiNaC::power>(factor) && __is_negative(factor.op(1))) {
+            std::size_t den = this->lower(GiNaC::pow(factor.op(0), -factor.op(1)));
+            stages[_nodes[den].stage].second.emplace_back(den);
+        } else {
+            std::size_t num = this->lower(factor);
+            stages[_nodes[num].stage].first.emplace_back(num);
+        }
+    }
+    // Multiply the factors stage by stage, from the earliest one.
+    bool first         = true;
+    std::size_t result = 0;
+    for (auto &stage : stages) {
+        auto &numerator   = stage.second.first;
+        auto &denominator = stage.second.second;
+        if (!first)
+            numerator.insert(numerator.begin(), result);
+        first = false;
+        std::size_t num, den = 0;
+        if (numerator.empty())
+            num = this->constant(1.0);
+        else
+            num = (numerator.size() == 1) ? numerator.front() : this->make(dag_op_t::mul, numerator);
+        if (!denominator.empty())
+            den = (denominator.size() == 1) ? denominator.front() : this->make(dag_op_t::mul, denominator);
+        result = denominator.empty() ? num : this->make(dag_op_t::div, { num, den });
+    }
+    return result;
+}
+
+std::size_t expression_dag_t::__lower_horner(const GiNaC::ex &e, const GiNaC::ex &variable, int degree)
+{
+    // c_n x^n + ... + c_1 x + c_0 = (...(c_n x + c_n-1) x + ...) x + c_0,
+    // where the coefficients are lowered (and rewritten) recursively.
+    std::size_t x      = this->lower(variable);
+    std::size_t result = this->lower(e.coeff(variable, degree));
+    int gap            = 0;
+    for (int k = degree - 1; k >= 0; --k) {
+        ++gap;
+        GiNaC::ex coefficient = e.coeff(variable, k);
+        if (coefficient.is_zero())
+            continue;
+        std::size_t product = this->make(dag_op_t::mul, { result, (gap == 1) ? x : this->make(dag_op_t::pow, { x }, gap) });
+        if (__is_negative(coefficient))
+            result = this->make(dag_op_t::sub, { product, this->lower(-coefficient) });
+        else
+            result = this->make(dag_op_t::add, { product, this->lower(coefficient) });
+        gap = 0;
+    }
+    if (gap > 0)
+        result = this->make(dag_op_t::mul, { result, (gap == 1) ? x : this->make(dag_op_t::pow, { x }, gap) });
+    return result;
+}
+
+void expression_dag_t::assign(const std::string &target, const GiNaC::ex &e)
+{
+    this->assign(target, this->lower(e));
+}
+
+void expression_dag_t::assign(const std::string &target, std::size_t node)
+{
+    _statements.emplace_back(dag_statement_t{ target, node });
+    // From now on, reads of the target refer to a new value.
+    ++_versions[target];
+    _lowered.clear();
+}
+
+void expression_dag_t::define(const std::string &name, const GiNaC::ex &e)
+{
+    std::size_t node = this->lower(e);
+    _definitions[name] = node;
+    _lowered.clear();
+}
+
+std::vector<unsigned> expression_dag_t::count_uses() const
+{
+    std::vector<unsigned> uses(_nodes.size(), 0);
+    std::vector<bool> visited(_nodes.size(), false);
+    std::vector<std::size_t> stack;
+    for (const auto &statement : _statements) {
+        ++uses[statement.node];
+        stack.emplace_back(statement.node);
+        while (!stack.empty()) {
+            std::size_t node = stack.back();
+            stack.pop_back();
+            if (visited[node])
+                continue;
+            visited[node] = true;
+            for (std::size_t arg : _nodes[node].args) {
+                ++uses[arg];
+                stack.emplace_back(arg);
+            }
+        }
+    }
+    return uses;
+}
+
+std::set<std::string> expression_dag_t::reads(std::size_t node) const
+{
+    std::set<std::string> names;
+    std::vector<bool> visited(_nodes.size(), false);
+    std::vector<std::size_t> stack = { node };
+    while (!stack.empty()) {
+        std::size_t current = stack.back();
+        stack.pop_back();
+        if (visited[current])
+            continue;
+        visited[current] = true;
+        if (_nodes[current].op == dag_op_t::symbol)
+            names.insert(_nodes[current].name);
+        stack.insert(stack.end(), _nodes[current].args.begin(), _nodes[current].args.end());
+    }
+    return names;
+}
+
+std::set<std::string> expression_dag_t::variables() const
+{
+    auto uses = this->count_uses();
+    std::set<std::string> names;
+    for (std::size_t node = 0; node < _nodes.size(); ++node)
+        if ((uses[node] > 0) && (_nodes[node].op == dag_op_t::symbol))
+            names.insert(_nodes[node].name);
+    for (const auto &statement : _statements)
+        names.insert(statement.target);
+    return names;
+}
+
+std::set<std::string> expression_dag_t::functions() const
+{
+    auto uses = this->count_uses();
+    std::set<std::string> names;
+    for (std::size_t node = 0; node < _nodes.size(); ++node)
+        if ((uses[node] > 0) && (_nodes[node].op == dag_op_t::call))
+            names.insert(_nodes[node].name);
+    return names;
+}
+
+void expression_dag_t::keep_statements(const std::vector<bool> &keep)
+{
+    std::vector<dag_statement_t> statements;
+    for (std::size_t i = 0; i < _statements.size(); ++i)
+        if (keep[i])
+            statements.emplace_back(_statements[i]);
+    _statements = std::move(statements);
+}
+
+cost_report_t expression_dag_t::operations(std::size_t node) const
+{
+    const dag_node_t &n = _nodes[node];
+    cost_report_t cost;
+    switch (n.op) {
+    case dag_op_t::add:
+        cost.adds = n.args.size() - 1;
+        break;
+    case dag_op_t::sub:
+    case dag_op_t::neg:
+        cost.adds = 1;
+        break;
+    case dag_op_t::mul:
+        cost.muls = n.args.size() - 1;
+        break;
+    case dag_op_t::pow:
+        cost.muls = static_cast<std::size_t>(std::abs(n.value)) - 1;
+        break;
+    case dag_op_t::div:
+        cost.divs = 1;
+        break;
+    case dag_op_t::call:
+        cost.calls = 1;
+        break;
+    default:
+        break;
+    }
+    return cost;
+}
+
+cost_report_t expression_dag_t::tree_cost() const
+{
+    // The nodes are created after their operands, so a single forward pass
+    // is enough to compute the size of each tree.
+    std::vector<cost_report_t> cost(_nodes.size());
+    for (std::size_t node = 0; node < _nodes.size(); ++node) {
+        cost[node] = this->operations(node);
+        for (std::size_t arg : _nodes[node].args)
+            cost[node] += cost[arg];
+    }
+    cost_report_t total;
+    for (const auto &statement : _statements)
+        total += cost[statement.node];
+    return total;
+}
+
+cost_report_t expression_dag_t::dag_cost() const
+{
+    auto uses = this->count_uses();
+    cost_report_t total;
+    for (std::size_t node = 0; node < _nodes.size(); ++node)
+        if (uses[node] > 0)
+            total += this->operations(node);
+    return total;
+}
+
+std::vector<std::size_t> expression_dag_t::frontier(dag_stage_t stage) const
+{
+    auto uses = this->count_uses();
+    std::vector<bool> selected(_nodes.size(), false);
+    for (std::size_t node = 0; node < _nodes.size(); ++node) {
+        if ((uses[node] == 0) || (_nodes[node].stage <= stage))
+            continue;
+        for (std::size_t arg : _nodes[node].args)
+            if (_nodes[arg].stage == stage)
+                selected[arg] = true;
+    }
+    for (const auto &statement : _statements)
+        if (_nodes[statement.node].stage == stage)
+            selected[statement.node] = true;
+    std::vector<std::size_t> frontier;
+    for (std::size_t node = 0; node < _nodes.size(); ++node) {
+        // Leaves are read directly.
+        dag_op_t op = _nodes[node].op;
+        if (selected[node] && (op != dag_op_t::symbol) && (op != dag_op_t::constant))
+            frontier.emplace_back(node);
+    }
+    return frontier;
+}
+
+expression_dag_t expression_dag_t::strength_reduce() const
+{
+    auto uses = this->count_uses();
+    // Count the divisions sharing the same denominator.
+    std::vector<unsigned> divisions(_nodes.size(), 0);
+    for (std::size_t node = 0; node < _nodes.size(); ++node)
+        if ((uses[node] > 0) && (_nodes[node].op == dag_op_t::div))
+            ++divisions[_nodes[node].args[1]];
+
+    expression_dag_t dag;
+    dag._versions = _versions;
+    dag._stages   = _stages;
+    dag._horner   = _horner;
+    // Maps the old nodes to the new ones, operands always come first.
+    std::vector<std::size_t> map(_nodes.size(), 0);
+    for (std::size_t node = 0; node < _nodes.size(); ++node) {
+        if (uses[node] == 0)
+            continue;
+        const dag_node_t &n = _nodes[node];
+        std::vector<std::size_t> args;
+        for (std::size_t arg : n.args)
+            args.emplace_back(map[arg]);
+        if (n.op == dag_op_t::pow) {
+            // Binary exponentiation, x^5 = x * (x^2)^2.
+            auto exponent      = static_cast<unsigned>(n.value);
+            std::size_t square = args[0], result = 0;
+            bool first         = true;
+            while (exponent) {
+                if (exponent & 1U) {
+                    result = first ? square : dag.make(dag_op_t::mul, { result, square });
+                    first  = false;
+                }
+                exponent >>= 1U;
+                if (exponent)
+                    square = dag.make(dag_op_t::mul, { square, square });
+            }
+            map[node] = result;
+        } else if ((n.op == dag_op_t::div) && (divisions[n.args[1]] > 1)) {
+            // Multiply by the shared reciprocal of the denominator.
+            std::size_t reciprocal = dag.make(dag_op_t::div, { dag.constant(1.0), args[1] });
+            const dag_node_t &numerator = dag._nodes[args[0]];
+            if ((numerator.op == dag_op_t::constant) && (numerator.value == 1.0))
+                map[node] = reciprocal;
+            else
+                map[node] = dag.make(dag_op_t::mul, { args[0], reciprocal });
+        } else if ((n.op == dag_op_t::constant) || (n.op == dag_op_t::symbol)) {
+            map[node] = dag.__insert(n);
+        } else {
+            map[node] = dag.make(n.op, args, n.value, n.name);
+        }
+    }
+    for (const auto &statement : _statements)
+        dag._statements.emplace_back(dag_statement_t{ statement.target, map[statement.node] });
+    return dag;
+}
+
+std::ostream &operator<<(std::ostream &lhs, const cost_report_t &rhs)
+{
+    lhs << rhs.adds << " adds, " << rhs.muls << " muls, " << rhs.divs << " divs, " << rhs.calls << " calls";
+    return lhs;
+}
+
+dag_printer_t::dag_printer_t(const expression_dag_t &dag, bool cse)
+    : _dag(dag),
+      _uses(dag.count_uses()),
+      _cse(cse),
+      _temporaries(),
+      _bound(),
+      _cost(),
+      _names(),
+      _scalar(),
+      _c()
+{
+    // Nothing to do.
+}
+
+bool dag_printer_t::__is_shared(std::size_t node) const
+{
+    if (!_cse || (_uses[node] < 2))
+        return false;
+    dag_op_t op = _dag.nodes()[node].op;
+    return (op != dag_op_t::constant) && (op != dag_op_t::symbol);
+}
+
+void dag_printer_t::__print_temporaries(std::ostream &out, std::size_t node, const std::string &indent)
+{
+    if (_temporaries.count(node))
+        return;
+    for (std::size_t arg : _dag.nodes()[node].args)
+        this->__print_temporaries(out, arg, indent);
+    if (this->__is_shared(node)) {
+        std::string name = "t" + std::to_string(this->temporaries());
+        out << indent << "const " << (_c ? "double" : (_scalar.empty() ? "analog_value_t" : _scalar)) << " " << name << " = " << this->print_expression(node) << ";\n";
+        _cost += this->__inline_cost(node);
+        _temporaries[node] = name;
+    }
+}
+
+void dag_printer_t::print_statement(std::ostream &out, const dag_statement_t &statement, const std::string &indent)
+{
+    this->__print_temporaries(out, statement.node, indent);
+    out << indent << this->__print_name(statement.target) << " = " << this->print_expression(statement.node) << ";\n";
+    _cost += this->__inline_cost(statement.node);
+}
+
+void dag_printer_t::print_binding(std::ostream &out, const dag_statement_t &statement, const std::string &indent)
+{
+    for (std::size_t arg : _dag.nodes()[statement.node].args)
+        this->__print_temporaries(out, arg, indent);
+    out << indent << this->__print_name(statement.target) << " = " << this->print_expression(statement.node) << ";\n";
+    _cost += this->__inline_cost(statement.node);
+    this->bind(statement.node, this->__print_name(statement.target));
+}
+
+void dag_printer_t::print_using(std::ostream &out, const std::string &indent) const
+{
+    if (_scalar.empty())
+        return;
+    for (const auto &name : _dag.functions())
+        out << indent << "using std::" << name << ";\n";
+}
+
+std::string dag_printer_t::__print_name(const std::string &name) const
+{
+    auto it = _names.find(name);
+    return (it == _names.end()) ? name : it->second;
+}
+
+cost_report_t dag_printer_t::__inline_cost(std::size_t node) const
+{
+    if (_temporaries.count(node))
+        return cost_report_t();
+    cost_report_t cost = _dag.operations(node);
+    for (std::size_t arg : _dag.nodes()[node].args)
+        cost += this->__inline_cost(arg);
+    return cost;
+}
+
+/// @brief Returns the precedence of the operation, higher binds tighter.
+static inline int __precedence(const dag_node_t &node)
+{
+    switch (node.op) {
+    case dag_op_t::add:
+    case dag_op_t::sub:
+        return 1;
+    case dag_op_t::mul:
+    case dag_op_t::div:
+        return 2;
+    case dag_op_t::neg:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+std::string dag_printer_t::__print_operand(std::size_t node, int precedence, bool right) const
+{
+    std::string expression = this->print_expression(node);
+    if (_temporaries.count(node))
+        return expression;
+    int inner = __precedence(_dag.nodes()[node]);
+    if ((inner < precedence) || (right && (inner == precedence)))
+        return "(" + expression + ")";
+    return expression;
+}
+
+std::string dag_printer_t::print_expression(std::size_t node) const
+{
+    auto it = _temporaries.find(node);
+    if (it != _temporaries.end())
+        return it->second;
+    const dag_node_t &n = _dag.nodes()[node];
+    std::stringstream ss;
+    switch (n.op) {
+    case dag_op_t::constant:
+        if (_scalar.empty())
+            ss << print_double_literal(n.value);
+        else
+            ss << _scalar << "(" << print_double_literal(n.value) << ")";
+        break;
+    case dag_op_t::symbol:
+        ss << this->__print_name(n.name);
+        break;
+    case dag_op_t::add:
+    case dag_op_t::mul:
+        for (std::size_t i = 0; i < n.args.size(); ++i) {
+            if (i > 0)
+                ss << ((n.op == dag_op_t::add) ? " + " : " * ");
+            ss << this->__print_operand(n.args[i], __precedence(n), false);
+        }
+        break;
+    case dag_op_t::sub:
+    case dag_op_t::div:
+        ss << this->__print_operand(n.args[0], __precedence(n), false)
+           << ((n.op == dag_op_t::sub) ? " - " : " / ")
+           << this->__print_operand(n.args[1], __precedence(n), true);
+        break;
+    case dag_op_t::neg:
+        ss << "-" << this->__print_operand(n.args[0], __precedence(n), false);
+        break;
+    case dag_op_t::pow: {
+        std::string basis = this->__print_operand(n.args[0], 2, false);
+        ss << "(";
+        for (int i = 0; i < static_cast<int>(n.value); ++i)
+            ss << ((i > 0) ? " * " : "") << basis;
+        ss << ")";
+        break;
+    }
+    case dag_op_t::call:
+        if (_c)
+            ss << ((n.name == "abs") ? std::string("fabs") : n.name) << "(";
+        else
+            ss << (_scalar.empty() ? "std::" : "") << n.name << "(";
+        for (std::size_t i = 0; i < n.args.size(); ++i)
+            ss << ((i > 0) ? ", " : "") << this->print_expression(n.args[i]);
+        ss << ")";
+        break;
+    }
+    return ss.str();
+}
+
+std::string print_double_literal(double value)
+{
+    std::stringstream ss;
+    // Use the shortest representation that reads back as the same value.
+    for (int precision = 1; precision <= 17; ++precision) {
+        ss.str(std::string());
+        ss.precision(precision);
+        ss << value;
+        if (std::strtod(ss.str().c_str(), nullptr) == value)
+            break;
+    }
+    std::string literal = ss.str();
+    if (literal.find_first_of(".eni") == std::string::npos)
+        literal += ".0";
+    return literal;
+}
+
+} // namespace symsolbin
@@ -3,85 +3,697 @@
 /// @brief
 
 #include "symsolbin/model/model_gen.hpp"
+#include "symsolbin/model/expression_dag.hpp"
+#include "symsolbin/solver/ginac_helper.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <map>
+#include <set>
 
 namespace symsolbin
 {
 
-template <typename List>
-static inline std::string __print_list_with_commas(
-    const List &lst,
-    std::size_t size,
-    std::string prefix  = std::string(),
-    std::string postfix = std::string())
+std::ostream &operator<<(std::ostream &lhs, const codegen_report_t &rhs)
 {
-    std::stringstream ss;
-    for (unsigned i = 0; i < size; ++i) {
-        ss << prefix << lst[i] << postfix;
-        if (i < (size - 1))
-            ss << ", ";
+    lhs << "codegen_report_t:\n";
+    lhs << "    Operations (tree) : " << rhs.tree_operations << "\n";
+    lhs << "    Operations (dag)  : " << rhs.dag_operations << "\n";
+    lhs << "    Removed           : " << rhs.removed_operations() << "\n";
+    lhs << "    Temporaries       : " << rhs.temporaries << "\n";
+    lhs << "    Cost of run()     : " << rhs.cost << "\n";
+    lhs << "    Cost of parameters: " << rhs.parameter_cost << "\n";
+    lhs << "    Cost of timestep  : " << rhs.timestep_cost << "\n";
+    lhs << "    Instance state    : " << rhs.state_before << " -> " << rhs.state_after << " values\n";
+    return lhs;
+}
+
+/// @brief Collects the symbols inside an expression.
+static inline void __collect_symbols(const GiNaC::ex &e, GiNaC::exset &symbols)
+{
+    if (GiNaC::is_a<GiNaC::symbol>(e)) {
+        symbols.insert(e);
+        return;
     }
-    return ss.str();
+    for (std::size_t i = 0; i < e.nops(); ++i)
+        __collect_symbols(e.op(i), symbols);
 }
 
-std::string generate_class(const analog_model_t &model, const std::string &name)
+/// @brief Rewrites an expression which is linear in the state variables as
+/// `c_1 * x_1 + ... + c_n * x_n + c_0`, where the coefficients depend only on
+/// the invariant symbols (i.e., parameters and timestep).
+/// @param e the expression.
+/// @param invariants the invariant symbols.
+/// @return the rewritten expression, or the original one if it is not linear.
+static inline GiNaC::ex __collect_states(const GiNaC::ex &e, const GiNaC::exset &invariants)
+{
+    GiNaC::exset symbols;
+    __collect_symbols(e, symbols);
+    std::vector<GiNaC::ex> states;
+    for (const auto &symbol : symbols)
+        if (!invariants.count(symbol))
+            states.emplace_back(symbol);
+    if (states.empty())
+        return e;
+    GiNaC::ex expanded = e.expand(), result, rest = expanded;
+    for (const auto &state : states) {
+        if ((expanded.degree(state) != 1) || (expanded.ldegree(state) < 0))
+            return e;
+        GiNaC::ex coefficient = expanded.coeff(state, 1);
+        for (const auto &other : states)
+            if (coefficient.has(other))
+                return e;
+        result += coefficient.normal() * state;
+        rest -= coefficient * state;
+    }
+    rest = rest.expand();
+    for (const auto &state : states)
+        if (rest.has(state))
+            return e;
+    return result + rest.normal();
+}
+
+/// @brief Joins the names, separated by commas.
+static inline std::string __join(const std::vector<std::string> &names, const std::string &postfix = std::string())
 {
     std::stringstream ss;
-    GiNaC::csrc_double(ss);
+    for (std::size_t i = 0; i < names.size(); ++i)
+        ss << ((i > 0) ? ", " : "") << names[i] << postfix;
+    return ss.str();
+}
+
+/// @brief Prepares the right-hand side of an equation for the lowering.
+static inline GiNaC::ex __prepare_rhs(const GiNaC::ex &e, const GiNaC::exset &invariants, const codegen_options_t &options)
+{
+    GiNaC::ex rhs = e;
+    if (options.fixed_timestep)
+        rhs = rhs.subs(GiNaC::ex(ts.get_symbol()) == GiNaC::numeric(ts.get_value()));
+    if (options.hoist_parameters)
+        rhs = __collect_states(rhs, invariants);
+    return rhs;
+}
+
+expression_dag_t lower_assignments(const analog_model_t &model,
+                                   const assignment_list_t &assignments,
+                                   const codegen_options_t &options,
+                                   codegen_report_t *report)
+{
+    return lower_assignments(model, assignment_list_t(), assignments, options, report);
+}
+
+expression_dag_t lower_assignments(const analog_model_t &model,
+                                   const assignment_list_t &definitions,
+                                   const assignment_list_t &assignments,
+                                   const codegen_options_t &options,
+                                   codegen_report_t *report)
+{
+    auto system = model.get_system();
+
+    expression_dag_t dag;
+    dag.set_horner(options.horner);
+    // Parameters and timestep change far less often than the state.
+    GiNaC::exset invariants;
+    for (const auto &value : system.values) {
+        dag.set_stage(value.get_name(), dag_stage_t::parameter);
+        invariants.insert(value.get_symbol());
+    }
+    dag.set_stage(ts.get_name(), dag_stage_t::timestep);
+    invariants.insert(ts.get_symbol());
+    if (options.fixed_timestep && (ts.get_value() <= 0)) {
+        std::cerr << "Folding the timestep, but its value is " << ts.get_value() << ", set it with ts.set_value().\n";
+    }
+
+    // Lower all the assignments inside the same DAG, so that they can share
+    // their subexpressions.
+    for (const auto &definition : definitions)
+        dag.define(definition.first, __prepare_rhs(definition.second, invariants, options));
+    for (const auto &assignment : assignments)
+        dag.assign(assignment.first, __prepare_rhs(assignment.second, invariants, options));
+    if (report) {
+        report->tree_operations = dag.tree_cost().total();
+        report->dag_operations  = options.cse ? dag.dag_cost().total() : report->tree_operations;
+    }
+    if (options.strength_reduction)
+        dag = dag.strength_reduce();
+    return dag;
+}
 
+/// @brief Removes the statements whose target is dead, i.e., it is not an
+/// output of the model and it is assigned again, or never read, before being
+/// read. Since run() is executed in a loop, the variables read at the
+/// beginning of a step are alive at the end of the previous one.
+static inline void __eliminate_dead_statements(const analog_model_t &model, expression_dag_t &dag)
+{
+    auto system = model.get_system();
+    std::set<std::string> observed;
+    for (const auto &unknown : (system.outputs.empty() ? system.unknowns : system.outputs))
+        observed.insert(unknown.get_name());
+
+    const auto &statements = dag.statements();
+    std::vector<std::set<std::string>> reads;
+    for (const auto &statement : statements)
+        reads.emplace_back(dag.reads(statement.node));
+    std::vector<bool> keep(statements.size(), false);
+    // Iterate until the variables alive at the end of the step stop growing.
+    std::set<std::string> alive_at_end = observed, alive;
+    for (bool changed = true; changed;) {
+        alive = alive_at_end;
+        for (std::size_t i = statements.size(); i-- > 0;) {
+            keep[i] = alive.erase(statements[i].target) > 0;
+            if (keep[i])
+                alive.insert(reads[i].begin(), reads[i].end());
+        }
+        std::size_t size = alive_at_end.size();
+        alive_at_end.insert(alive.begin(), alive.end());
+        changed = alive_at_end.size() != size;
+    }
+    dag.keep_statements(keep);
+}
+
+expression_dag_t lower_model(const analog_model_t &model, const codegen_options_t &options, codegen_report_t *report)
+{
+    auto solution = model.get_solution();
+    assignment_list_t definitions;
+    for (const auto &equation : solution.elimination)
+        definitions.emplace_back(GiNaC::ex_to<GiNaC::symbol>(equation.lhs()).get_name(), equation.rhs());
+    // The solved equations, followed by the support ones.
+    assignment_list_t assignments;
+    for (const auto &equation : solution.equations)
+        assignments.emplace_back(GiNaC::ex_to<GiNaC::symbol>(equation.lhs()).get_name(), equation.rhs());
+    for (const auto &equation : solution.support)
+        assignments.emplace_back(GiNaC::ex_to<GiNaC::symbol>(equation.lhs()).get_name(), equation.rhs());
+    expression_dag_t dag = lower_assignments(model, definitions, assignments, options, report);
+    if (options.liveness)
+        __eliminate_dead_statements(model, dag);
+    return dag;
+}
+
+model_members_t collect_members(const analog_model_t &model,
+                                const expression_dag_t &dag,
+                                const codegen_options_t &options,
+                                codegen_report_t *report)
+{
     auto structure = model.get_structure();
     auto solution  = model.get_solution();
     auto system    = model.get_system();
 
     std::sort(structure.edges.begin(), structure.edges.end());
     std::sort(system.values.begin(), system.values.end());
+    std::sort(system.inputs.begin(), system.inputs.end());
     std::sort(solution.values.begin(), solution.values.end());
 
+    std::set<std::string> variables = dag.variables();
+    auto is_used = [&](const std::string &name) {
+        return !options.liveness || variables.count(name);
+    };
+    model_members_t members;
+    for (const auto &edge : structure.edges)
+        if (is_used(edge.get_alias() + ".pot") || is_used(edge.get_alias() + ".flw"))
+            members.edges.emplace_back(edge.get_alias());
+    for (const auto &value : system.values)
+        members.values.emplace_back(value.get_name());
+    for (const auto &value : system.inputs)
+        members.inputs.emplace_back(value.get_name());
+    for (const auto &value : solution.values)
+        if (is_used(value.get_name()))
+            members.support.emplace_back(value.get_name());
+    if (report) {
+        report->state_before = 2 * structure.edges.size() + system.values.size() + system.inputs.size() + solution.values.size();
+        report->state_after  = members.state_size();
+    }
+    return members;
+}
+
+/// @brief A region of the contiguous state of a generated class.
+struct state_region_t {
+    /// The name of the region, used by its offset and size, e.g., `state`.
+    std::string name;
+    /// What the region contains.
+    std::string description;
+    /// The variables, in the order they are stored.
+    std::vector<std::string> variables;
+};
+
+/// @brief Ranks the variables by their first use: the statements of run()
+/// are visited in order, then the coefficients, which are computed from the
+/// system variables outside of run().
+/// @param dag the DAG of the model.
+/// @param coefficients the nodes stored inside coefficients, and their name.
+/// @return the rank of each variable which is read or assigned.
+static inline std::map<std::string, std::size_t> __first_use(const expression_dag_t &dag,
+                                                             const std::map<std::size_t, std::string> &coefficients)
+{
+    const auto &nodes = dag.nodes();
+    std::map<std::string, std::size_t> rank;
+    std::vector<bool> visited(nodes.size(), false);
+    auto use = [&rank](const std::string &variable) {
+        rank.emplace(variable, rank.size());
+    };
+    // Visits the operands left to right, run() reads the coefficients
+    // instead of the nodes they replace.
+    auto visit = [&](std::size_t root, bool stop_at_coefficients) {
+        std::vector<std::size_t> stack = { root };
+        while (!stack.empty()) {
+            std::size_t node = stack.back();
+            stack.pop_back();
+            auto coefficient = coefficients.find(node);
+            if (stop_at_coefficients && (coefficient != coefficients.end())) {
+                use(coefficient->second);
+                continue;
+            }
+            if (visited[node])
+                continue;
+            visited[node] = true;
+            if (nodes[node].op == dag_op_t::symbol)
+                use(nodes[node].name);
+            stack.insert(stack.end(), nodes[node].args.rbegin(), nodes[node].args.rend());
+        }
+    };
+    for (const auto &statement : dag.statements()) {
+        visit(statement.node, true);
+        use(statement.target);
+    }
+    for (const auto &coefficient : coefficients)
+        visit(coefficient.first, false);
+    return rank;
+}
+
+/// @brief Splits the variables of the class in the regions of its
+/// contiguous state, each one ordered by first use.
+static inline std::vector<state_region_t> __state_regions(const expression_dag_t &dag,
+                                                          const model_members_t &members,
+                                                          const std::map<std::size_t, std::string> &coefficients)
+{
+    // Only the support values, i.e., the history of the integrals and of
+    // the derivatives, are carried between the steps, the edges are computed
+    // again by every step, but both are hot.
+    std::vector<state_region_t> regions(5);
+    regions[0].name        = "state";
+    regions[0].description = "The state carried from one step to the next";
+    regions[0].variables   = members.support;
+    regions[1].name        = "edge";
+    regions[1].description = "The potentials and flows, computed again by every step";
+    for (const auto &edge : members.edges) {
+        regions[1].variables.emplace_back(edge + ".pot");
+        regions[1].variables.emplace_back(edge + ".flw");
+    }
+    regions[2].name        = "input";
+    regions[2].description = "The system inputs";
+    regions[2].variables   = members.inputs;
+    regions[3].name        = "coefficient";
+    regions[3].description = "The coefficients computed outside of run()";
+    for (const auto &coefficient : coefficients)
+        regions[3].variables.emplace_back(coefficient.second);
+    regions[4].name        = "parameter";
+    regions[4].description = "The system variables";
+    regions[4].variables   = members.values;
+    // The variables never used go at the end of their region.
+    std::map<std::string, std::size_t> rank = __first_use(dag, coefficients);
+    auto rank_of = [&rank](const std::string &variable) {
+        auto it = rank.find(variable);
+        return (it == rank.end()) ? rank.size() : it->second;
+    };
+    for (auto &region : regions) {
+        std::stable_sort(region.variables.begin(), region.variables.end(), [&](const std::string &a, const std::string &b) {
+            return rank_of(a) < rank_of(b);
+        });
+    }
+    return regions;
+}
+
+/// @brief Prints the buffer holding the contiguous state, the offset and
+/// size of its regions, the accessors of its entries, and the functions
+/// which save and restore the carried state.
+static inline void __print_contiguous_state(std::ostream &out,
+                                            const std::vector<state_region_t> &regions,
+                                            const std::string &value_type)
+{
+    std::size_t offset = 0;
+    for (const auto &region : regions) {
+        out << "    /// " << region.description << ", inside _data.\n";
+        out << "    static constexpr std::size_t " << region.name << "_offset = " << offset << ";\n";
+        out << "    static constexpr std::size_t " << region.name << "_size = " << region.variables.size() << ";\n";
+        offset += region.variables.size();
+    }
+    out << "    /// All the values of the instance, in a single cache-aligned buffer.\n";
+    out << "    alignas(64) " << value_type << " _data[" << std::max<std::size_t>(offset, 1) << "];\n";
+    offset = 0;
+    for (const auto &region : regions) {
+        if (!region.variables.empty())
+            out << "    /// " << region.description << ".\n";
+        for (const auto &variable : region.variables) {
+            std::string accessor = variable;
+            std::replace(accessor.begin(), accessor.end(), '.', '_');
+            out << "    inline " << value_type << " &" << accessor << "() { return _data[" << offset << "]; }\n";
+            out << "    inline const " << value_type << " &" << accessor << "() const { return _data[" << offset << "]; }\n";
+            ++offset;
+        }
+    }
+    out << "    /// Copies the carried state into the snapshot, which holds state_size values.\n";
+    out << "    void save_state(" << value_type << " *snapshot) const {\n";
+    out << "        std::copy(_data + state_offset, _data + state_offset + state_size, snapshot);\n";
+    out << "    }\n";
+    out << "    /// Restores the carried state from the snapshot.\n";
+    out << "    void load_state(const " << value_type << " *snapshot) {\n";
+    out << "        std::copy(snapshot, snapshot + state_size, _data + state_offset);\n";
+    out << "    }\n";
+}
+
+/// @brief Escapes a string so that it can be printed as a C++ literal.
+static inline std::string __escape(const std::string &text)
+{
+    std::string escaped;
+    for (char c : text) {
+        if ((c == '"') || (c == '\\'))
+            escaped += '\\';
+        escaped += (c == '\n') ? ' ' : c;
+    }
+    return escaped;
+}
+
+/// @brief Prints the macros used by the profiling counters, which expand to
+/// nothing unless SYMSOLBIN_PROFILE is defined.
+static inline void __print_profile_macros(std::ostream &out)
+{
+    out << "#include <algorithm>\n";
+    out << "#include <iomanip>\n";
+    out << "#include <iostream>\n";
+    out << "\n";
+    out << "#ifndef SYMSOLBIN_PROFILE_BEGIN\n";
+    out << "#ifdef SYMSOLBIN_PROFILE\n";
+    out << "#if defined(__x86_64__) || defined(__i386__)\n";
+    out << "#include <x86intrin.h>\n";
+    out << "#define SYMSOLBIN_PROFILE_CLOCK() static_cast<unsigned long long>(__rdtsc())\n";
+    out << "#else\n";
+    out << "#include <chrono>\n";
+    out << "#define SYMSOLBIN_PROFILE_CLOCK() \\\n";
+    out << "    static_cast<unsigned long long>(std::chrono::steady_clock::now().time_since_epoch().count())\n";
+    out << "#endif\n";
+    out << "#define SYMSOLBIN_PROFILE_BEGIN() _profile_start = SYMSOLBIN_PROFILE_CLOCK()\n";
+    out << "#define SYMSOLBIN_PROFILE_END(index) _profile_cycles[index] += SYMSOLBIN_PROFILE_CLOCK() - _profile_start\n";
+    out << "#else\n";
+    out << "#define SYMSOLBIN_PROFILE_BEGIN()\n";
+    out << "#define SYMSOLBIN_PROFILE_END(index)\n";
+    out << "#endif\n";
+    out << "#endif\n";
+    out << "\n";
+}
+
+/// @brief Prints the counters of the profiled class and dump_profile(),
+/// which ranks the statements of run() by the cycles they took.
+/// @param out where the code is printed.
+/// @param name the name of the class.
+/// @param targets the variable assigned by each statement.
+/// @param sources the equation each statement comes from.
+static inline void __print_profile(std::ostream &out,
+                                   const std::string &name,
+                                   const std::vector<std::string> &targets,
+                                   const std::vector<std::string> &sources)
+{
+    std::size_t size = std::max<std::size_t>(targets.size(), 1);
+    out << "#ifdef SYMSOLBIN_PROFILE\n";
+    out << "    /// The cycles spent by each statement of run(), and the number of runs.\n";
+    out << "    unsigned long long _profile_cycles[" << size << "] = {}, _profile_start = 0, _profile_runs = 0;\n";
+    out << "#endif\n";
+    out << "    /// Resets the profiling counters.\n";
+    out << "    void reset_profile() {\n";
+    out << "#ifdef SYMSOLBIN_PROFILE\n";
+    out << "        std::fill(_profile_cycles, _profile_cycles + " << size << ", 0ULL);\n";
+    out << "        _profile_runs = 0;\n";
+    out << "#endif\n";
+    out << "    }\n";
+    out << "    /// Prints the statements of run(), from the one which took most cycles.\n";
+    out << "    void dump_profile(std::ostream &out = std::cerr) const {\n";
+    out << "#ifdef SYMSOLBIN_PROFILE\n";
+    out << "        static const char *const targets[] = {\n";
+    for (const auto &target : targets)
+        out << "            \"" << __escape(target) << "\",\n";
+    out << "            nullptr\n";
+    out << "        };\n";
+    out << "        static const char *const sources[] = {\n";
+    for (const auto &source : sources)
+        out << "            \"" << __escape(source) << "\",\n";
+    out << "            nullptr\n";
+    out << "        };\n";
+    out << "        std::size_t order[" << size << "] = {};\n";
+    out << "        unsigned long long total = 0;\n";
+    out << "        for (std::size_t i = 0; i < " << targets.size() << "; ++i) {\n";
+    out << "            order[i] = i;\n";
+    out << "            total += _profile_cycles[i];\n";
+    out << "        }\n";
+    out << "        std::stable_sort(order, order + " << targets.size() << ", [this](std::size_t a, std::size_t b) {\n";
+    out << "            return _profile_cycles[a] > _profile_cycles[b];\n";
+    out << "        });\n";
+    out << "        out << \"Profile of " << name << ", \" << _profile_runs << \" runs, \" << total << \" cycles:\\n\";\n";
+    out << "        for (std::size_t i = 0; i < " << targets.size() << "; ++i) {\n";
+    out << "            const std::size_t s = order[i];\n";
+    out << "            out << std::setw(6) << std::fixed << std::setprecision(2)\n";
+    out << "                << (total ? (100.0 * static_cast<double>(_profile_cycles[s]) / static_cast<double>(total)) : 0.0) << \"% \"\n";
+    out << "                << std::setw(10) << (_profile_runs ? (_profile_cycles[s] / _profile_runs) : 0ULL) << \" cycles/run  \"\n";
+    out << "                << targets[s] << \" <- \" << sources[s] << \"\\n\";\n";
+    out << "        }\n";
+    out << "#else\n";
+    out << "        out << \"Define SYMSOLBIN_PROFILE when compiling " << name << " to profile it.\\n\";\n";
+    out << "#endif\n";
+    out << "    }\n";
+}
+
+std::string generate_class(const analog_model_t &model,
+                           const std::string &name,
+                           const codegen_options_t &options,
+                           codegen_report_t *report)
+{
+    std::stringstream ss;
+
+    expression_dag_t dag = lower_model(model, options, report);
+    const auto &statements = dag.statements();
+
+    // Values which depend only on the parameters are computed by
+    // update_parameters(), and the ones which depend also on the timestep by
+    // update_timestep(), both are stored inside coefficients.
+    std::vector<std::size_t> parameter_nodes, timestep_nodes;
+    if (options.hoist_parameters)
+        parameter_nodes = dag.frontier(dag_stage_t::parameter);
+    if (options.cache_timestep && !options.fixed_timestep)
+        timestep_nodes = dag.frontier(dag_stage_t::timestep);
+    dag_printer_t parameter_printer(dag, options.cse);
+    dag_printer_t timestep_printer(dag, options.cse);
+    dag_printer_t printer(dag, options.cse);
+    // A generic class computes everything with T, timestep included.
+    const std::string value_type = options.scalar_template ? "T" : "analog_value_t";
+    const std::string pair_type  = options.scalar_template ? "basic_analog_pair_t<T>" : "analog_pair_t";
+    if (options.scalar_template) {
+        for (dag_printer_t *p : { &parameter_printer, &timestep_printer, &printer }) {
+            p->set_scalar_type(value_type);
+            p->rename(ts.get_name(), value_type + "(" + ts.get_name() + ")");
+        }
+    }
+    std::vector<std::string> parameter_coefficients, timestep_coefficients;
+    std::map<std::size_t, std::string> coefficients;
+    for (std::size_t node : parameter_nodes) {
+        parameter_coefficients.emplace_back("_kp" + std::to_string(parameter_coefficients.size()));
+        coefficients[node] = parameter_coefficients.back();
+    }
+    for (std::size_t node : timestep_nodes) {
+        timestep_coefficients.emplace_back("_kt" + std::to_string(timestep_coefficients.size()));
+        coefficients[node] = timestep_coefficients.back();
+    }
+
+    // Gather the names of the members.
+    model_members_t members = collect_members(model, dag, options, report);
+    const auto &edges       = members.edges;
+    const auto &values      = members.values;
+    const auto &inputs      = members.inputs;
+    const auto &support     = members.support;
+
+    // With a contiguous state, every variable is an entry of _data.
+    std::vector<state_region_t> regions;
+    std::map<std::string, std::string> entries;
+    if (options.contiguous_state) {
+        regions = __state_regions(dag, members, coefficients);
+        std::size_t offset = 0;
+        for (const auto &region : regions)
+            for (const auto &variable : region.variables)
+                entries[variable] = "_data[" + std::to_string(offset++) + "]";
+        for (dag_printer_t *p : { &parameter_printer, &timestep_printer, &printer })
+            for (const auto &entry : entries)
+                p->rename(entry.first, entry.second);
+    }
+    auto entry = [&entries](const std::string &variable) {
+        auto it = entries.find(variable);
+        return (it == entries.end()) ? variable : it->second;
+    };
+    for (std::size_t i = 0; i < parameter_nodes.size(); ++i) {
+        timestep_printer.bind(parameter_nodes[i], entry(parameter_coefficients[i]));
+        printer.bind(parameter_nodes[i], entry(parameter_coefficients[i]));
+    }
+    for (std::size_t i = 0; i < timestep_nodes.size(); ++i)
+        printer.bind(timestep_nodes[i], entry(timestep_coefficients[i]));
+
     ss << "//" << std::string(78, '=') << "\n";
     ss << "\n";
     ss << "#include <symsolbin/simulation/analog_pair.hpp>\n";
     ss << "#include <symsolbin/simulation/simulation.hpp>\n";
     ss << "\n";
+    if (options.profile)
+        __print_profile_macros(ss);
+    if (options.contiguous_state) {
+        ss << "#include <algorithm>\n";
+        ss << "#include <cstddef>\n";
+        ss << "\n";
+    }
+    if (options.scalar_template)
+        ss << "template <typename T = analog_value_t>\n";
     ss << "class " << name << " {\n";
     ss << "public:\n";
-    ss << "    /// Analog edges.\n";
-    ss << "    analog_pair_t " << __print_list_with_commas(structure.edges, structure.edges.size()) << ";\n";
-    ss << "    /// System variables.\n";
-    ss << "    analog_value_t " << __print_list_with_commas(system.values, system.values.size()) << ";\n";
-    if (!solution.values.empty()) {
+    if (options.contiguous_state) {
+        __print_contiguous_state(ss, regions, value_type);
+    } else if (!edges.empty()) {
+        ss << "    /// Analog edges.\n";
+        ss << "    " << pair_type << " " << __join(edges) << ";\n";
+    }
+    if (!values.empty() && !options.contiguous_state) {
+        ss << "    /// System variables.\n";
+        ss << "    " << value_type << " " << __join(values) << ";\n";
+    }
+    if (!inputs.empty() && !options.contiguous_state) {
+        ss << "    /// System inputs.\n";
+        ss << "    " << value_type << " " << __join(inputs) << ";\n";
+    }
+    if (!support.empty() && !options.contiguous_state) {
         ss << "    /// Support variables.\n";
-        ss << "    analog_value_t " << __print_list_with_commas(solution.values, solution.values.size()) << ";\n";
+        ss << "    " << value_type << " " << __join(support) << ";\n";
+    }
+    if (!parameter_coefficients.empty() && !options.contiguous_state) {
+        ss << "    /// Coefficients which depend only on the system variables.\n";
+        ss << "    " << value_type << " " << __join(parameter_coefficients) << ";\n";
+    }
+    if (!timestep_coefficients.empty() && !options.contiguous_state) {
+        ss << "    /// Coefficients which depend also on the timestep.\n";
+        ss << "    " << value_type << " " << __join(timestep_coefficients) << ";\n";
+    }
+    if (!timestep_nodes.empty()) {
+        ss << "    /// The timestep used to compute the coefficients, negative if they must be computed.\n";
+        ss << "    analog_time_t _timestep;\n";
+    }
+    if (!parameter_nodes.empty()) {
+        ss << "    /// If the coefficients must be computed before the next step.\n";
+        ss << "    bool _parameters_dirty;\n";
     }
     ss << "    /// Constructor.\n";
     ss << "    " << name << "() :\n";
-    ss << "        " << __print_list_with_commas(structure.edges, structure.edges.size(), "", "()") << ",\n";
-    ss << "        " << __print_list_with_commas(system.values, system.values.size(), "", "()");
-    if (!solution.values.empty()) {
-        ss << ",\n";
-        ss << "        " << __print_list_with_commas(solution.values, solution.values.size(), "", "()") << "\n";
+    std::vector<std::string> groups;
+    if (options.contiguous_state) {
+        groups.emplace_back("        _data()");
     } else {
-        ss << "\n";
+        for (const auto &group : { edges, values, inputs, support, parameter_coefficients, timestep_coefficients })
+            if (!group.empty())
+                groups.emplace_back("        " + __join(group, "()"));
     }
+    if (!timestep_nodes.empty())
+        groups.emplace_back("        _timestep(-1.0)");
+    if (!parameter_nodes.empty())
+        groups.emplace_back("        _parameters_dirty(true)");
+    for (std::size_t i = 0; i < groups.size(); ++i)
+        ss << groups[i] << ((i + 1 < groups.size()) ? ",\n" : "\n");
     ss << "    {\n";
     ss << "    }\n";
+    if (options.hoist_parameters || !timestep_nodes.empty()) {
+        ss << "    /// Computes the coefficients which depend only on the system\n";
+        ss << "    /// variables, run() calls it before the first step, then it\n";
+        ss << "    /// must be called every time one of them changes.\n";
+        ss << "    void update_parameters() {\n";
+        parameter_printer.print_using(ss, "        ");
+        for (std::size_t i = 0; i < parameter_nodes.size(); ++i)
+            parameter_printer.print_binding(ss, dag_statement_t{ parameter_coefficients[i], parameter_nodes[i] }, "        ");
+        if (!parameter_nodes.empty())
+            ss << "        _parameters_dirty = false;\n";
+        if (!timestep_nodes.empty())
+            ss << "        _timestep = -1.0;\n";
+        ss << "    }\n";
+    }
+    if (!timestep_nodes.empty()) {
+        ss << "    /// Computes the coefficients which depend on the timestep.\n";
+        ss << "    void update_timestep(analog_time_t ts) {\n";
+        timestep_printer.print_using(ss, "        ");
+        for (std::size_t i = 0; i < timestep_nodes.size(); ++i)
+            timestep_printer.print_binding(ss, dag_statement_t{ timestep_coefficients[i], timestep_nodes[i] }, "        ");
+        ss << "        _timestep = ts;\n";
+        ss << "    }\n";
+    }
+    // The equation each statement comes from, shown by dump_profile().
+    std::vector<std::string> profile_targets, profile_sources;
+    if (options.profile) {
+        auto solution = model.get_solution();
+        std::map<std::string, std::string> sources;
+        for (const auto &group : { solution.equations, solution.support }) {
+            for (const auto &equation : group) {
+                std::stringstream source;
+                source << equation;
+                sources[GiNaC::ex_to<GiNaC::symbol>(equation.lhs()).get_name()] = source.str();
+            }
+        }
+        for (const auto &statement : statements) {
+            profile_targets.emplace_back(statement.target);
+            profile_sources.emplace_back(sources[statement.target]);
+        }
+        __print_profile(ss, name, profile_targets, profile_sources);
+    }
     ss << "    void run() {\n";
-    ss << "        // Get the system timestep.\n";
-    ss << "        analog_time_t ts = _system_timestep();\n";
+    printer.print_using(ss, "        ");
+    if (options.profile) {
+        ss << "#ifdef SYMSOLBIN_PROFILE\n";
+        ss << "        ++_profile_runs;\n";
+        ss << "#endif\n";
+    }
+    if (options.fixed_timestep) {
+        ss << "        // The timestep is fixed to " << print_double_literal(ts.get_value()) << ".\n";
+    } else {
+        ss << "        // Get the system timestep.\n";
+        ss << "        analog_time_t ts = _system_timestep();\n";
+    }
+    if (!parameter_nodes.empty()) {
+        ss << "        if (_parameters_dirty)\n";
+        ss << "            this->update_parameters();\n";
+    }
+    if (!timestep_nodes.empty()) {
+        ss << "        if (ts != _timestep)\n";
+        ss << "            this->update_timestep(ts);\n";
+    }
+    // The support equations come last.
+    std::size_t equations = 0;
+    while ((equations < statements.size()) &&
+           (std::find(support.begin(), support.end(), statements[equations].target) == support.end()))
+        ++equations;
+    // Each statement is printed with its temporaries, which are counted
+    // together with it.
+    auto print_statement = [&](std::size_t i) {
+        if (options.profile)
+            ss << "        SYMSOLBIN_PROFILE_BEGIN();\n";
+        printer.print_statement(ss, statements[i], "        ");
+        if (options.profile)
+            ss << "        SYMSOLBIN_PROFILE_END(" << i << ");\n";
+    };
     ss << "        // Evaluate the analog values.\n";
-    for (auto equation : solution.equations) {
-        ss << "        " << equation.lhs() << " = " << equation.rhs() << ";\n";
+    for (std::size_t i = 0; i < equations; ++i) {
+        print_statement(i);
     }
-    if (!solution.values.empty()) {
+    if (equations < statements.size()) {
         ss << "        // Update support variables.\n";
-        for (auto equation : solution.support) {
-            ss << "        " << equation.lhs() << " = " << equation.rhs() << ";\n";
+        for (std::size_t i = equations; i < statements.size(); ++i) {
+            print_statement(i);
         }
     }
     ss << "    }\n";
     ss << "};\n";
     ss << "// " << std::string(77, '=') << "\n\n";
+    if (report) {
+        report->temporaries    = parameter_printer.temporaries() + timestep_printer.temporaries() + printer.temporaries();
+        report->cost           = printer.cost();
+        report->parameter_cost = parameter_printer.cost();
+        report->timestep_cost  = timestep_printer.cost();
+    }
     return ss.str();
 }
 
-} // namespace symsolbin
\ No newline at end of file
+} // namespace symsolbin
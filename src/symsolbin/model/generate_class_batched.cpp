@@ -0,0 +1,269 @@
+/// @file generate_class_batched.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Generates a class which simulates several instances of the model.
+
+#include "symsolbin/model/model_gen.hpp"
+#include "symsolbin/model/expression_dag.hpp"
+#include "symsolbin/solver/ginac_helper.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <sstream>
+
+namespace symsolbin
+{
+
+/// @brief Returns the name of the array holding a variable, e.g., `R0_pot`
+/// for `R0.pot`.
+static inline std::string __array_name(std::string name)
+{
+    std::replace(name.begin(), name.end(), '.', '_');
+    return name;
+}
+
+/// @brief Prints the declaration of a group of arrays.
+static inline void __print_arrays(std::ostream &out, const std::string &comment, const std::vector<std::string> &arrays, const std::string &type)
+{
+    if (arrays.empty())
+        return;
+    out << "    /// " << comment << "\n";
+    out << "    std::vector<" << type << "> ";
+    for (std::size_t i = 0; i < arrays.size(); ++i)
+        out << ((i > 0) ? ", " : "") << arrays[i];
+    out << ";\n";
+}
+
+/// @brief Checks if the code accesses the array, i.e., if it contains
+/// `array[i]` not preceded by another character of an identifier, so that
+/// `R0_pot[i]` is not found inside `CR0_pot[i]`.
+static inline bool __accesses(const std::string &code, const std::string &array)
+{
+    const std::string access = array + "[i]";
+    for (std::size_t position = code.find(access); position != std::string::npos; position = code.find(access, position + 1)) {
+        if (position == 0)
+            return true;
+        const char previous = code[position - 1];
+        if (!std::isalnum(static_cast<unsigned char>(previous)) && (previous != '_'))
+            return true;
+    }
+    return false;
+}
+
+/// @brief Prints the restrict pointers to the arrays accessed by the code,
+/// used inside the loops so that the compiler knows that the arrays do not
+/// overlap.
+static inline void __print_pointers(std::ostream &out, const std::vector<std::string> &arrays, const std::string &code, const std::string &type)
+{
+    for (const auto &array : arrays)
+        if (__accesses(code, array))
+            out << "        " << type << " *__restrict " << array << " = this->" << array << ".data();\n";
+}
+
+std::string generate_class_batched(const analog_model_t &model,
+                                   const std::string &name,
+                                   std::size_t width,
+                                   const codegen_options_t &options,
+                                   codegen_report_t *report)
+{
+    std::stringstream ss;
+
+    if (width == 0) {
+        std::cerr << "The width of the batch must be at least one, using 1.\n";
+        width = 1;
+    }
+
+    expression_dag_t dag = lower_model(model, options, report);
+    const auto &statements = dag.statements();
+    model_members_t members = collect_members(model, dag, options, report);
+
+    // Gather the arrays, every variable becomes an array with one entry per
+    // instance, and is accessed through the index `i` inside the loops.
+    dag_printer_t parameter_printer(dag, options.cse);
+    dag_printer_t timestep_printer(dag, options.cse);
+    dag_printer_t printer(dag, options.cse);
+    const std::string value_type = options.scalar_template ? "T" : "analog_value_t";
+    if (options.scalar_template) {
+        for (dag_printer_t *p : { &parameter_printer, &timestep_printer, &printer }) {
+            p->set_scalar_type(value_type);
+            p->rename(ts.get_name(), value_type + "(" + ts.get_name() + ")");
+        }
+    }
+    std::vector<std::string> edges, values, inputs, support;
+    std::vector<std::string> parameter_coefficients, timestep_coefficients;
+    std::vector<std::string> names;
+    for (const auto &edge : members.edges) {
+        names.emplace_back(edge + ".pot");
+        edges.emplace_back(__array_name(names.back()));
+        names.emplace_back(edge + ".flw");
+        edges.emplace_back(__array_name(names.back()));
+    }
+    for (const auto &value : members.values) {
+        names.emplace_back(value);
+        values.emplace_back(__array_name(names.back()));
+    }
+    for (const auto &value : members.inputs) {
+        names.emplace_back(value);
+        inputs.emplace_back(__array_name(names.back()));
+    }
+    for (const auto &value : members.support) {
+        names.emplace_back(value);
+        support.emplace_back(__array_name(names.back()));
+    }
+    for (const auto &variable : names) {
+        parameter_printer.rename(variable, __array_name(variable) + "[i]");
+        timestep_printer.rename(variable, __array_name(variable) + "[i]");
+        printer.rename(variable, __array_name(variable) + "[i]");
+    }
+
+    // Same staging of generate_class, but the coefficients are arrays too.
+    std::vector<std::size_t> parameter_nodes, timestep_nodes;
+    if (options.hoist_parameters)
+        parameter_nodes = dag.frontier(dag_stage_t::parameter);
+    if (options.cache_timestep && !options.fixed_timestep)
+        timestep_nodes = dag.frontier(dag_stage_t::timestep);
+    for (std::size_t node : parameter_nodes) {
+        parameter_coefficients.emplace_back("_kp" + std::to_string(parameter_coefficients.size()));
+        parameter_printer.rename(parameter_coefficients.back(), parameter_coefficients.back() + "[i]");
+        timestep_printer.bind(node, parameter_coefficients.back() + "[i]");
+        printer.bind(node, parameter_coefficients.back() + "[i]");
+    }
+    for (std::size_t node : timestep_nodes) {
+        timestep_coefficients.emplace_back("_kt" + std::to_string(timestep_coefficients.size()));
+        timestep_printer.rename(timestep_coefficients.back(), timestep_coefficients.back() + "[i]");
+        printer.bind(node, timestep_coefficients.back() + "[i]");
+    }
+    std::vector<std::string> arrays;
+    for (const auto &group : { edges, values, inputs, support, parameter_coefficients, timestep_coefficients })
+        arrays.insert(arrays.end(), group.begin(), group.end());
+
+    ss << "//" << std::string(78, '=') << "\n";
+    ss << "\n";
+    ss << "#include <symsolbin/simulation/analog_pair.hpp>\n";
+    ss << "#include <symsolbin/simulation/simulation.hpp>\n";
+    ss << "\n";
+    ss << "#include <cstddef>\n";
+    ss << "#include <vector>\n";
+    ss << "\n";
+    ss << "/// Simulates several instances of the model, stored as structure of arrays.\n";
+    if (options.scalar_template)
+        ss << "template <typename T = analog_value_t>\n";
+    ss << "class " << name << " {\n";
+    ss << "public:\n";
+    ss << "    /// Number of instances computed together by run_batch().\n";
+    ss << "    static constexpr std::size_t width = " << width << ";\n";
+    __print_arrays(ss, "Analog edges.", edges, value_type);
+    __print_arrays(ss, "System variables.", values, value_type);
+    __print_arrays(ss, "System inputs.", inputs, value_type);
+    __print_arrays(ss, "Support variables.", support, value_type);
+    __print_arrays(ss, "Coefficients which depend only on the system variables.", parameter_coefficients, value_type);
+    __print_arrays(ss, "Coefficients which depend also on the timestep.", timestep_coefficients, value_type);
+    if (!timestep_nodes.empty()) {
+        ss << "    /// The timestep used to compute the coefficients, negative if they must be computed.\n";
+        ss << "    analog_time_t _timestep;\n";
+    }
+    if (!parameter_nodes.empty()) {
+        ss << "    /// If the coefficients must be computed before the next step.\n";
+        ss << "    bool _parameters_dirty;\n";
+    }
+    ss << "    /// Constructor.\n";
+    ss << "    /// @param size the number of instances.\n";
+    ss << "    explicit " << name << "(std::size_t size) :\n";
+    for (std::size_t i = 0; i < arrays.size(); ++i)
+        ss << ((i > 0) ? ",\n" : "") << "        " << arrays[i] << "(size)";
+    if (!timestep_nodes.empty())
+        ss << ",\n        _timestep(-1.0)";
+    if (!parameter_nodes.empty())
+        ss << ",\n        _parameters_dirty(true)";
+    ss << "\n";
+    ss << "    {\n";
+    ss << "    }\n";
+    ss << "    /// Returns the number of instances.\n";
+    ss << "    inline std::size_t size() const {\n";
+    ss << "        return " << arrays.front() << ".size();\n";
+    ss << "    }\n";
+    if (options.hoist_parameters || !timestep_nodes.empty()) {
+        ss << "    /// Computes the coefficients which depend only on the system\n";
+        ss << "    /// variables, run_batch() calls it before the first step, then\n";
+        ss << "    /// it must be called every time one of them changes.\n";
+        std::stringstream code;
+        for (std::size_t i = 0; i < parameter_nodes.size(); ++i)
+            parameter_printer.print_binding(code, dag_statement_t{ parameter_coefficients[i], parameter_nodes[i] }, "            ");
+        ss << "    void update_parameters() {\n";
+        parameter_printer.print_using(ss, "        ");
+        ss << "        const std::size_t n = this->size();\n";
+        __print_pointers(ss, arrays, code.str(), value_type);
+        ss << "        for (std::size_t i = 0; i < n; ++i) {\n";
+        ss << code.str();
+        ss << "        }\n";
+        if (!parameter_nodes.empty())
+            ss << "        _parameters_dirty = false;\n";
+        if (!timestep_nodes.empty())
+            ss << "        _timestep = -1.0;\n";
+        ss << "    }\n";
+    }
+    if (!timestep_nodes.empty()) {
+        std::stringstream code;
+        for (std::size_t i = 0; i < timestep_nodes.size(); ++i)
+            timestep_printer.print_binding(code, dag_statement_t{ timestep_coefficients[i], timestep_nodes[i] }, "            ");
+        ss << "    /// Computes the coefficients which depend on the timestep.\n";
+        ss << "    void update_timestep(analog_time_t ts) {\n";
+        timestep_printer.print_using(ss, "        ");
+        ss << "        const std::size_t n = this->size();\n";
+        __print_pointers(ss, arrays, code.str(), value_type);
+        ss << "        for (std::size_t i = 0; i < n; ++i) {\n";
+        ss << code.str();
+        ss << "        }\n";
+        ss << "        _timestep = ts;\n";
+        ss << "    }\n";
+    }
+    // The body of the step is printed once, and reused by both loops.
+    std::stringstream body;
+    for (const auto &statement : statements)
+        printer.print_statement(body, statement, "                ");
+    ss << "    /// Advances the first n instances by one step.\n";
+    ss << "    /// @param n the number of instances, at most size().\n";
+    ss << "    void run_batch(std::size_t n) {\n";
+    printer.print_using(ss, "        ");
+    if (options.fixed_timestep) {
+        ss << "        // The timestep is fixed to " << print_double_literal(ts.get_value()) << ".\n";
+    } else {
+        ss << "        // Get the system timestep.\n";
+        ss << "        analog_time_t ts = _system_timestep();\n";
+    }
+    if (!parameter_nodes.empty()) {
+        ss << "        if (_parameters_dirty)\n";
+        ss << "            this->update_parameters();\n";
+    }
+    if (!timestep_nodes.empty()) {
+        ss << "        if (ts != _timestep)\n";
+        ss << "            this->update_timestep(ts);\n";
+    }
+    __print_pointers(ss, arrays, body.str(), value_type);
+    ss << "        // Full blocks, the inner loop has a constant trip count so\n";
+    ss << "        // that the compiler can map the lanes to vector registers.\n";
+    ss << "        std::size_t block = 0;\n";
+    ss << "        for (; block + width <= n; block += width) {\n";
+    ss << "            for (std::size_t i = block; i < block + width; ++i) {\n";
+    ss << body.str();
+    ss << "            }\n";
+    ss << "        }\n";
+    ss << "        // Remaining instances.\n";
+    ss << "        for (std::size_t i = block; i < n; ++i) {\n";
+    std::string line;
+    while (std::getline(body, line))
+        ss << line.substr(4) << "\n";
+    ss << "        }\n";
+    ss << "    }\n";
+    ss << "};\n";
+    ss << "// " << std::string(77, '=') << "\n\n";
+    if (report) {
+        report->temporaries    = parameter_printer.temporaries() + timestep_printer.temporaries() + printer.temporaries();
+        report->cost           = printer.cost();
+        report->parameter_cost = parameter_printer.cost();
+        report->timestep_cost  = timestep_printer.cost();
+    }
+    return ss.str();
+}
+
+} // namespace symsolbin
@@ -0,0 +1,370 @@
+/// @file generate_class_split.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Generates a class whose step is split among several source files.
+
+#include "symsolbin/model/model_gen.hpp"
+#include "symsolbin/model/expression_dag.hpp"
+#include "symsolbin/solver/ginac_helper.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace symsolbin
+{
+
+/// @brief Joins the names, separated by commas.
+static inline std::string __join(const std::vector<std::string> &names, const std::string &postfix = std::string())
+{
+    std::stringstream ss;
+    for (std::size_t i = 0; i < names.size(); ++i)
+        ss << ((i > 0) ? ", " : "") << names[i] << postfix;
+    return ss.str();
+}
+
+/// @brief Writes the content of a file.
+static inline bool __write(const std::string &path, const std::string &content)
+{
+    std::ofstream out(path);
+    out << content;
+    out.close();
+    if (!out)
+        std::cerr << "Failed to write " << path << "\n";
+    return static_cast<bool>(out);
+}
+
+/// @brief Collects the nodes computed by an expression, i.e., the ones which
+/// are neither leaves nor already visited or bound to a member.
+static inline void __reachable(const expression_dag_t &dag,
+                               std::size_t root,
+                               const std::vector<bool> &bound,
+                               std::vector<bool> &visited,
+                               std::vector<std::size_t> &reached)
+{
+    std::vector<std::size_t> stack = { root };
+    while (!stack.empty()) {
+        std::size_t node = stack.back();
+        stack.pop_back();
+        const dag_node_t &n = dag.nodes()[node];
+        if (visited[node] || bound[node] || (n.op == dag_op_t::constant) || (n.op == dag_op_t::symbol))
+            continue;
+        visited[node] = true;
+        reached.emplace_back(node);
+        stack.insert(stack.end(), n.args.begin(), n.args.end());
+    }
+}
+
+/// @brief A part of the step, i.e., a range of consecutive statements.
+struct split_part_t {
+    /// The first statement.
+    std::size_t begin;
+    /// One past the last statement.
+    std::size_t end;
+    /// The body of the function.
+    std::string code;
+    /// The temporaries of the part.
+    std::size_t temporaries;
+    /// The operations of the part.
+    cost_report_t cost;
+};
+
+bool generate_class_split(const analog_model_t &model,
+                          const std::string &name,
+                          const std::string &directory,
+                          std::size_t parts,
+                          const codegen_options_t &options,
+                          codegen_report_t *report)
+{
+    // The parts are members defined inside separate files, which rules out
+    // a class template, and the layout of the class is fixed.
+    if (options.scalar_template || options.contiguous_state || options.profile) {
+        std::cerr << "The split class does not support scalar_template, contiguous_state and profile.\n";
+        return false;
+    }
+
+    expression_dag_t dag = lower_model(model, options, report);
+    const auto &statements = dag.statements();
+    const auto &nodes      = dag.nodes();
+
+    model_members_t members = collect_members(model, dag, options, report);
+
+    if (parts == 0)
+        parts = std::max(std::thread::hardware_concurrency(), 1U);
+    parts = std::max<std::size_t>(std::min(parts, statements.size()), 1);
+
+    // Same staging of generate_class, the coefficients are members, so every
+    // part can read them.
+    std::vector<std::size_t> parameter_nodes, timestep_nodes;
+    if (options.hoist_parameters)
+        parameter_nodes = dag.frontier(dag_stage_t::parameter);
+    if (options.cache_timestep && !options.fixed_timestep)
+        timestep_nodes = dag.frontier(dag_stage_t::timestep);
+    std::vector<std::string> parameter_coefficients, timestep_coefficients;
+    std::vector<std::pair<std::size_t, std::string>> coefficients;
+    std::vector<bool> bound(nodes.size(), false);
+    for (std::size_t node : parameter_nodes) {
+        parameter_coefficients.emplace_back("_kp" + std::to_string(parameter_coefficients.size()));
+        coefficients.emplace_back(node, parameter_coefficients.back());
+        bound[node] = true;
+    }
+    for (std::size_t node : timestep_nodes) {
+        timestep_coefficients.emplace_back("_kt" + std::to_string(timestep_coefficients.size()));
+        coefficients.emplace_back(node, timestep_coefficients.back());
+        bound[node] = true;
+    }
+
+    // Split the statements in ranges with a similar number of operations.
+    // The statements are in evaluation order, so each part reads only the
+    // values computed by itself and by the previous ones.
+    std::vector<std::size_t> work(statements.size(), 0);
+    std::size_t total = 0;
+    {
+        std::vector<bool> visited(nodes.size(), false);
+        for (std::size_t i = 0; i < statements.size(); ++i) {
+            std::vector<std::size_t> reached;
+            __reachable(dag, statements[i].node, bound, visited, reached);
+            work[i] = reached.size() + 1;
+            total += work[i];
+        }
+    }
+    std::vector<split_part_t> split;
+    for (std::size_t i = 0, done = 0; i < statements.size(); ++i) {
+        if (split.empty() || ((done * parts >= total * split.size()) && (split.size() < parts)))
+            split.emplace_back(split_part_t{ i, i, std::string(), 0, cost_report_t() });
+        split.back().end = i + 1;
+        done += work[i];
+    }
+
+    // A value used by more than one part is computed by the first one and
+    // stored inside a member, since the temporaries are local to a part.
+    // The following parts read the member, so the operands of a value
+    // computed by a previous part are not visited.
+    std::vector<std::size_t> owner(nodes.size(), split.size());
+    std::vector<bool> shared(nodes.size(), false);
+    for (std::size_t p = 0; p < split.size(); ++p) {
+        std::vector<bool> visited(nodes.size(), false);
+        std::vector<std::size_t> stack;
+        for (std::size_t i = split[p].begin; i < split[p].end; ++i)
+            stack.emplace_back(statements[i].node);
+        while (!stack.empty()) {
+            std::size_t node = stack.back();
+            stack.pop_back();
+            const dag_node_t &n = nodes[node];
+            if (visited[node] || bound[node] || (n.op == dag_op_t::constant) || (n.op == dag_op_t::symbol))
+                continue;
+            visited[node] = true;
+            if (owner[node] < p) {
+                shared[node] = true;
+                continue;
+            }
+            owner[node] = p;
+            stack.insert(stack.end(), n.args.begin(), n.args.end());
+        }
+    }
+    std::vector<std::string> shared_names(nodes.size());
+    std::vector<std::string> shared_values;
+    for (std::size_t node = 0; node < nodes.size(); ++node) {
+        if (shared[node]) {
+            shared_values.emplace_back("_s" + std::to_string(shared_values.size()));
+            shared_names[node] = shared_values.back();
+        }
+    }
+
+    // The parts are printed in parallel, the DAG is only read.
+    auto print_part = [&](split_part_t &part, std::size_t p) {
+        std::stringstream ss;
+        dag_printer_t printer(dag, options.cse);
+        for (const auto &coefficient : coefficients)
+            printer.bind(coefficient.first, coefficient.second);
+        for (std::size_t node = 0; node < nodes.size(); ++node)
+            if (shared[node] && (owner[node] < p))
+                printer.bind(node, shared_names[node]);
+        std::vector<bool> visited(nodes.size(), false);
+        for (std::size_t i = part.begin; i < part.end; ++i) {
+            // Store the shared values first reached by this statement, the
+            // operands come first since they have a lower index.
+            std::vector<std::size_t> reached;
+            __reachable(dag, statements[i].node, bound, visited, reached);
+            std::sort(reached.begin(), reached.end());
+            for (std::size_t node : reached)
+                if (shared[node] && (owner[node] == p))
+                    printer.print_binding(ss, dag_statement_t{ shared_names[node], node }, "    ");
+            printer.print_statement(ss, statements[i], "    ");
+        }
+        part.code        = ss.str();
+        part.temporaries = printer.temporaries();
+        part.cost        = printer.cost();
+    };
+    std::vector<std::thread> workers;
+    for (std::size_t p = 1; p < split.size(); ++p)
+        workers.emplace_back(print_part, std::ref(split[p]), p);
+    if (!split.empty())
+        print_part(split[0], 0);
+
+    // Meanwhile, print the class and the coefficients.
+    std::stringstream header;
+    header << "//" << std::string(78, '=') << "\n";
+    header << "\n";
+    header << "#pragma once\n";
+    header << "\n";
+    header << "#include <symsolbin/simulation/analog_pair.hpp>\n";
+    header << "#include <symsolbin/simulation/simulation.hpp>\n";
+    header << "\n";
+    header << "class " << name << " {\n";
+    header << "public:\n";
+    if (!members.edges.empty()) {
+        header << "    /// Analog edges.\n";
+        header << "    analog_pair_t " << __join(members.edges) << ";\n";
+    }
+    if (!members.values.empty()) {
+        header << "    /// System variables.\n";
+        header << "    analog_value_t " << __join(members.values) << ";\n";
+    }
+    if (!members.inputs.empty()) {
+        header << "    /// System inputs.\n";
+        header << "    analog_value_t " << __join(members.inputs) << ";\n";
+    }
+    if (!members.support.empty()) {
+        header << "    /// Support variables.\n";
+        header << "    analog_value_t " << __join(members.support) << ";\n";
+    }
+    if (!parameter_coefficients.empty()) {
+        header << "    /// Coefficients which depend only on the system variables.\n";
+        header << "    analog_value_t " << __join(parameter_coefficients) << ";\n";
+    }
+    if (!timestep_coefficients.empty()) {
+        header << "    /// Coefficients which depend also on the timestep.\n";
+        header << "    analog_value_t " << __join(timestep_coefficients) << ";\n";
+    }
+    if (!shared_values.empty()) {
+        header << "    /// Values computed by a part of the step and read by the following ones.\n";
+        header << "    analog_value_t " << __join(shared_values) << ";\n";
+    }
+    if (!timestep_nodes.empty()) {
+        header << "    /// The timestep used to compute the coefficients, negative if they must be computed.\n";
+        header << "    analog_time_t _timestep;\n";
+    }
+    if (!parameter_nodes.empty()) {
+        header << "    /// If the coefficients must be computed before the next step.\n";
+        header << "    bool _parameters_dirty;\n";
+    }
+    header << "    /// Constructor.\n";
+    header << "    " << name << "() :\n";
+    std::vector<std::string> groups;
+    for (const auto &group : { members.edges, members.values, members.inputs, members.support,
+                               parameter_coefficients, timestep_coefficients, shared_values })
+        if (!group.empty())
+            groups.emplace_back("        " + __join(group, "()"));
+    if (!timestep_nodes.empty())
+        groups.emplace_back("        _timestep(-1.0)");
+    if (!parameter_nodes.empty())
+        groups.emplace_back("        _parameters_dirty(true)");
+    for (std::size_t i = 0; i < groups.size(); ++i)
+        header << groups[i] << ((i + 1 < groups.size()) ? ",\n" : "\n");
+    header << "    {\n";
+    header << "    }\n";
+    header << "    /// Computes the coefficients which depend only on the system\n";
+    header << "    /// variables, run() calls it before the first step, then it\n";
+    header << "    /// must be called every time one of them changes.\n";
+    header << "    void update_parameters();\n";
+    if (!timestep_nodes.empty()) {
+        header << "    /// Computes the coefficients which depend on the timestep.\n";
+        header << "    void update_timestep(analog_time_t ts);\n";
+    }
+    header << "    void run();\n";
+    header << "    /// The parts of run(), called in this order.\n";
+    for (std::size_t p = 0; p < split.size(); ++p)
+        header << "    void run_part" << p << "(analog_time_t ts);\n";
+    header << "};\n";
+    header << "// " << std::string(77, '=') << "\n";
+
+    dag_printer_t parameter_printer(dag, options.cse);
+    dag_printer_t timestep_printer(dag, options.cse);
+    for (std::size_t i = 0; i < parameter_nodes.size(); ++i)
+        timestep_printer.bind(parameter_nodes[i], parameter_coefficients[i]);
+    std::stringstream source;
+    source << "#include \"" << name << ".hpp\"\n";
+    source << "\n";
+    source << "void " << name << "::update_parameters() {\n";
+    for (std::size_t i = 0; i < parameter_nodes.size(); ++i)
+        parameter_printer.print_binding(source, dag_statement_t{ parameter_coefficients[i], parameter_nodes[i] }, "    ");
+    if (!parameter_nodes.empty())
+        source << "    _parameters_dirty = false;\n";
+    if (!timestep_nodes.empty())
+        source << "    _timestep = -1.0;\n";
+    source << "}\n";
+    source << "\n";
+    if (!timestep_nodes.empty()) {
+        source << "void " << name << "::update_timestep(analog_time_t ts) {\n";
+        for (std::size_t i = 0; i < timestep_nodes.size(); ++i)
+            timestep_printer.print_binding(source, dag_statement_t{ timestep_coefficients[i], timestep_nodes[i] }, "    ");
+        source << "    _timestep = ts;\n";
+        source << "}\n";
+        source << "\n";
+    }
+    source << "void " << name << "::run() {\n";
+    if (options.fixed_timestep) {
+        source << "    // The timestep is fixed.\n";
+        source << "    const analog_time_t ts = " << print_double_literal(ts.get_value()) << ";\n";
+    } else {
+        source << "    // Get the system timestep.\n";
+        source << "    analog_time_t ts = _system_timestep();\n";
+    }
+    if (!parameter_nodes.empty()) {
+        source << "    if (_parameters_dirty)\n";
+        source << "        this->update_parameters();\n";
+    }
+    if (!timestep_nodes.empty()) {
+        source << "    if (ts != _timestep)\n";
+        source << "        this->update_timestep(ts);\n";
+    }
+    for (std::size_t p = 0; p < split.size(); ++p)
+        source << "    this->run_part" << p << "(ts);\n";
+    source << "}\n";
+
+    for (auto &worker : workers)
+        worker.join();
+
+    // Write the files, and the CMake fragment listing them.
+    bool success = __write(directory + "/" + name + ".hpp", header.str());
+    success &= __write(directory + "/" + name + ".cpp", source.str());
+    std::stringstream cmake;
+    cmake << "# Sources of " << name << ", add them to a target with:\n";
+    cmake << "#   include(" << name << ".cmake)\n";
+    cmake << "#   target_sources(<target> PRIVATE ${" << name << "_SOURCES})\n";
+    cmake << "#   target_include_directories(<target> PRIVATE ${" << name << "_INCLUDE_DIRS})\n";
+    cmake << "# Each part is a translation unit, so they compile in parallel.\n";
+    cmake << "set(" << name << "_INCLUDE_DIRS ${CMAKE_CURRENT_LIST_DIR})\n";
+    cmake << "set(" << name << "_SOURCES\n";
+    cmake << "    ${CMAKE_CURRENT_LIST_DIR}/" << name << ".cpp\n";
+    for (std::size_t p = 0; p < split.size(); ++p) {
+        std::stringstream part;
+        part << "#include \"" << name << ".hpp\"\n";
+        part << "\n";
+        part << "// Statements " << split[p].begin << " to " << split[p].end - 1 << " of the step.\n";
+        part << "void " << name << "::run_part" << p << "([[maybe_unused]] analog_time_t ts) {\n";
+        part << split[p].code;
+        part << "}\n";
+        std::string file = name + "_part" + std::to_string(p) + ".cpp";
+        success &= __write(directory + "/" + file, part.str());
+        cmake << "    ${CMAKE_CURRENT_LIST_DIR}/" << file << "\n";
+    }
+    cmake << ")\n";
+    success &= __write(directory + "/" + name + ".cmake", cmake.str());
+
+    if (report) {
+        report->temporaries    = parameter_printer.temporaries() + timestep_printer.temporaries();
+        report->cost           = cost_report_t();
+        report->parameter_cost = parameter_printer.cost();
+        report->timestep_cost  = timestep_printer.cost();
+        for (const auto &part : split) {
+            report->temporaries += part.temporaries;
+            report->cost += part.cost;
+        }
+    }
+    return success;
+}
+
+} // namespace symsolbin
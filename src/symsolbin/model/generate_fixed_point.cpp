@@ -0,0 +1,654 @@
+/// @file generate_fixed_point.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Generates a simulation code which works only with integers.
+
+#include "symsolbin/model/model_gen.hpp"
+#include "symsolbin/model/expression_dag.hpp"
+#include "symsolbin/simulation/fixed_point.hpp"
+#include "symsolbin/solver/ginac_helper.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace symsolbin
+{
+
+/// @brief A range of values.
+struct interval_t {
+    /// The lowest value.
+    double min;
+    /// The highest value.
+    double max;
+
+    /// @brief Returns the largest absolute value.
+    inline double magnitude() const
+    {
+        return std::max(std::abs(min), std::abs(max));
+    }
+
+    /// @brief Checks if the range is bounded.
+    inline bool valid() const
+    {
+        return std::isfinite(min) && std::isfinite(max) && (min <= max);
+    }
+};
+
+/// @brief An unbounded range.
+static const interval_t __unbounded = { -HUGE_VAL, HUGE_VAL };
+
+/// @brief Returns the smallest range containing the values.
+static inline interval_t __hull(std::initializer_list<double> values)
+{
+    return interval_t{ std::min(values), std::max(values) };
+}
+
+/// @brief Returns the fractional bits which fit the range inside a fixed_t,
+/// leaving the guard bits free.
+static inline int __fraction(const interval_t &range, int guard)
+{
+    int exponent     = 0;
+    double magnitude = range.magnitude();
+    if (magnitude > 0)
+        std::frexp(magnitude, &exponent);
+    return std::min(std::max(31 - guard - exponent, -31), 62);
+}
+
+/// @brief Returns the range of a function of the range of its arguments.
+static inline interval_t __call_range(const std::string &name, const std::vector<interval_t> &args)
+{
+    static const double pi = std::acos(-1.0);
+    if ((name == "pow") && (args[1].min == args[1].max) && (args[0].min > 0))
+        return __hull({ std::pow(args[0].min, args[1].min), std::pow(args[0].max, args[1].min) });
+    if (args.size() == 2)
+        return (name == "atan2") ? interval_t{ -pi, pi } : __unbounded;
+    const interval_t &x = args[0];
+    if ((name == "sin") || (name == "cos"))
+        return interval_t{ -1.0, 1.0 };
+    if (name == "exp")
+        return interval_t{ std::exp(x.min), std::exp(x.max) };
+    if ((name == "log") && (x.min > 0))
+        return interval_t{ std::log(x.min), std::log(x.max) };
+    if ((name == "sqrt") && (x.max >= 0))
+        return interval_t{ std::sqrt(std::max(x.min, 0.0)), std::sqrt(x.max) };
+    if (name == "tanh")
+        return interval_t{ std::tanh(x.min), std::tanh(x.max) };
+    if (name == "sinh")
+        return interval_t{ std::sinh(x.min), std::sinh(x.max) };
+    if (name == "atan")
+        return interval_t{ std::atan(x.min), std::atan(x.max) };
+    if (name == "asin")
+        return interval_t{ -pi / 2, pi / 2 };
+    if (name == "acos")
+        return interval_t{ 0.0, pi };
+    double lowest = ((x.min <= 0) && (x.max >= 0)) ? 0.0 : std::min(std::abs(x.min), std::abs(x.max));
+    if (name == "abs")
+        return interval_t{ lowest, x.magnitude() };
+    if (name == "cosh")
+        return interval_t{ std::cosh(lowest), std::cosh(x.magnitude()) };
+    return __unbounded;
+}
+
+/// @brief Evaluates a function of one argument on the host, to fill its
+/// table.
+/// @return false if the function is not supported.
+static inline bool __evaluate(const std::string &name, double x, double exponent, double &result)
+{
+    static const std::map<std::string, double (*)(double)> functions = {
+        { "sin", [](double v) { return std::sin(v); } },
+        { "cos", [](double v) { return std::cos(v); } },
+        { "tan", [](double v) { return std::tan(v); } },
+        { "exp", [](double v) { return std::exp(v); } },
+        { "log", [](double v) { return std::log(v); } },
+        { "sqrt", [](double v) { return std::sqrt(v); } },
+        { "sinh", [](double v) { return std::sinh(v); } },
+        { "cosh", [](double v) { return std::cosh(v); } },
+        { "tanh", [](double v) { return std::tanh(v); } },
+        { "asin", [](double v) { return std::asin(v); } },
+        { "acos", [](double v) { return std::acos(v); } },
+        { "atan", [](double v) { return std::atan(v); } },
+        { "abs", [](double v) { return std::abs(v); } },
+    };
+    if (name == "pow") {
+        result = std::pow(x, exponent);
+        return true;
+    }
+    auto it = functions.find(name);
+    if (it == functions.end())
+        return false;
+    result = it->second(x);
+    return true;
+}
+
+/// @brief Emits the DAG nodes as fixed-point code, choosing the fractional
+/// bits of each value from its range.
+class fixed_point_emitter_t {
+public:
+    /// @brief Constructor.
+    fixed_point_emitter_t(const expression_dag_t &dag, const fixed_point_options_t &options)
+        : _dag(dag),
+          _options(options),
+          _variables(),
+          _ranges(dag.nodes().size()),
+          _bounded(dag.nodes().size(), false),
+          _names(),
+          _bound(),
+          _temporaries(),
+          _cost(),
+          _tables(),
+          _table_count(),
+          _failed()
+    {
+        // Nothing to do.
+    }
+
+    /// @brief Sets the range of a variable.
+    inline void set_range(const std::string &name, const interval_t &range)
+    {
+        _variables[name] = range;
+    }
+
+    /// @brief Checks if the variable has a range.
+    inline bool has_range(const std::string &name) const
+    {
+        return _variables.count(name) > 0;
+    }
+
+    /// @brief Returns the range of a variable, assuming the default one if
+    /// it has none.
+    interval_t variable_range(const std::string &name)
+    {
+        auto it = _variables.find(name);
+        if (it != _variables.end())
+            return it->second;
+        std::cerr << "The variable `" << name << "` has no range, assuming +/-" << _options.default_range << ".\n";
+        return _variables[name] = interval_t{ -_options.default_range, _options.default_range };
+    }
+
+    /// @brief Returns the fractional bits of a variable.
+    inline int variable_fraction(const std::string &name)
+    {
+        return __fraction(this->variable_range(name), _options.guard_bits);
+    }
+
+    /// @brief Returns the range of a node.
+    interval_t range(std::size_t node)
+    {
+        if (_bounded[node])
+            return _ranges[node];
+        const dag_node_t &n = _dag.nodes()[node];
+        std::vector<interval_t> args;
+        for (std::size_t arg : n.args)
+            args.emplace_back(this->range(arg));
+        interval_t result = __unbounded;
+        switch (n.op) {
+        case dag_op_t::constant:
+            result = interval_t{ n.value, n.value };
+            break;
+        case dag_op_t::symbol:
+            result = this->variable_range(n.name);
+            break;
+        case dag_op_t::add:
+            result = interval_t{ 0.0, 0.0 };
+            for (const auto &arg : args)
+                result = interval_t{ result.min + arg.min, result.max + arg.max };
+            break;
+        case dag_op_t::sub:
+            result = interval_t{ args[0].min - args[1].max, args[0].max - args[1].min };
+            break;
+        case dag_op_t::neg:
+            result = interval_t{ -args[0].max, -args[0].min };
+            break;
+        case dag_op_t::mul:
+            result = args[0];
+            for (std::size_t i = 1; i < args.size(); ++i)
+                result = __product(result, args[i]);
+            break;
+        case dag_op_t::pow:
+            result = args[0];
+            for (int i = 1; i < static_cast<int>(n.value); ++i)
+                result = __product(result, args[0]);
+            break;
+        case dag_op_t::div:
+            if ((args[1].min > 0) || (args[1].max < 0)) {
+                result = __hull({ args[0].min / args[1].min, args[0].min / args[1].max,
+                                  args[0].max / args[1].min, args[0].max / args[1].max });
+            }
+            break;
+        case dag_op_t::call:
+            result = __call_range(n.name, args);
+            break;
+        }
+        if (!result.valid()) {
+            std::cerr << "Cannot bound a value computed through `" << __describe(n) << "`, assuming +/-"
+                      << _options.default_range << ".\n";
+            result = interval_t{ -_options.default_range, _options.default_range };
+        }
+        _bounded[node] = true;
+        return _ranges[node] = result;
+    }
+
+    /// @brief Returns the fractional bits of a node.
+    inline int fraction(std::size_t node)
+    {
+        const dag_node_t &n = _dag.nodes()[node];
+        if (n.op == dag_op_t::symbol)
+            return this->variable_fraction(n.name);
+        return __fraction(this->range(node), _options.guard_bits);
+    }
+
+    /// @brief Makes the emitter read the node from a variable, e.g., because
+    /// it has been computed somewhere else.
+    inline void bind(std::size_t node, const std::string &name)
+    {
+        _names[node] = name;
+        _bound.insert(node);
+    }
+
+    /// @brief Forgets the temporaries emitted so far, which are local to the
+    /// method that computed them, while keeping the bound nodes.
+    inline void reset()
+    {
+        for (auto it = _names.begin(); it != _names.end();)
+            it = _bound.count(it->first) ? std::next(it) : _names.erase(it);
+    }
+
+    /// @brief Emits the statement `target = node`, rescaling the value to
+    /// the fractional bits of the target.
+    void emit_statement(std::ostream &out, const dag_statement_t &statement, const std::string &indent)
+    {
+        // A variable without a range takes the one of its first value.
+        if (!this->has_range(statement.target))
+            this->set_range(statement.target, this->range(statement.node));
+        std::string value = this->__operand(out, statement.node, this->variable_fraction(statement.target), indent);
+        out << indent << statement.target << " = fx_saturate(" << value << ");\n";
+    }
+
+    /// @brief Returns the number of temporaries emitted so far.
+    inline std::size_t temporaries() const
+    {
+        return _temporaries;
+    }
+
+    /// @brief Returns the declarations of the tables of the function calls.
+    inline std::string tables() const
+    {
+        return _tables.str();
+    }
+
+    /// @brief Checks if a value could not be emitted with integers only.
+    inline bool failed() const
+    {
+        return _failed;
+    }
+
+    /// @brief Returns the operations emitted so far, and resets them.
+    inline cost_report_t take_cost()
+    {
+        cost_report_t cost = _cost;
+        _cost              = cost_report_t();
+        return cost;
+    }
+
+private:
+    /// The DAG.
+    const expression_dag_t &_dag;
+    /// The options.
+    const fixed_point_options_t &_options;
+    /// The range of each variable.
+    std::map<std::string, interval_t> _variables;
+    /// The range of each node.
+    std::vector<interval_t> _ranges;
+    /// If the range of each node has been computed.
+    std::vector<bool> _bounded;
+    /// The variable holding each emitted or bound node.
+    std::map<std::size_t, std::string> _names;
+    /// The bound nodes.
+    std::set<std::size_t> _bound;
+    /// The number of temporaries emitted so far.
+    std::size_t _temporaries;
+    /// The operations emitted so far.
+    cost_report_t _cost;
+    /// The declarations of the tables.
+    std::stringstream _tables;
+    /// The number of tables.
+    std::size_t _table_count;
+    /// If a value could not be emitted.
+    bool _failed;
+
+    /// @brief Returns the range of the product of two ranges.
+    static inline interval_t __product(const interval_t &a, const interval_t &b)
+    {
+        return __hull({ a.min * b.min, a.min * b.max, a.max * b.min, a.max * b.max });
+    }
+
+    /// @brief Describes a node inside the messages.
+    static inline std::string __describe(const dag_node_t &node)
+    {
+        switch (node.op) {
+        case dag_op_t::div:
+            return "division";
+        case dag_op_t::call:
+            return node.name;
+        default:
+            return "arithmetic";
+        }
+    }
+
+    /// @brief Returns the variable holding the node, emitting it if needed.
+    std::string __emit(std::ostream &out, std::size_t node, const std::string &indent)
+    {
+        auto it = _names.find(node);
+        if (it != _names.end())
+            return it->second;
+        const dag_node_t &n = _dag.nodes()[node];
+        if (n.op == dag_op_t::symbol)
+            return n.name;
+        int fraction = this->fraction(node);
+        std::stringstream value;
+        switch (n.op) {
+        case dag_op_t::add:
+            for (std::size_t i = 0; i < n.args.size(); ++i)
+                value << ((i > 0) ? " + " : "") << this->__operand(out, n.args[i], fraction, indent);
+            break;
+        case dag_op_t::sub:
+            value << this->__operand(out, n.args[0], fraction, indent) << " - "
+                  << this->__operand(out, n.args[1], fraction, indent);
+            break;
+        case dag_op_t::neg:
+            value << "-" << this->__operand(out, n.args[0], fraction, indent);
+            break;
+        case dag_op_t::mul:
+            value << this->__product_chain(out, n.args, node, indent);
+            break;
+        case dag_op_t::pow:
+            value << this->__product_chain(out, std::vector<std::size_t>(static_cast<std::size_t>(n.value), n.args[0]), node, indent);
+            break;
+        case dag_op_t::div: {
+            // ((a << s) / b) has the fractional bits fa + s - fb.
+            int shift = fraction - this->fraction(n.args[0]) + this->fraction(n.args[1]);
+            value << "fx_div(" << this->__operand(out, n.args[0], this->fraction(n.args[0]), indent) << ", "
+                  << this->__operand(out, n.args[1], this->fraction(n.args[1]), indent) << ", " << shift << ")";
+            break;
+        }
+        case dag_op_t::call:
+            value << this->__lookup(out, node, fraction, indent);
+            break;
+        case dag_op_t::constant:
+            value << "fixed_wide_t(" << fx_from_double(n.value, fraction) << ")";
+            break;
+        case dag_op_t::symbol:
+            break;
+        }
+        _cost += _dag.operations(node);
+        return _names[node] = this->__temporary(out, value.str(), this->range(node), fraction, indent);
+    }
+
+    /// @brief Returns the expression which evaluates a function call through
+    /// a table, which spans the range of its argument with at most
+    /// `2^table_bits` segments, whose length is a power of two in the format
+    /// of the argument.
+    std::string __lookup(std::ostream &out, std::size_t node, int fraction, const std::string &indent)
+    {
+        const dag_node_t &n = _dag.nodes()[node];
+        // The exponent of a power must be a constant, the other functions
+        // take only one argument.
+        double exponent = 0;
+        if ((n.name == "pow") && (n.args.size() == 2) && (_dag.nodes()[n.args[1]].op == dag_op_t::constant))
+            exponent = _dag.nodes()[n.args[1]].value;
+        else if (n.args.size() != 1)
+            return this->__fail(n, "it takes more than one argument");
+        const std::size_t arg      = n.args[0];
+        const int arg_fraction     = this->fraction(arg);
+        const interval_t arg_range = this->range(arg);
+        const fixed_wide_t origin  = fx_from_double(arg_range.min, arg_fraction);
+        const fixed_wide_t span    = fx_from_double(arg_range.max, arg_fraction) - origin;
+        const int bits             = std::min(std::max(_options.table_bits, 1), 16);
+        int step                   = 0;
+        while ((span >> step) > (static_cast<fixed_wide_t>(1) << bits))
+            ++step;
+        const fixed_wide_t segments = (span + (static_cast<fixed_wide_t>(1) << step) - 1) >> step;
+        std::vector<fixed_t> table;
+        for (fixed_wide_t i = 0; i <= segments; ++i) {
+            double result = 0;
+            if (!__evaluate(n.name, fx_to_double(origin + (i << step), arg_fraction), exponent, result))
+                return this->__fail(n, "it is not supported");
+            if (!std::isfinite(result))
+                return this->__fail(n, "it is not finite over the range of its argument");
+            table.emplace_back(fx_from_double(result, fraction));
+        }
+        const std::string name = "_table" + std::to_string(_table_count++);
+        _tables << "    /// " << n.name << " over [" << arg_range.min << ", " << arg_range.max << "], from Q" << arg_fraction
+                << " to Q" << fraction << ".\n";
+        _tables << "    static constexpr fixed_t " << name << "[" << table.size() << "] = {";
+        for (std::size_t i = 0; i < table.size(); ++i)
+            _tables << ((i % 8) ? " " : "\n        ") << table[i] << ((i + 1 < table.size()) ? "," : "");
+        _tables << "\n    };\n";
+        std::stringstream ss;
+        ss << "fx_lookup(" << name << ", " << table.size() << ", " << this->__operand(out, arg, arg_fraction, indent)
+           << ", fixed_wide_t(" << origin << "), " << step << ")";
+        return ss.str();
+    }
+
+    /// @brief Reports a function call which cannot be tabulated.
+    std::string __fail(const dag_node_t &node, const std::string &reason)
+    {
+        std::cerr << "The function `" << node.name << "` cannot be evaluated with integers, since " << reason << ".\n";
+        _failed = true;
+        return "fixed_wide_t(0)";
+    }
+
+    /// @brief Returns the wide expression of the node with the given
+    /// fractional bits.
+    std::string __operand(std::ostream &out, std::size_t node, int fraction, const std::string &indent)
+    {
+        const dag_node_t &n = _dag.nodes()[node];
+        if ((n.op == dag_op_t::constant) && !_names.count(node))
+            return "fixed_wide_t(" + std::to_string(fx_from_double(n.value, fraction)) + ")";
+        std::string name = this->__emit(out, node, indent);
+        int shift        = fraction - this->fraction(node);
+        if (shift == 0)
+            return "fixed_wide_t(" + name + ")";
+        return "fx_shift(" + name + ", " + std::to_string(shift) + ")";
+    }
+
+    /// @brief Returns the expression of the product of the factors, each
+    /// partial product but the last is stored inside a temporary with its
+    /// own fractional bits.
+    std::string __product_chain(std::ostream &out, const std::vector<std::size_t> &factors, std::size_t node, const std::string &indent)
+    {
+        std::string product   = this->__operand(out, factors[0], this->fraction(factors[0]), indent);
+        interval_t range      = this->range(factors[0]);
+        int fraction          = this->fraction(factors[0]);
+        for (std::size_t i = 1; i < factors.size(); ++i) {
+            int factor_fraction = this->fraction(factors[i]);
+            std::string factor  = this->__operand(out, factors[i], factor_fraction, indent);
+            // The product has the sum of the fractional bits of the factors.
+            range             = (i + 1 == factors.size()) ? this->range(node) : __product(range, this->range(factors[i]));
+            int next_fraction = __fraction(range, _options.guard_bits);
+            std::string value = "fx_shift(" + product + " * " + factor + ", " + std::to_string(next_fraction - fraction - factor_fraction) + ")";
+            if (i + 1 == factors.size())
+                return value;
+            product  = "fixed_wide_t(" + this->__temporary(out, value, range, next_fraction, indent) + ")";
+            fraction = next_fraction;
+        }
+        return product;
+    }
+
+    /// @brief Prints a temporary, with its format as comment.
+    std::string __temporary(std::ostream &out, const std::string &value, const interval_t &range, int fraction, const std::string &indent)
+    {
+        std::string name = "t" + std::to_string(_temporaries++);
+        out << indent << "const fixed_t " << name << " = fx_saturate(" << value << "); // Q" << fraction
+            << " [" << range.min << ", " << range.max << "]\n";
+        return name;
+    }
+};
+
+/// @brief Prints the comment with the format of a variable.
+static inline std::string __format(fixed_point_emitter_t &emitter, const std::string &name)
+{
+    std::stringstream ss;
+    interval_t range = emitter.variable_range(name);
+    ss << "Q" << emitter.variable_fraction(name) << " [" << range.min << ", " << range.max << "]";
+    return ss.str();
+}
+
+std::string generate_fixed_point(const analog_model_t &model,
+                                 const std::string &name,
+                                 const fixed_point_options_t &options,
+                                 codegen_report_t *report)
+{
+    std::stringstream ss;
+
+    // There is no floating-point unit to compute the coefficients which
+    // depend on the timestep, so the timestep is a constant.
+    codegen_options_t codegen = options.codegen;
+    codegen.fixed_timestep    = true;
+    codegen.cache_timestep    = false;
+    if (ts.get_value() <= 0)
+        std::cerr << "The fixed-point code needs a timestep, set it through `ts.set_value()`.\n";
+
+    expression_dag_t dag    = lower_model(model, codegen, report);
+    model_members_t members = collect_members(model, dag, codegen, report);
+    auto system             = model.get_system();
+
+    fixed_point_emitter_t emitter(dag, options);
+    // The system variables and the inputs have the range set by the user.
+    // Their current value is not a range, since they change at runtime, so
+    // the ones without a range get the default one.
+    for (const auto &group : { system.values, system.inputs })
+        for (const auto &value : group)
+            if (value.has_range())
+                emitter.set_range(value.get_name(), interval_t{ value.get_min(), value.get_max() });
+    for (const auto &range : options.ranges)
+        emitter.set_range(range.first, interval_t{ range.second.first, range.second.second });
+
+    // The coefficients which depend only on the parameters are computed by
+    // update_parameters().
+    std::stringstream parameter_code, step_code;
+    std::vector<std::size_t> parameter_nodes;
+    std::vector<std::string> parameter_coefficients;
+    if (codegen.hoist_parameters)
+        parameter_nodes = dag.frontier(dag_stage_t::parameter);
+    for (std::size_t node : parameter_nodes) {
+        parameter_coefficients.emplace_back("_kp" + std::to_string(parameter_coefficients.size()));
+        emitter.set_range(parameter_coefficients.back(), emitter.range(node));
+        emitter.emit_statement(parameter_code, dag_statement_t{ parameter_coefficients.back(), node }, "        ");
+    }
+    cost_report_t parameter_cost = emitter.take_cost();
+    emitter.reset();
+    for (std::size_t i = 0; i < parameter_nodes.size(); ++i)
+        emitter.bind(parameter_nodes[i], parameter_coefficients[i]);
+    for (const auto &statement : dag.statements())
+        emitter.emit_statement(step_code, statement, "        ");
+    cost_report_t step_cost = emitter.take_cost();
+    if (emitter.failed())
+        return std::string();
+
+    // Every member needs a format, including the unused ones.
+    std::vector<std::string> variables;
+    for (const auto &edge : members.edges) {
+        variables.emplace_back(edge + ".pot");
+        variables.emplace_back(edge + ".flw");
+    }
+    for (const auto &group : { members.values, members.inputs, members.support, parameter_coefficients })
+        variables.insert(variables.end(), group.begin(), group.end());
+
+    ss << "//" << std::string(78, '=') << "\n";
+    ss << "\n";
+    ss << "#include <symsolbin/simulation/analog_pair.hpp>\n";
+    ss << "#include <symsolbin/simulation/fixed_point.hpp>\n";
+    ss << "\n";
+    ss << "#include <cstring>\n";
+    ss << "\n";
+    ss << "/// Simulates the model with fixed-point integers, each variable is\n";
+    ss << "/// stored in Q format, with the fractional bits shown next to it.\n";
+    ss << "class " << name << " {\n";
+    ss << "public:\n";
+    ss << "    /// The timestep of each step.\n";
+    ss << "    static constexpr double timestep = " << print_double_literal(ts.get_value()) << ";\n";
+    if (!members.edges.empty()) {
+        ss << "    /// Analog edges.\n";
+        for (const auto &edge : members.edges)
+            ss << "    basic_analog_pair_t<fixed_t> " << edge << "; // pot " << __format(emitter, edge + ".pot")
+               << ", flw " << __format(emitter, edge + ".flw") << "\n";
+    }
+    const std::vector<std::pair<std::string, std::vector<std::string>>> groups = {
+        { "System variables.", members.values },
+        { "System inputs.", members.inputs },
+        { "Support variables.", members.support },
+        { "Coefficients which depend only on the system variables.", parameter_coefficients }
+    };
+    for (const auto &group : groups) {
+        if (group.second.empty())
+            continue;
+        ss << "    /// " << group.first << "\n";
+        for (const auto &variable : group.second)
+            ss << "    fixed_t " << variable << "; // " << __format(emitter, variable) << "\n";
+    }
+    if (!emitter.tables().empty()) {
+        ss << "    /// Tables of the function calls, see fx_lookup().\n";
+        ss << emitter.tables();
+    }
+    ss << "    /// Constructor.\n";
+    ss << "    " << name << "()";
+    std::vector<std::string> initializers;
+    for (const auto &group : { members.edges, members.values, members.inputs, members.support, parameter_coefficients })
+        for (const auto &variable : group)
+            initializers.emplace_back(variable + "()");
+    for (std::size_t i = 0; i < initializers.size(); ++i)
+        ss << ((i > 0) ? ",\n        " : " :\n        ") << initializers[i];
+    ss << "\n";
+    ss << "    {\n";
+    ss << "    }\n";
+    ss << "    /// Computes the coefficients which depend only on the system\n";
+    ss << "    /// variables, must be called every time one of them changes.\n";
+    ss << "    void update_parameters() {\n";
+    ss << parameter_code.str();
+    ss << "    }\n";
+    ss << "    void run() {\n";
+    ss << step_code.str();
+    ss << "    }\n";
+    ss << "    /// Returns a pointer to a variable, e.g., `C0.pot`, and its\n";
+    ss << "    /// fractional bits, or nullptr if there is no such variable.\n";
+    ss << "    fixed_t *variable(const char *name, int &fraction) {\n";
+    for (const auto &variable : variables) {
+        ss << "        if (std::strcmp(name, \"" << variable << "\") == 0) {\n";
+        ss << "            fraction = " << emitter.variable_fraction(variable) << ";\n";
+        ss << "            return &" << variable << ";\n";
+        ss << "        }\n";
+    }
+    ss << "        return nullptr;\n";
+    ss << "    }\n";
+    ss << "    /// Sets a variable, converting the value to its format.\n";
+    ss << "    bool set(const char *name, double value) {\n";
+    ss << "        int fraction;\n";
+    ss << "        fixed_t *variable = this->variable(name, fraction);\n";
+    ss << "        if (variable)\n";
+    ss << "            *variable = fx_from_double(value, fraction);\n";
+    ss << "        return variable != nullptr;\n";
+    ss << "    }\n";
+    ss << "    /// Returns the value of a variable, or zero if it does not exist.\n";
+    ss << "    double get(const char *name) {\n";
+    ss << "        int fraction;\n";
+    ss << "        fixed_t *variable = this->variable(name, fraction);\n";
+    ss << "        return variable ? fx_to_double(*variable, fraction) : 0.0;\n";
+    ss << "    }\n";
+    ss << "};\n";
+    ss << "// " << std::string(77, '=') << "\n\n";
+    if (report) {
+        report->temporaries    = emitter.temporaries();
+        report->cost           = step_cost;
+        report->parameter_cost = parameter_cost;
+        report->timestep_cost  = cost_report_t();
+    }
+    return ss.str();
+}
+
+} // namespace symsolbin
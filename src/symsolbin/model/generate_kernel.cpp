@@ -0,0 +1,174 @@
+/// @file generate_kernel.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Generates the step of the model as a C function working on arrays.
+
+#include "symsolbin/model/model_gen.hpp"
+#include "symsolbin/model/expression_dag.hpp"
+#include "symsolbin/solver/ginac_helper.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace symsolbin
+{
+
+/// @brief Returns the name of a variable as a C identifier, e.g., `C0_pot`
+/// for `C0.pot`.
+static inline std::string __identifier(std::string name)
+{
+    std::replace(name.begin(), name.end(), '.', '_');
+    return name;
+}
+
+/// @brief Prints the indices of the entries of an array, as enumerators.
+static inline void __print_indices(std::ostream &out, const std::string &prefix, const std::vector<std::string> &names)
+{
+    for (std::size_t i = 0; i < names.size(); ++i)
+        out << "    " << prefix << "_" << __identifier(names[i]) << " = " << i << ",\n";
+    out << "    " << prefix << "_count = " << names.size() << ",\n";
+}
+
+/// @brief Prints the names of the entries of an array, terminated by NULL.
+static inline void __print_names(std::ostream &out, const std::string &array, const std::vector<std::string> &names)
+{
+    out << "    static const char *const " << array << "[] = { ";
+    for (const auto &name : names)
+        out << "\"" << name << "\", ";
+    out << "NULL };\n";
+}
+
+std::string generate_kernel(const analog_model_t &model,
+                            const std::string &name,
+                            const codegen_options_t &options,
+                            codegen_report_t *report)
+{
+    std::stringstream ss;
+
+    // Nothing is cached between two calls, so the coefficients are computed
+    // inline.
+    codegen_options_t codegen = options;
+    codegen.hoist_parameters  = false;
+    codegen.cache_timestep    = false;
+
+    expression_dag_t dag    = lower_model(model, codegen, report);
+    model_members_t members = collect_members(model, dag, codegen, report);
+    auto system             = model.get_system();
+
+    // The system variables and the inputs are read-only, and only the
+    // support variables are carried from one step to the next. The edges
+    // are computed again by every step, inside a local array.
+    std::vector<std::string> params, state, edges, out;
+    params.insert(params.end(), members.values.begin(), members.values.end());
+    params.insert(params.end(), members.inputs.begin(), members.inputs.end());
+    state.insert(state.end(), members.support.begin(), members.support.end());
+    for (const auto &edge : members.edges) {
+        edges.emplace_back(edge + ".pot");
+        edges.emplace_back(edge + ".flw");
+    }
+    for (const auto &unknown : (system.outputs.empty() ? system.unknowns : system.outputs))
+        if (std::find(edges.begin(), edges.end(), unknown.get_name()) != edges.end())
+            out.emplace_back(unknown.get_name());
+    std::sort(out.begin(), out.end());
+
+    dag_printer_t printer(dag, codegen.cse);
+    printer.set_plain_c();
+    for (std::size_t i = 0; i < params.size(); ++i)
+        printer.rename(params[i], "params[" + std::to_string(i) + "]");
+    for (std::size_t i = 0; i < state.size(); ++i)
+        printer.rename(state[i], "state[" + std::to_string(i) + "]");
+    for (std::size_t i = 0; i < edges.size(); ++i)
+        printer.rename(edges[i], "edges[" + std::to_string(i) + "]");
+    std::stringstream body;
+    for (const auto &statement : dag.statements())
+        printer.print_statement(body, statement, "    ");
+
+    ss << "/*" << std::string(76, '=') << "*/\n";
+    ss << "\n";
+    ss << "#include <math.h>\n";
+    ss << "#include <stddef.h>\n";
+    ss << "\n";
+    ss << "/* Define it as empty, before including this file, to give external\n";
+    ss << " * linkage to the functions, e.g., to load them from another language. */\n";
+    ss << "#ifndef SYMSOLBIN_KERNEL_API\n";
+    ss << "#define SYMSOLBIN_KERNEL_API static inline\n";
+    ss << "#endif\n";
+    ss << "\n";
+    ss << "#ifndef SYMSOLBIN_KERNEL_LAYOUT\n";
+    ss << "#define SYMSOLBIN_KERNEL_LAYOUT\n";
+    ss << "/* Describes the arrays of a kernel, the names are in the order of the\n";
+    ss << " * entries, e.g., `C0.pot`, and terminated by NULL. */\n";
+    ss << "typedef struct {\n";
+    ss << "    size_t params;\n";
+    ss << "    size_t state;\n";
+    ss << "    size_t out;\n";
+    ss << "    const char *const *param_names;\n";
+    ss << "    const char *const *state_names;\n";
+    ss << "    const char *const *out_names;\n";
+    ss << "} symsolbin_layout_t;\n";
+    ss << "#endif\n";
+    ss << "\n";
+    ss << "/* The index of each entry of the arrays of " << name << "_step(). */\n";
+    ss << "enum {\n";
+    __print_indices(ss, name + "_param", params);
+    __print_indices(ss, name + "_state", state);
+    __print_indices(ss, name + "_out", out);
+    ss << "};\n";
+    ss << "\n";
+    ss << "#ifdef __cplusplus\n";
+    ss << "extern \"C\" {\n";
+    ss << "#endif\n";
+    ss << "\n";
+    ss << "/* Returns the layout of the arrays of " << name << "_step(). */\n";
+    ss << "SYMSOLBIN_KERNEL_API const symsolbin_layout_t *" << name << "_layout(void)\n";
+    ss << "{\n";
+    __print_names(ss, "param_names", params);
+    __print_names(ss, "state_names", state);
+    __print_names(ss, "out_names", out);
+    ss << "    static const symsolbin_layout_t layout = {\n";
+    ss << "        " << params.size() << ", " << state.size() << ", " << out.size() << ", param_names, state_names, out_names\n";
+    ss << "    };\n";
+    ss << "    return &layout;\n";
+    ss << "}\n";
+    ss << "\n";
+    ss << "/* Advances the model by one step.\n";
+    ss << " * params: the system variables followed by the inputs, which are only read.\n";
+    ss << " * state: the support variables, carried between the steps.\n";
+    ss << " * out: receives the outputs of the model.\n";
+    ss << " * ts: the timestep. */\n";
+    std::string signature = "SYMSOLBIN_KERNEL_API void " + name + "_step(";
+    std::string align(signature.size(), ' ');
+    ss << signature << "const double *__restrict params,\n";
+    ss << align << "double *__restrict state,\n";
+    ss << align << "double *__restrict out,\n";
+    ss << align << "double ts)\n";
+    ss << "{\n";
+    // Silence the warnings for the arguments some models never use.
+    ss << "    (void)params;\n";
+    ss << "    (void)state;\n";
+    ss << "    (void)out;\n";
+    ss << "    (void)ts;\n";
+    if (!edges.empty()) {
+        ss << "    /* The potentials and flows of the edges, computed again by every step. */\n";
+        ss << "    double edges[" << edges.size() << "] = { 0 };\n";
+    }
+    ss << body.str();
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        auto index = std::find(edges.begin(), edges.end(), out[i]) - edges.begin();
+        ss << "    out[" << i << "] = edges[" << index << "];\n";
+    }
+    ss << "}\n";
+    ss << "\n";
+    ss << "#ifdef __cplusplus\n";
+    ss << "} /* extern \"C\" */\n";
+    ss << "#endif\n";
+    ss << "/*" << std::string(76, '=') << "*/\n\n";
+    if (report) {
+        report->temporaries    = printer.temporaries();
+        report->cost           = printer.cost();
+        report->parameter_cost = cost_report_t();
+        report->timestep_cost  = cost_report_t();
+    }
+    return ss.str();
+}
+
+} // namespace symsolbin
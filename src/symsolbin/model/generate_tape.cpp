@@ -0,0 +1,265 @@
+/// @file generate_tape.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Lowers the solved model into a bytecode tape.
+
+#include "symsolbin/model/model_gen.hpp"
+#include "symsolbin/model/expression_dag.hpp"
+#include "symsolbin/solver/ginac_helper.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace symsolbin
+{
+
+/// @brief Marks the nodes which have not been assigned to a register yet.
+static const std::uint32_t __no_register = std::numeric_limits<std::uint32_t>::max();
+
+/// @brief Returns the tape operation implementing a function call.
+static inline bool __call_op(const std::string &name, std::size_t arity, tape_op_t &op)
+{
+    static const std::map<std::string, tape_op_t> unary = {
+        { "sqrt", tape_op_t::sqrt }, { "exp", tape_op_t::exp }, { "log", tape_op_t::log },
+        { "sin", tape_op_t::sin }, { "cos", tape_op_t::cos }, { "tan", tape_op_t::tan },
+        { "asin", tape_op_t::asin }, { "acos", tape_op_t::acos }, { "atan", tape_op_t::atan },
+        { "sinh", tape_op_t::sinh }, { "cosh", tape_op_t::cosh }, { "tanh", tape_op_t::tanh },
+        { "abs", tape_op_t::abs }
+    };
+    static const std::map<std::string, tape_op_t> binary = {
+        { "pow", tape_op_t::pow }, { "atan2", tape_op_t::atan2 }
+    };
+    const auto &table = (arity == 1) ? unary : binary;
+    auto it           = table.find(name);
+    if ((arity > 2) || (it == table.end()))
+        return false;
+    op = it->second;
+    return true;
+}
+
+/// @brief Emits the instructions of the DAG nodes into the tape.
+class tape_emitter_t {
+public:
+    /// @brief Constructor.
+    tape_emitter_t(const expression_dag_t &dag, tape_t &tape)
+        : _dag(dag),
+          _tape(tape),
+          _uses(dag.count_uses()),
+          _registers(dag.nodes().size(), __no_register),
+          _symbols(),
+          _failed()
+    {
+        // Nothing to do.
+    }
+
+    /// @brief Checks if something could not be emitted, e.g., an unknown
+    /// variable or an unsupported function.
+    inline bool failed() const
+    {
+        return _failed;
+    }
+
+    /// @brief Associates a register to a symbol.
+    inline void bind(const std::string &name, std::uint32_t index)
+    {
+        _symbols[name] = index;
+    }
+
+    /// @brief Emits the node, if not emitted yet, and returns its register.
+    std::uint32_t emit(tape_section_t section, std::size_t node)
+    {
+        if (_registers[node] == __no_register) {
+            const dag_node_t &n = _dag.nodes()[node];
+            if (n.op == dag_op_t::constant) {
+                _registers[node] = _tape.add_register(n.value);
+            } else if (n.op == dag_op_t::symbol) {
+                _registers[node] = this->__symbol(n.name);
+            } else {
+                std::uint32_t dst = _tape.add_register();
+                this->__emit_operation(section, node, dst);
+                _registers[node] = dst;
+            }
+        }
+        return _registers[node];
+    }
+
+    /// @brief Emits the statement `target = node`.
+    void emit_statement(tape_section_t section, const dag_statement_t &statement)
+    {
+        std::uint32_t target = this->__symbol(statement.target);
+        std::size_t node     = statement.node;
+        const dag_node_t &n  = _dag.nodes()[node];
+        // When the root is used only by this statement, compute it directly
+        // inside the target register.
+        if ((_registers[node] == __no_register) && (_uses[node] == 1) &&
+            (n.op != dag_op_t::constant) && (n.op != dag_op_t::symbol)) {
+            this->__emit_operation(section, node, target);
+            _registers[node] = target;
+        } else {
+            std::uint32_t source = this->emit(section, node);
+            if (source != target)
+                _tape.emit(section, tape_instruction_t{ tape_op_t::copy, target, source, 0 });
+        }
+    }
+
+private:
+    /// The DAG.
+    const expression_dag_t &_dag;
+    /// The tape.
+    tape_t &_tape;
+    /// The uses of each node.
+    std::vector<unsigned> _uses;
+    /// The register of each emitted node.
+    std::vector<std::uint32_t> _registers;
+    /// The register of each symbol.
+    std::map<std::string, std::uint32_t> _symbols;
+    /// If something could not be emitted.
+    bool _failed;
+
+    /// @brief Returns the register of a symbol.
+    std::uint32_t __symbol(const std::string &name)
+    {
+        auto it = _symbols.find(name);
+        if (it != _symbols.end())
+            return it->second;
+        std::cerr << "The tape reads the unknown variable `" << name << "`.\n";
+        _failed = true;
+        return _symbols[name] = _tape.add_register();
+    }
+
+    /// @brief Emits the operation of a node, writing the result inside dst.
+    void __emit_operation(tape_section_t section, std::size_t node, std::uint32_t dst)
+    {
+        const dag_node_t &n = _dag.nodes()[node];
+        std::vector<std::uint32_t> args;
+        for (std::size_t arg : n.args)
+            args.emplace_back(this->emit(section, arg));
+        switch (n.op) {
+        case dag_op_t::add:
+        case dag_op_t::mul: {
+            // Chain the n-ary operation as binary ones.
+            tape_op_t op      = (n.op == dag_op_t::add) ? tape_op_t::add : tape_op_t::mul;
+            std::uint32_t acc = args[0];
+            for (std::size_t i = 1; i < args.size(); ++i) {
+                std::uint32_t result = (i + 1 == args.size()) ? dst : _tape.add_register();
+                _tape.emit(section, tape_instruction_t{ op, result, acc, args[i] });
+                acc = result;
+            }
+            break;
+        }
+        case dag_op_t::sub:
+            _tape.emit(section, tape_instruction_t{ tape_op_t::sub, dst, args[0], args[1] });
+            break;
+        case dag_op_t::div:
+            _tape.emit(section, tape_instruction_t{ tape_op_t::div, dst, args[0], args[1] });
+            break;
+        case dag_op_t::neg:
+            _tape.emit(section, tape_instruction_t{ tape_op_t::neg, dst, args[0], 0 });
+            break;
+        case dag_op_t::pow:
+            _tape.emit(section, tape_instruction_t{ tape_op_t::powi, dst, args[0], static_cast<std::uint32_t>(n.value) });
+            break;
+        case dag_op_t::call: {
+            tape_op_t op = tape_op_t::copy;
+            if (__call_op(n.name, args.size(), op)) {
+                _tape.emit(section, tape_instruction_t{ op, dst, args[0], (args.size() > 1) ? args[1] : 0 });
+            } else {
+                std::cerr << "The tape does not support the function `" << n.name << "`.\n";
+                _failed = true;
+            }
+            break;
+        }
+        case dag_op_t::constant:
+        case dag_op_t::symbol:
+            _tape.emit(section, tape_instruction_t{ tape_op_t::copy, dst, this->emit(section, node), 0 });
+            break;
+        }
+    }
+};
+
+/// @brief Counts the operations performed by a section of the tape.
+static inline cost_report_t __tape_cost(const std::vector<tape_instruction_t> &code)
+{
+    cost_report_t cost;
+    for (const auto &instruction : code) {
+        switch (instruction.op) {
+        case tape_op_t::copy:
+            break;
+        case tape_op_t::add:
+        case tape_op_t::sub:
+        case tape_op_t::neg:
+            ++cost.adds;
+            break;
+        case tape_op_t::mul:
+        case tape_op_t::powi:
+            ++cost.muls;
+            break;
+        case tape_op_t::div:
+            ++cost.divs;
+            break;
+        default:
+            ++cost.calls;
+            break;
+        }
+    }
+    return cost;
+}
+
+tape_t generate_tape(const analog_model_t &model,
+                     const codegen_options_t &options,
+                     codegen_report_t *report)
+{
+    auto structure = model.get_structure();
+    auto solution  = model.get_solution();
+    auto system    = model.get_system();
+
+    expression_dag_t dag = lower_model(model, options, report);
+
+    tape_t tape;
+    tape_emitter_t emitter(dag, tape);
+    // Every variable of the model gets its own register, the system
+    // variables start from their value.
+    std::vector<std::pair<std::string, double>> names;
+    for (const auto &edge : structure.edges) {
+        names.emplace_back(edge.get_alias() + ".pot", 0.0);
+        names.emplace_back(edge.get_alias() + ".flw", 0.0);
+    }
+    for (const auto &value : system.values)
+        names.emplace_back(value.get_name(), value.get_value());
+    for (const auto &value : system.inputs)
+        names.emplace_back(value.get_name(), 0.0);
+    for (const auto &value : solution.values)
+        names.emplace_back(value.get_name(), 0.0);
+    for (const auto &name : names) {
+        std::uint32_t index = tape.add_register(name.second);
+        tape.add_variable(name.first, index);
+        emitter.bind(name.first, index);
+    }
+    emitter.bind(ts.get_name(), tape.timestep_register());
+
+    // Same staging of generate_class.
+    if (options.hoist_parameters)
+        for (std::size_t node : dag.frontier(dag_stage_t::parameter))
+            emitter.emit(tape_section_t::parameter, node);
+    if (options.cache_timestep && !options.fixed_timestep)
+        for (std::size_t node : dag.frontier(dag_stage_t::timestep))
+            emitter.emit(tape_section_t::timestep, node);
+    for (const auto &statement : dag.statements())
+        emitter.emit_statement(tape_section_t::step, statement);
+    // A tape which computes something else than the model is worse than
+    // no tape at all.
+    if (emitter.failed()) {
+        std::cerr << "Failed to lower the model into a tape.\n";
+        return tape_t();
+    }
+
+    if (report) {
+        report->temporaries    = tape.registers() - names.size() - 1;
+        report->cost           = __tape_cost(tape.code(tape_section_t::step));
+        report->parameter_cost = __tape_cost(tape.code(tape_section_t::parameter));
+        report->timestep_cost  = __tape_cost(tape.code(tape_section_t::timestep));
+    }
+    return tape;
+}
+
+} // namespace symsolbin
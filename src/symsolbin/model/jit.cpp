@@ -0,0 +1,408 @@
+/// @file jit.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Compiles the generated code into a shared object and loads it.
+
+#include "symsolbin/model/jit.hpp"
+#include "symsolbin/solver/hash.hpp"
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifndef SYMSOLBIN_INCLUDE_DIR
+/// The directory containing the headers inside the source tree, set by CMake.
+#define SYMSOLBIN_INCLUDE_DIR ""
+#endif
+
+#ifndef SYMSOLBIN_INSTALL_INCLUDE_DIR
+/// The directory where the headers are installed, set by CMake.
+#define SYMSOLBIN_INSTALL_INCLUDE_DIR ""
+#endif
+
+#ifndef SYMSOLBIN_VERSION
+/// The version of the library, set by CMake.
+#define SYMSOLBIN_VERSION ""
+#endif
+
+namespace symsolbin
+{
+
+/// @brief The name of the class inside the shared object.
+#define JIT_CLASS_NAME "symsolbin_jit_model"
+
+/// @brief Returns the directory where the objects are cached.
+static inline std::string __cache_directory(const jit_options_t &options)
+{
+    if (!options.cache_directory.empty())
+        return options.cache_directory;
+    if (const char *path = std::getenv("SYMSOLBIN_JIT_CACHE"))
+        return path;
+    if (const char *path = std::getenv("XDG_CACHE_HOME"))
+        return std::string(path) + "/symsolbin/jit";
+    if (const char *path = std::getenv("HOME"))
+        return std::string(path) + "/.cache/symsolbin/jit";
+    return "/tmp/symsolbin/jit";
+}
+
+/// @brief Creates a directory and its parents, like `mkdir -p`.
+static inline bool __make_directories(const std::string &path)
+{
+    for (std::size_t position = 1; position <= path.size(); ++position) {
+        if ((position == path.size()) || (path[position] == '/')) {
+            std::string parent = path.substr(0, position);
+            if ((mkdir(parent.c_str(), 0755) != 0) && (errno != EEXIST))
+                return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Quotes a path for the shell.
+static inline std::string __quote(const std::string &path)
+{
+    std::string quoted = "'";
+    for (char c : path)
+        quoted += (c == '\'') ? std::string("'\\''") : std::string(1, c);
+    return quoted + "'";
+}
+
+/// @brief Checks if a file exists.
+static inline bool __exists(const std::string &path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+/// @brief The headers included by the generated source, relative to the
+/// include directory.
+static const char *const __runtime_headers[] = {
+    "symsolbin/simulation/analog_pair.hpp",
+    "symsolbin/simulation/double_op.hpp",
+    "symsolbin/simulation/simulation.hpp",
+};
+
+/// @brief Returns the directory containing the headers used by the generated
+/// source: the one of the options, `$SYMSOLBIN_JIT_INCLUDE`, then the source
+/// tree the library was built from and its installation prefix, if they
+/// contain the headers.
+/// @return the directory, or an empty string if none is found.
+static inline std::string __include_directory(const jit_options_t &options)
+{
+    if (!options.include_directory.empty())
+        return options.include_directory;
+    if (const char *path = std::getenv("SYMSOLBIN_JIT_INCLUDE"))
+        return path;
+    for (const std::string path : { SYMSOLBIN_INCLUDE_DIR, SYMSOLBIN_INSTALL_INCLUDE_DIR })
+        if (!path.empty() && __exists(path + "/" + __runtime_headers[0]))
+            return path;
+    return std::string();
+}
+
+/// @brief Adds the contents of the headers used by the generated source to
+/// the hash, so that changing them invalidates the cached objects.
+/// @return false if a header cannot be read.
+static inline bool __hash_headers(const std::string &include_directory, hash_t &hash)
+{
+    for (const char *header : __runtime_headers) {
+        std::ifstream in(include_directory + "/" + header);
+        if (!in) {
+            std::cerr << "Failed to read " << include_directory << "/" << header << "\n";
+            return false;
+        }
+        std::stringstream contents;
+        contents << in.rdbuf();
+        hash.update(contents.str());
+    }
+    return true;
+}
+
+/// @brief Returns the names of the variables of the generated class, in
+/// the same order used by generate_class.
+static inline std::vector<std::string> __variables(const analog_model_t &model, const codegen_options_t &options)
+{
+    model_members_t members = collect_members(model, lower_model(model, options), options);
+    std::vector<std::string> names;
+    for (const auto &edge : members.edges) {
+        names.emplace_back(edge + ".pot");
+        names.emplace_back(edge + ".flw");
+    }
+    for (const auto &group : { members.values, members.inputs, members.support })
+        names.insert(names.end(), group.begin(), group.end());
+    return names;
+}
+
+/// @brief Generates the source of the shared object: the class, plus the
+/// C-ABI functions used to drive it.
+static inline std::string __generate_source(const analog_model_t &model, const codegen_options_t &options)
+{
+    std::vector<std::string> names = __variables(model, options);
+    std::stringstream ss;
+    ss << "#include <symsolbin/simulation/analog_pair.hpp>\n";
+    ss << "#include <symsolbin/simulation/simulation.hpp>\n";
+    ss << "\n";
+    ss << "#include <cstddef>\n";
+    ss << "\n";
+    ss << "using namespace symsolbin;\n";
+    ss << "\n";
+    ss << generate_class(model, JIT_CLASS_NAME, options);
+    ss << "static const char *symsolbin_names[] = {\n";
+    for (const auto &name : names)
+        ss << "    \"" << name << "\",\n";
+    ss << "};\n";
+    ss << "\n";
+    ss << "extern \"C\" {\n";
+    ss << "\n";
+    ss << "void *symsolbin_create() {\n";
+    ss << "    return new " JIT_CLASS_NAME "();\n";
+    ss << "}\n";
+    ss << "\n";
+    ss << "void symsolbin_destroy(void *instance) {\n";
+    ss << "    delete static_cast<" JIT_CLASS_NAME " *>(instance);\n";
+    ss << "}\n";
+    ss << "\n";
+    ss << "void symsolbin_update_parameters(void *instance) {\n";
+    ss << "    static_cast<" JIT_CLASS_NAME " *>(instance)->update_parameters();\n";
+    ss << "}\n";
+    ss << "\n";
+    ss << "void symsolbin_step(void *instance, double ts) {\n";
+    ss << "    _system_timestep() = ts;\n";
+    ss << "    static_cast<" JIT_CLASS_NAME " *>(instance)->run();\n";
+    ss << "}\n";
+    ss << "\n";
+    ss << "std::size_t symsolbin_variable_count() {\n";
+    ss << "    return " << names.size() << ";\n";
+    ss << "}\n";
+    ss << "\n";
+    ss << "const char *symsolbin_variable_name(std::size_t index) {\n";
+    ss << "    return symsolbin_names[index];\n";
+    ss << "}\n";
+    ss << "\n";
+    ss << "double *symsolbin_variable(void *instance, std::size_t index) {\n";
+    ss << "    auto *model = static_cast<" JIT_CLASS_NAME " *>(instance);\n";
+    ss << "    switch (index) {\n";
+    for (std::size_t i = 0; i < names.size(); ++i)
+        ss << "    case " << i << ": return &model->" << names[i] << ";\n";
+    ss << "    default: return nullptr;\n";
+    ss << "    }\n";
+    ss << "}\n";
+    ss << "\n";
+    ss << "} // extern \"C\"\n";
+    return ss.str();
+}
+
+/// @brief Returns a suffix for the temporary files, unique among the
+/// processes and among the calls of the same process.
+static inline std::string __temporary_suffix()
+{
+    static std::atomic<unsigned long> counter(0);
+    return "." + std::to_string(getpid()) + "." + std::to_string(counter++) + ".tmp";
+}
+
+/// @brief Writes the source through a temporary file, so that concurrent
+/// processes never compile a partial source.
+static inline bool __write_source(const std::string &code, const std::string &source)
+{
+    std::string temporary = source + __temporary_suffix();
+    std::ofstream out(temporary);
+    out << code;
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write the source " << temporary << "\n";
+        std::remove(temporary.c_str());
+        return false;
+    }
+    if (std::rename(temporary.c_str(), source.c_str()) != 0) {
+        std::cerr << "Failed to move the source to " << source << "\n";
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/// @brief Compiles the source into the shared object, going through a
+/// temporary file so that concurrent processes never load a partial object.
+static inline bool __compile(const std::string &source,
+                             const std::string &object,
+                             const std::string &include_directory,
+                             const jit_options_t &options)
+{
+    std::string temporary = object + __temporary_suffix();
+    std::string log       = object + ".log";
+    std::stringstream command;
+    command << options.compiler << " " << options.flags << " -fPIC -shared";
+    command << " -I" << __quote(include_directory);
+    command << " " << __quote(source) << " -o " << __quote(temporary) << " > " << __quote(log) << " 2>&1";
+    if (std::system(command.str().c_str()) != 0) {
+        std::cerr << "Failed to compile the model, see " << log << "\n";
+        std::remove(temporary.c_str());
+        return false;
+    }
+    if (std::rename(temporary.c_str(), object.c_str()) != 0) {
+        std::cerr << "Failed to move the compiled model to " << object << "\n";
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/// @brief Loads a function from the shared object.
+template <typename Function>
+static inline bool __load(void *library, const char *name, Function &function)
+{
+    function = reinterpret_cast<Function>(dlsym(library, name));
+    if (function == nullptr)
+        std::cerr << "Failed to find " << name << ": " << dlerror() << "\n";
+    return function != nullptr;
+}
+
+jit_model_t::jit_model_t()
+    : _library(nullptr),
+      _instance(nullptr),
+      _step(nullptr),
+      _update_parameters(nullptr),
+      _destroy(nullptr),
+      _names(),
+      _variables(),
+      _path()
+{
+    // Nothing to do.
+}
+
+jit_model_t::~jit_model_t()
+{
+    this->__release();
+}
+
+jit_model_t::jit_model_t(jit_model_t &&other) noexcept
+    : jit_model_t()
+{
+    *this = std::move(other);
+}
+
+jit_model_t &jit_model_t::operator=(jit_model_t &&other) noexcept
+{
+    if (this != &other) {
+        this->__release();
+        _library           = other._library;
+        _instance          = other._instance;
+        _step              = other._step;
+        _update_parameters = other._update_parameters;
+        _destroy           = other._destroy;
+        _names             = std::move(other._names);
+        _variables         = std::move(other._variables);
+        _path              = std::move(other._path);
+        other._library     = nullptr;
+        other._instance    = nullptr;
+    }
+    return *this;
+}
+
+void jit_model_t::update_parameters()
+{
+    if (this->valid())
+        _update_parameters(_instance);
+}
+
+double *jit_model_t::variable(const std::string &name) const
+{
+    auto it = _variables.find(name);
+    return (it == _variables.end()) ? nullptr : it->second;
+}
+
+double jit_model_t::get(const std::string &name) const
+{
+    double *value = this->variable(name);
+    return value ? *value : 0.0;
+}
+
+bool jit_model_t::set(const std::string &name, double value)
+{
+    double *variable = this->variable(name);
+    if (variable)
+        *variable = value;
+    return variable != nullptr;
+}
+
+void jit_model_t::__release()
+{
+    if (_instance)
+        _destroy(_instance);
+    if (_library)
+        dlclose(_library);
+    _instance = nullptr;
+    _library  = nullptr;
+}
+
+jit_model_t jit_compile(const analog_model_t &model, const jit_options_t &options)
+{
+    codegen_options_t codegen = options.codegen;
+    codegen.hoist_parameters  = true;
+    codegen.scalar_template   = false;
+    codegen.contiguous_state  = false;
+    std::string code          = __generate_source(model, codegen);
+
+    jit_model_t result;
+    std::string include_directory = __include_directory(options);
+    if (include_directory.empty()) {
+        std::cerr << "Failed to find the symsolbin headers, set jit_options_t::include_directory or $SYMSOLBIN_JIT_INCLUDE.\n";
+        return result;
+    }
+
+    // Everything that changes the object is part of the hash, headers
+    // included.
+    hash_t hash;
+    hash.update(code).update(options.compiler).update(options.flags).update(include_directory).update(SYMSOLBIN_VERSION);
+    if (!__hash_headers(include_directory, hash))
+        return result;
+
+    std::string directory = __cache_directory(options);
+    std::string object    = directory + "/" + hash.str() + ".so";
+    if (!__exists(object)) {
+        if (!__make_directories(directory)) {
+            std::cerr << "Failed to create the cache directory " << directory << "\n";
+            return result;
+        }
+        std::string source = directory + "/" + hash.str() + ".cpp";
+        if (!__write_source(code, source))
+            return result;
+        if (!__compile(source, object, include_directory, options))
+            return result;
+    }
+
+    result._library = dlopen(object.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (result._library == nullptr) {
+        std::cerr << "Failed to load " << object << ": " << dlerror() << "\n";
+        return result;
+    }
+    void *(*create)()                                = nullptr;
+    std::size_t (*count)()                           = nullptr;
+    const char *(*name)(std::size_t)                 = nullptr;
+    double *(*variable)(void *instance, std::size_t) = nullptr;
+    if (!__load(result._library, "symsolbin_create", create) ||
+        !__load(result._library, "symsolbin_destroy", result._destroy) ||
+        !__load(result._library, "symsolbin_update_parameters", result._update_parameters) ||
+        !__load(result._library, "symsolbin_step", result._step) ||
+        !__load(result._library, "symsolbin_variable_count", count) ||
+        !__load(result._library, "symsolbin_variable_name", name) ||
+        !__load(result._library, "symsolbin_variable", variable)) {
+        return result;
+    }
+    result._instance = create();
+    result._path     = object;
+    for (std::size_t i = 0; i < count(); ++i) {
+        result._names.emplace_back(name(i));
+        result._variables[result._names.back()] = variable(result._instance, i);
+    }
+    return result;
+}
+
+} // namespace symsolbin
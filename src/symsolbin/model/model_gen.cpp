@@ -4,285 +4,441 @@
 
 #include "symsolbin/model/model_gen.hpp"
 
+#include "symsolbin/solver/ginac_helper.hpp"
+
+#include <algorithm>
 #include <cassert>
+#include <iostream>
+#include <sstream>
 
 namespace symsolbin
 {
 
-static void __matrix_from_equations(
-    const equation_set_t &eqns,
-    const symbol_set_t &symbols,
-    GiNaC::matrix &A,
-    GiNaC::matrix &b)
+/// @brief Builds the matrices `A x = b` from all the equations of the system,
+/// i.e., the ones of the components and Kirchhoff's laws, with the symbol
+/// replacement used by the solver.
+/// @return false if the system is not square, e.g., because the model has
+/// not been solved, or if it is not linear.
+static bool __linear_system(const analog_model_t &model, GiNaC::matrix &A, GiNaC::matrix &b)
+{
+    auto system   = model.get_system();
+    auto solution = model.get_solution();
+    equation_set_t equations = system.equations;
+    equations.insert(equations.end(), system.kpl.begin(), system.kpl.end());
+    equations.insert(equations.end(), system.kfl.begin(), system.kfl.end());
+    if (equations.size() != system.unknowns.size()) {
+        std::cerr << "The system has " << equations.size() << " equations and "
+                  << system.unknowns.size() << " unknowns, call run_solver() first.\n";
+        return false;
+    }
+    if (!solution.replacement.empty()) {
+        for (auto &equation : equations)
+            equation = GiNaC::ex_to<GiNaC::relational>(GiNaC::subs(equation, solution.replacement, GiNaC::subs_options::algebraic));
+    }
+    if (!ginac_helper::matrix_from_equations(equations, system.unknowns, A, b)) {
+        std::cerr << "The system is not linear in its unknowns.\n";
+        return false;
+    }
+    return true;
+}
+
+/// @brief Joins the names, separated by commas.
+static inline std::string __join(const std::vector<std::string> &names, const std::string &postfix = std::string())
+{
+    std::stringstream ss;
+    for (std::size_t i = 0; i < names.size(); ++i)
+        ss << ((i > 0) ? ", " : "") << names[i] << postfix;
+    return ss.str();
+}
+
+/// @brief Collects the largest subexpressions which depend only on the
+/// parameters and on the timestep, read by the code executed at every step.
+static void __collect_invariants(const expression_dag_t &dag, std::size_t node, std::vector<bool> &visited, std::vector<std::size_t> &invariants)
+{
+    if (visited[node])
+        return;
+    visited[node] = true;
+    const dag_node_t &n = dag.nodes()[node];
+    if ((n.op == dag_op_t::symbol) || (n.op == dag_op_t::constant))
+        return;
+    if (n.stage != dag_stage_t::state) {
+        invariants.emplace_back(node);
+        return;
+    }
+    for (std::size_t arg : n.args)
+        __collect_invariants(dag, arg, visited, invariants);
+}
+
+/// @brief The parts of a class which solves the linear system at every step.
+struct linear_class_t {
+    /// The names of the edges, system variables, inputs and support variables.
+    std::vector<std::string> edges, values, inputs, support;
+    /// The names of the unknowns, in the order of the columns of A.
+    std::vector<std::string> unknowns;
+    /// The DAG, with the statements for A, then b, then the support variables.
+    expression_dag_t dag;
+    /// The number of statements for the entries of A.
+    std::size_t matrix_statements;
+    /// The number of statements for the entries of b.
+    std::size_t rhs_statements;
+    /// The entries of A which change at every step.
+    std::vector<std::size_t> variant;
+    /// The entries of A which change only with the parameters or the timestep.
+    std::vector<std::size_t> invariant;
+    /// The subexpressions computed only when parameters or timestep change.
+    std::vector<std::size_t> coefficients;
+};
+
+/// @brief Lowers the matrix entries (with the given targets), b and the
+/// support equations, and splits the work between the two rates.
+static linear_class_t __lower_linear_class(const analog_model_t &model,
+                                           const std::vector<std::pair<std::string, GiNaC::ex>> &entries,
+                                           const GiNaC::matrix &b,
+                                           const codegen_options_t &options,
+                                           codegen_report_t *report)
 {
-    unsigned equ_size = static_cast<unsigned>(eqns.size());
-    unsigned sym_size = static_cast<unsigned>(symbols.size());
+    auto structure = model.get_structure();
+    auto solution  = model.get_solution();
+    auto system    = model.get_system();
+    std::sort(structure.edges.begin(), structure.edges.end());
+    std::sort(system.values.begin(), system.values.end());
+    std::sort(system.inputs.begin(), system.inputs.end());
+    std::sort(solution.values.begin(), solution.values.end());
+
+    linear_class_t result;
+    for (const auto &edge : structure.edges)
+        result.edges.emplace_back(edge.get_alias());
+    for (const auto &value : system.values)
+        result.values.emplace_back(value.get_name());
+    for (const auto &value : system.inputs)
+        result.inputs.emplace_back(value.get_name());
+    for (const auto &value : solution.values)
+        result.support.emplace_back(value.get_name());
+    for (const auto &unknown : system.unknowns)
+        result.unknowns.emplace_back(unknown.get_name());
 
-    // build matrix from equation system
-    GiNaC::matrix sys(equ_size, sym_size);
-    GiNaC::matrix rhs(equ_size, 1);
-    GiNaC::matrix vars(sym_size, 1);
+    assignment_list_t assignments(entries.begin(), entries.end());
+    for (unsigned r = 0; r < b.rows(); ++r)
+        assignments.emplace_back("b(" + std::to_string(r) + ")", b(r, 0));
+    for (const auto &equation : solution.support)
+        assignments.emplace_back(GiNaC::ex_to<GiNaC::symbol>(equation.lhs()).get_name(), equation.rhs());
+    result.dag               = lower_assignments(model, assignments, options, report);
+    result.matrix_statements = entries.size();
+    result.rhs_statements    = b.rows();
 
-    for (unsigned r = 0; r < equ_size; r++) {
-        // lhs-rhs==0
-        const GiNaC::ex eq = eqns[r].op(0) - eqns[r].op(1);
-        GiNaC::ex linpart  = eq;
-        for (unsigned c = 0; c < sym_size; c++) {
-            const GiNaC::ex co = eq.coeff(GiNaC::ex_to<GiNaC::symbol>(symbols[c]), 1);
-            linpart -= co * symbols[c];
-            sys(r, c) = co;
+    // The entries which depend on the state must be refilled at every step,
+    // the others only when parameters or timestep change.
+    const auto &statements = result.dag.statements();
+    std::vector<bool> visited(result.dag.nodes().size(), false);
+    for (std::size_t i = 0; i < statements.size(); ++i) {
+        bool is_entry = i < result.matrix_statements;
+        if (is_entry && (result.dag.stage(statements[i].node) != dag_stage_t::state)) {
+            result.invariant.emplace_back(i);
+            continue;
         }
-        linpart   = linpart.expand();
-        rhs(r, 0) = -linpart;
+        if (is_entry)
+            result.variant.emplace_back(i);
+        if (options.hoist_parameters)
+            __collect_invariants(result.dag, statements[i].node, visited, result.coefficients);
+    }
+    std::sort(result.coefficients.begin(), result.coefficients.end());
+    return result;
+}
+
+/// @brief Prints the members of a class which solves the linear system.
+static void __print_linear_members(std::ostream &ss, const linear_class_t &lc, const std::vector<std::string> &coefficients)
+{
+    ss << "    /// Analog edges.\n";
+    ss << "    analog_pair_t " << __join(lc.edges) << ";\n";
+    if (!lc.values.empty()) {
+        ss << "    /// System variables.\n";
+        ss << "    analog_value_t " << __join(lc.values) << ";\n";
+    }
+    if (!lc.inputs.empty()) {
+        ss << "    /// System inputs.\n";
+        ss << "    analog_value_t " << __join(lc.inputs) << ";\n";
+    }
+    if (!lc.support.empty()) {
+        ss << "    /// Support variables.\n";
+        ss << "    analog_value_t " << __join(lc.support) << ";\n";
+    }
+    if (!coefficients.empty()) {
+        ss << "    /// Coefficients which depend only on the system variables and on the timestep.\n";
+        ss << "    analog_value_t " << __join(coefficients) << ";\n";
+    }
+}
+
+/// @brief Prints the initialization of the members of the class.
+static void __print_linear_initializers(std::ostream &ss, const linear_class_t &lc, const std::vector<std::string> &coefficients)
+{
+    for (const auto &group : { lc.edges, lc.values, lc.inputs, lc.support, coefficients })
+        if (!group.empty())
+            ss << "        " << __join(group, "()") << ",\n";
+}
+
+/// @brief Prints the code which reads the timestep.
+static void __print_timestep(std::ostream &ss, const codegen_options_t &options)
+{
+    if (options.fixed_timestep) {
+        ss << "        // The timestep is fixed.\n";
+        ss << "        const analog_time_t ts = " << print_double_literal(ts.get_value()) << ";\n";
+    } else {
+        ss << "        // Get the system timestep.\n";
+        ss << "        analog_time_t ts = _system_timestep();\n";
     }
-    A = sys;
-    b = rhs;
 }
 
-std::string generate_class_dense(const analog_model_t &model, const std::string &name)
+std::string generate_class_dense(const analog_model_t &model,
+                                 const std::string &name,
+                                 const codegen_options_t &options,
+                                 codegen_report_t *report)
 {
     std::stringstream ss;
-    GiNaC::csrc_double(ss);
-    
-    auto structure = model.get_structure();
-    auto solution = model.get_solution();
-    auto system = model.get_system();
 
     GiNaC::matrix A;
     GiNaC::matrix b;
+    if (!__linear_system(model, A, b))
+        return std::string();
 
-    __matrix_from_equations(system.equations, system.unknowns, A, b);
+    // The zeros are set once, by the constructor.
+    std::vector<std::pair<std::string, GiNaC::ex>> entries;
+    for (unsigned r = 0; r < A.rows(); ++r)
+        for (unsigned c = 0; c < A.cols(); ++c)
+            if (!A(r, c).is_zero())
+                entries.emplace_back("A(" + std::to_string(r) + ", " + std::to_string(c) + ")", A(r, c));
+    linear_class_t lc = __lower_linear_class(model, entries, b, options, report);
+    const auto &statements = lc.dag.statements();
+    const std::size_t n    = lc.unknowns.size();
+    const std::string type = "Eigen::Matrix<double, " + std::to_string(n) + ", " + std::to_string(n) + ">";
 
-    unsigned equ_size = static_cast<unsigned>(system.equations.size());
-    unsigned unk_size = static_cast<unsigned>(system.unknowns.size());
+    dag_printer_t matrix_printer(lc.dag, options.cse);
+    dag_printer_t printer(lc.dag, options.cse);
+    std::vector<std::string> coefficients;
+    for (std::size_t node : lc.coefficients) {
+        coefficients.emplace_back("_k" + std::to_string(coefficients.size()));
+        printer.bind(node, coefficients.back());
+    }
 
     ss << "//" << std::string(78, '=') << "\n";
-    ss << "#include <Eigen/Dense>\n";
-    ss << "#include <cassert>\n";
     ss << "\n";
-    ss << "#include \"variableTracer.hpp\"\n";
-    ss << "#include \"analog_pair.hpp\"\n";
+    ss << "#include <symsolbin/simulation/analog_pair.hpp>\n";
+    ss << "#include <symsolbin/simulation/simulation.hpp>\n";
+    ss << "\n";
+    ss << "#include <Eigen/Dense>\n";
     ss << "\n";
     ss << "class " << name << " {\n";
     ss << "public:\n";
-    ss << "    Eigen::Matrix<double, " << A.rows() << ", " << A.cols() << "> A;\n";
-    ss << "    Eigen::Matrix<double, " << b.rows() << ", 1> b;\n";
-    ss << "\n";
-    ss << "    Eigen::JacobiSVD<Eigen::Matrix<double, " << A.rows() << ", " << A.cols() << "> solver;\n";
-    ss << "\n";
-    for (const auto &edge : structure.edges)
-        ss << "    analog_pair_t " << edge << ";\n";
-    ss << "\n";
+    __print_linear_members(ss, lc, coefficients);
+    ss << "    /// The matrix of the system.\n";
+    ss << "    " << type << " A;\n";
+    ss << "    /// The right-hand side, and the solution.\n";
+    ss << "    Eigen::Matrix<double, " << n << ", 1> b, x;\n";
+    ss << "    /// The LU factorization of A.\n";
+    ss << "    Eigen::PartialPivLU<" << type << "> solver;\n";
+    ss << "    /// The timestep used to factorize A, negative if it must be factorized.\n";
+    ss << "    analog_time_t _timestep;\n";
+    ss << "    /// Constructor.\n";
     ss << "    " << name << "() :\n";
-    ss << "        A(),\n";
+    __print_linear_initializers(ss, lc, coefficients);
+    ss << "        A(" << type << "::Zero()),\n";
     ss << "        b(),\n";
+    ss << "        x(),\n";
     ss << "        solver(),\n";
-    for (unsigned i = 0; i < structure.edges.size(); ++i) {
-        ss << "        " << structure.edges[i] << "()";
-        if (i < (structure.edges.size() - 1))
-            ss << ",";
-        ss << "\n";
-    }
+    ss << "        _timestep(-1.0)\n";
     ss << "    {\n";
-#if 0
-    ss << "        A << ";
-    for (unsigned r = 0; r < equ_size; r++) {
-        for (unsigned c = 0; c < unk_size; c++) {
-            ss << A(r, c);
-            if (c < (unk_size - 1))
-                ss << ", ";
-        }
-        if (r < (equ_size - 1))
-            ss << ",";
-        else
-            ss << ";";
-        ss << "\n             ";
-    }
-#else
-    ss << "        // Set the A matrix.\n";
-    ss << "        A << ";
-    for (unsigned r = 0; r < equ_size; r++) {
-        for (unsigned c = 0; c < unk_size; c++) {
-            ss << std::setw(4) << std::right << A(r, c);
-            if (c < unk_size - 1)
-                ss << ", ";
-        }
-        if (r < equ_size - 1)
-            ss << ",\n             ";
-        else
-            ss << ";\n";
-    }
-    ss << "        // Set the b matrix.\n";
-    ss << "        b << ";
-    for (unsigned r = 0; r < equ_size; r++) {
-        ss << std::setw(4) << std::right << b(r, 0);
-        if (r < equ_size - 1)
-            ss << ", ";
-        else
-            ss << ";\n";
-    }
-#endif
-    ss << "\n";
-    ss << "        solver.compute(A, Eigen::ComputeFullU | Eigen::ComputeFullV);\n";
     ss << "    }\n";
-    ss << "\n";
-    ss << "    void trace(VariableTracer & tracer)\n";
-    ss << "    {\n";
-    ss << "        tracer.addScope(\"" << name << "\");\n";
-    for (const auto &edge : structure.edges)
-        ss << "        tracer.addTrace(" << edge << ", \"" << edge.get_alias() << "\");\n";
-    ss << "        tracer.closeScope();\n";
+    ss << "    /// Must be called every time one of the system variables changes.\n";
+    ss << "    void update_parameters() {\n";
+    ss << "        _timestep = -1.0;\n";
     ss << "    }\n";
-    ss << "\n";
-    ss << "    void run()\n";
-    ss << "    {\n";
-#if 0
-    ss << "        b << ";
-    for (unsigned r = 0; r < equ_size; r++) {
-        //if (GiNaC::is_a<GiNaC::numeric>(b(r, 0))) {
-        //    auto value = GiNaC::ex_to<GiNaC::numeric>(b(r, 0)).real().to_double();
-        //    if (is_equal(value, 0.0))
-        //        continue;
-        //}
-        ss << b(r, 0);
-        if (r < (equ_size - 1))
-            ss << ", ";
-        else
-            ss << ";\n";
+    ss << "    /// Computes the values which depend only on the system variables and\n";
+    ss << "    /// on the timestep, and factorizes A if it does not change at every step.\n";
+    ss << "    void update_matrix(analog_time_t ts) {\n";
+    for (std::size_t i = 0; i < lc.coefficients.size(); ++i)
+        matrix_printer.print_binding(ss, dag_statement_t{ coefficients[i], lc.coefficients[i] }, "        ");
+    for (std::size_t i : lc.invariant)
+        matrix_printer.print_statement(ss, statements[i], "        ");
+    if (lc.variant.empty())
+        ss << "        solver.compute(A);\n";
+    ss << "        _timestep = ts;\n";
+    ss << "    }\n";
+    ss << "    void run() {\n";
+    __print_timestep(ss, options);
+    ss << "        if (ts != _timestep)\n";
+    ss << "            this->update_matrix(ts);\n";
+    if (!lc.variant.empty()) {
+        ss << "        // Refill the entries which depend on the state.\n";
+        for (std::size_t i : lc.variant)
+            printer.print_statement(ss, statements[i], "        ");
+        ss << "        solver.compute(A);\n";
     }
-#else
-#endif
-    ss << "\n";
-    ss << "        // Solve the matrix for the DIODE.\n";
-    ss << "        auto solution = solver.solve(b);\n";
-    ss << "\n";
-    ss << "        // Get the solution.\n";
-    for (unsigned r = 0; r < equ_size; r++) {
-        ss << "        " << system.unknowns[r] << " = solution(" << r << ", 0);\n";
+    ss << "        // Set the right-hand side.\n";
+    for (std::size_t i = lc.matrix_statements; i < lc.matrix_statements + lc.rhs_statements; ++i)
+        printer.print_statement(ss, statements[i], "        ");
+    ss << "        // Solve the system, i.e., a forward and a backward substitution.\n";
+    ss << "        x = solver.solve(b);\n";
+    for (std::size_t c = 0; c < n; ++c)
+        ss << "        " << lc.unknowns[c] << " = x(" << c << ");\n";
+    if (lc.matrix_statements + lc.rhs_statements < statements.size()) {
+        ss << "        // Update support variables.\n";
+        for (std::size_t i = lc.matrix_statements + lc.rhs_statements; i < statements.size(); ++i)
+            printer.print_statement(ss, statements[i], "        ");
     }
     ss << "    }\n";
     ss << "};\n";
-    ss << "//" << std::string(78, '=') << "\n";
+    ss << "// " << std::string(77, '=') << "\n\n";
 
+    if (report) {
+        report->temporaries    = matrix_printer.temporaries() + printer.temporaries();
+        report->cost           = printer.cost();
+        report->parameter_cost = matrix_printer.cost();
+        // The triangular solves, the factorization is counted only when it
+        // happens at every step.
+        std::size_t solve = n * n - n;
+        report->cost.muls += solve;
+        report->cost.adds += solve;
+        report->cost.divs += n;
+        std::size_t factorization = (2 * n * n * n) / 3;
+        (lc.variant.empty() ? report->parameter_cost : report->cost).muls += factorization;
+        (lc.variant.empty() ? report->parameter_cost : report->cost).adds += factorization;
+    }
     return ss.str();
 }
 
-std::string generate_class_sparse(const analog_model_t &model, const std::string &name)
+std::string generate_class_sparse(const analog_model_t &model,
+                                  const std::string &name,
+                                  const codegen_options_t &options,
+                                  codegen_report_t *report)
 {
     std::stringstream ss;
-    GiNaC::csrc_double(ss);
-
-    auto structure = model.get_structure();
-    auto solution = model.get_solution();
-    auto system = model.get_system();
 
     GiNaC::matrix A;
     GiNaC::matrix b;
+    if (!__linear_system(model, A, b))
+        return std::string();
 
-    __matrix_from_equations(system.equations, system.unknowns, A, b);
+    // The structural non-zeros, in the order of the compressed storage of a
+    // column-major Eigen::SparseMatrix, i.e., the CSR order of A^T, so that
+    // each one is written directly at its position inside valuePtr().
+    std::vector<std::pair<unsigned, unsigned>> pattern;
+    std::vector<std::pair<std::string, GiNaC::ex>> entries;
+    for (unsigned c = 0; c < A.cols(); ++c) {
+        for (unsigned r = 0; r < A.rows(); ++r) {
+            if (!A(r, c).is_zero()) {
+                entries.emplace_back("values[" + std::to_string(pattern.size()) + "]", A(r, c));
+                pattern.emplace_back(r, c);
+            }
+        }
+    }
+    linear_class_t lc = __lower_linear_class(model, entries, b, options, report);
+    const auto &statements = lc.dag.statements();
+    const std::size_t n    = lc.unknowns.size();
 
-    unsigned equ_size = static_cast<unsigned>(system.equations.size());
-    unsigned unk_size = static_cast<unsigned>(system.unknowns.size());
-    unsigned edg_size = static_cast<unsigned>(structure.edges.size());
+    dag_printer_t matrix_printer(lc.dag, options.cse);
+    dag_printer_t printer(lc.dag, options.cse);
+    std::vector<std::string> coefficients;
+    for (std::size_t node : lc.coefficients) {
+        coefficients.emplace_back("_k" + std::to_string(coefficients.size()));
+        printer.bind(node, coefficients.back());
+    }
 
     ss << "//" << std::string(78, '=') << "\n";
-    ss << "#include <Eigen/Dense>\n";
-    ss << "#include <cassert>\n";
     ss << "\n";
-    ss << "#include \"variableTracer.hpp\"\n";
-    ss << "#include \"analog_pair.hpp\"\n";
+    ss << "#include <symsolbin/simulation/analog_pair.hpp>\n";
+    ss << "#include <symsolbin/simulation/simulation.hpp>\n";
+    ss << "\n";
+    ss << "#include <Eigen/Sparse>\n";
+    ss << "#include <cassert>\n";
+    ss << "#include <vector>\n";
     ss << "\n";
     ss << "class " << name << " {\n";
     ss << "public:\n";
-    ss << "    Eigen::Matrix<double, " << A.rows() << ", " << A.rows() << "> A;\n";
-    ss << "    Eigen::Matrix<double, 1, " << A.rows() << "> b;\n";
-    ss << "\n";
+    __print_linear_members(ss, lc, coefficients);
+    ss << "    /// The matrix of the system, holding only its " << pattern.size() << " structural non-zeros.\n";
+    ss << "    Eigen::SparseMatrix<double> A;\n";
+    ss << "    /// The right-hand side, and the solution.\n";
+    ss << "    Eigen::VectorXd b, x;\n";
+    ss << "    /// The solver, the sparsity pattern is analyzed only once.\n";
     ss << "    Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;\n";
-    ss << "\n";
-    for (const auto &edge : structure.edges)
-        ss << "    analog_pair_t " << edge << ";\n";
-    ss << "\n";
+    ss << "    /// The timestep used to factorize A, negative if it must be factorized.\n";
+    ss << "    analog_time_t _timestep;\n";
+    ss << "    /// Constructor.\n";
     ss << "    " << name << "() :\n";
-    ss << "        A(),\n";
-    ss << "        b(),\n";
+    __print_linear_initializers(ss, lc, coefficients);
+    ss << "        A(" << n << ", " << n << "),\n";
+    ss << "        b(" << n << "),\n";
+    ss << "        x(" << n << "),\n";
     ss << "        solver(),\n";
-    for (unsigned i = 0; i < edg_size; ++i) {
-        ss << "        " << structure.edges[i] << "()";
-        if (i < (edg_size - 1))
-            ss << ",";
-        ss << "\n";
-    }
+    ss << "        _timestep(-1.0)\n";
     ss << "    {\n";
-#if 0
-    ss << "        A << ";
-    for (unsigned r = 0; r < equ_size; r++) {
-        for (unsigned c = 0; c < unk_size; c++) {
-            ss << A(r, c);
-            if (c < (unk_size - 1))
-                ss << ", ";
-        }
-        if (r < (equ_size - 1))
-            ss << ",";
-        else
-            ss << ";";
-        ss << "\n             ";
-    }
-#else
-    for (unsigned r = 0; r < equ_size; r++) {
-        for (unsigned c = 0; c < unk_size; c++) {
-            ss << "        A.insert(" << r << ", " << c << ") = " << A(r, c) << ";\n";
-        }
-    }
-#endif
-    ss << "\n";
-    ss << "        solver.compute(A);\n";
-    ss << "        assert((solver.info() == Eigen::Success) && \"Failed decomposing matrix.\");\n";
+    ss << "        // Set the structural non-zeros, and analyze the pattern.\n";
+    ss << "        std::vector<Eigen::Triplet<double>> pattern = {";
+    for (std::size_t i = 0; i < pattern.size(); ++i)
+        ss << ((i % 6) ? " " : "\n            ") << "{ " << pattern[i].first << ", " << pattern[i].second << ", 1.0 },";
+    ss << "\n        };\n";
+    ss << "        A.setFromTriplets(pattern.begin(), pattern.end());\n";
+    ss << "        A.makeCompressed();\n";
+    ss << "        solver.analyzePattern(A);\n";
     ss << "    }\n";
-    ss << "\n";
-    ss << "    void trace(VariableTracer & tracer)\n";
-    ss << "    {\n";
-    ss << "        tracer.addScope(\"" << name << "\");\n";
-    for (const auto &edge : structure.edges)
-        ss << "        tracer.addTrace(" << edge << ", \"" << edge.get_alias() << "\");\n";
-    ss << "        tracer.closeScope();\n";
+    ss << "    /// Must be called every time one of the system variables changes.\n";
+    ss << "    void update_parameters() {\n";
+    ss << "        _timestep = -1.0;\n";
     ss << "    }\n";
-    ss << "\n";
-    ss << "    void run()\n";
-    ss << "    {\n";
-    ss << "        // Set the b matrix.\n";
-#if 0
-    ss << "        b << ";
-    for (unsigned r = 0; r < equ_size; r++) {
-        //if (GiNaC::is_a<GiNaC::numeric>(b(r, 0))) {
-        //    auto value = GiNaC::ex_to<GiNaC::numeric>(b(r, 0)).real().to_double();
-        //    if (is_equal(value, 0.0))
-        //        continue;
-        //}
-        ss << b(r, 0);
-        if (r < (equ_size - 1))
-            ss << ", ";
-        else
-            ss << ";\n";
+    ss << "    /// Computes the values which depend only on the system variables and\n";
+    ss << "    /// on the timestep, and factorizes A if it does not change at every step.\n";
+    ss << "    void update_matrix(analog_time_t ts) {\n";
+    if (!lc.invariant.empty())
+        ss << "        double *values = A.valuePtr();\n";
+    for (std::size_t i = 0; i < lc.coefficients.size(); ++i)
+        matrix_printer.print_binding(ss, dag_statement_t{ coefficients[i], lc.coefficients[i] }, "        ");
+    for (std::size_t i : lc.invariant)
+        matrix_printer.print_statement(ss, statements[i], "        ");
+    if (lc.variant.empty()) {
+        ss << "        solver.factorize(A);\n";
+        ss << "        assert((solver.info() == Eigen::Success) && \"Failed decomposing matrix.\");\n";
     }
-#else
-    for (unsigned r = 0; r < equ_size; r++) {
-        ss << "        b.insert(" << r << ", 0) = " << b(r, 0) << ";\n";
+    ss << "        _timestep = ts;\n";
+    ss << "    }\n";
+    ss << "    void run() {\n";
+    __print_timestep(ss, options);
+    ss << "        if (ts != _timestep)\n";
+    ss << "            this->update_matrix(ts);\n";
+    if (!lc.variant.empty()) {
+        ss << "        // Refill the entries which depend on the state, the pattern\n";
+        ss << "        // does not change, so only the numeric factorization is needed.\n";
+        ss << "        double *values = A.valuePtr();\n";
+        for (std::size_t i : lc.variant)
+            printer.print_statement(ss, statements[i], "        ");
+        ss << "        solver.factorize(A);\n";
+        ss << "        assert((solver.info() == Eigen::Success) && \"Failed decomposing matrix.\");\n";
     }
-#endif
-    ss << "\n";
-
-    ss << "        // Solve the matrix for the DIODE.\n";
-    ss << "        auto solution = solver.solve(b);\n";
+    ss << "        // Set the right-hand side.\n";
+    for (std::size_t i = lc.matrix_statements; i < lc.matrix_statements + lc.rhs_statements; ++i)
+        printer.print_statement(ss, statements[i], "        ");
+    ss << "        // Solve the system.\n";
+    ss << "        x = solver.solve(b);\n";
     ss << "        assert((solver.info() == Eigen::Success) && \"Failed solving the sparse matrix.\");\n";
-    ss << "\n";
-    ss << "        // Get the solution.\n";
-    for (unsigned c = 0; c < unk_size; c++) {
-        ss << "        " << system.unknowns[c] << " = solution(" << c << ", 0);\n";
+    for (std::size_t c = 0; c < n; ++c)
+        ss << "        " << lc.unknowns[c] << " = x(" << c << ");\n";
+    if (lc.matrix_statements + lc.rhs_statements < statements.size()) {
+        ss << "        // Update support variables.\n";
+        for (std::size_t i = lc.matrix_statements + lc.rhs_statements; i < statements.size(); ++i)
+            printer.print_statement(ss, statements[i], "        ");
     }
     ss << "    }\n";
     ss << "};\n";
-    ss << "//" << std::string(78, '=') << "\n";
+    ss << "// " << std::string(77, '=') << "\n\n";
 
+    if (report) {
+        report->temporaries    = matrix_printer.temporaries() + printer.temporaries();
+        report->cost           = printer.cost();
+        report->parameter_cost = matrix_printer.cost();
+        // Forward and backward substitution, assuming no fill-in.
+        std::size_t non_zeros = pattern.size();
+        report->cost.muls += non_zeros - std::min(non_zeros, n);
+        report->cost.adds += non_zeros - std::min(non_zeros, n);
+        report->cost.divs += n;
+    }
     return ss.str();
 }
 
@@ -0,0 +1,97 @@
+/// @file save_model.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Stores the solved model inside a binary file.
+
+#include "symsolbin/model/model_gen.hpp"
+#include "symsolbin/simulation/model_file.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace symsolbin
+{
+
+/// @brief Writes a section of the tape, with the padding bytes set to zero
+/// so that the same model always produces the same file.
+static inline void __write_code(std::ostream &out, const std::vector<tape_instruction_t> &code)
+{
+    for (const auto &instruction : code) {
+        tape_instruction_t copy;
+        std::memset(&copy, 0, sizeof(copy));
+        copy.op  = instruction.op;
+        copy.dst = instruction.dst;
+        copy.a   = instruction.a;
+        copy.b   = instruction.b;
+        out.write(reinterpret_cast<const char *>(&copy), sizeof(copy));
+    }
+}
+
+bool save_model(const analog_model_t &model, const std::string &path, const codegen_options_t &options)
+{
+    tape_t tape = generate_tape(model, options);
+    if (!tape.valid()) {
+        std::cerr << "Failed to save the model to " << path << "\n";
+        return false;
+    }
+
+    auto structure = model.get_structure();
+    auto solution  = model.get_solution();
+    auto system    = model.get_system();
+
+    // The variables, the tape already holds the value of the system
+    // variables.
+    const std::vector<double> &registers = tape.values();
+    std::vector<std::pair<std::string, model_variable_kind_t>> variables;
+    for (const auto &edge : structure.edges) {
+        variables.emplace_back(edge.get_alias() + ".pot", model_variable_kind_t::potential);
+        variables.emplace_back(edge.get_alias() + ".flw", model_variable_kind_t::flow);
+    }
+    for (const auto &value : system.values)
+        variables.emplace_back(value.get_name(), model_variable_kind_t::value);
+    for (const auto &value : system.inputs)
+        variables.emplace_back(value.get_name(), model_variable_kind_t::input);
+    for (const auto &value : solution.values)
+        variables.emplace_back(value.get_name(), model_variable_kind_t::support);
+
+    std::string names;
+    std::vector<model_file_variable_t> entries;
+    for (const auto &variable : variables) {
+        model_file_variable_t entry;
+        entry.name_offset = static_cast<std::uint32_t>(names.size());
+        entry.name_length = static_cast<std::uint32_t>(variable.first.size());
+        entry.index       = tape.variables().at(variable.first);
+        entry.kind        = variable.second;
+        entries.emplace_back(entry);
+        names += variable.first;
+    }
+
+    model_file_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic                  = MODEL_FILE_MAGIC;
+    header.version                = MODEL_FILE_VERSION;
+    header.registers              = static_cast<std::uint32_t>(registers.size());
+    header.variables              = static_cast<std::uint32_t>(entries.size());
+    header.parameter_instructions = static_cast<std::uint32_t>(tape.code(tape_section_t::parameter).size());
+    header.timestep_instructions  = static_cast<std::uint32_t>(tape.code(tape_section_t::timestep).size());
+    header.step_instructions      = static_cast<std::uint32_t>(tape.code(tape_section_t::step).size());
+    header.names_size             = static_cast<std::uint32_t>(names.size());
+    header.timestep_register      = tape.timestep_register();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(registers.data()), static_cast<std::streamsize>(registers.size() * sizeof(double)));
+    out.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(model_file_variable_t)));
+    __write_code(out, tape.code(tape_section_t::parameter));
+    __write_code(out, tape.code(tape_section_t::timestep));
+    __write_code(out, tape.code(tape_section_t::step));
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write the model to " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace symsolbin
@@ -10,6 +10,19 @@
 #include "symsolbin/solver/analog_model.hpp"
 #include "symsolbin/solver/ginac_helper.hpp"
 #include "symsolbin/solver/classifier.hpp"
+#include "symsolbin/solver/blt.hpp"
+#include "symsolbin/solver/elimination.hpp"
+#include "symsolbin/solver/solution_cache.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <thread>
 
 namespace symsolbin
 {
@@ -45,18 +58,123 @@ static inline edge_list_t __collection_get_connected_edges(const edge_list_t &co
     return list;
 }
 
+/// @brief Collects the symbols inside an expression.
+static inline void __collect_symbols(const GiNaC::ex &e, GiNaC::exset &symbols)
+{
+    if (GiNaC::is_a<GiNaC::symbol>(e)) {
+        symbols.insert(e);
+        return;
+    }
+    for (std::size_t i = 0; i < e.nops(); ++i)
+        __collect_symbols(e.op(i), symbols);
+}
+
+/// @brief Finds an equation inside a set.
+static inline equation_set_t::iterator __find_equation(equation_set_t &equations, const GiNaC::ex &e)
+{
+    return std::find_if(equations.begin(), equations.end(), [&e](const GiNaC::relational &equation) {
+        return GiNaC::ex(equation).is_equal(e);
+    });
+}
+
 analog_model_t::analog_model_t()
     : system(),
       structure(),
-      solution()
+      solution(),
+      kfl_rows(),
+      touched_nodes(),
+      kpl_outdated(true),
+      is_setup(false),
+      solved_blocks(),
+      support_names(),
+      support_count(0)
 {
     // Nothing to do.
 }
 
-void analog_model_t::run_solver(const GiNaC::exmap &replacement)
+void analog_model_t::run_solver(const GiNaC::exmap &replacement, const solver_options_t &options)
 {
+    // Start from an empty model, otherwise a second call would append the
+    // equations of setup() to the ones of the first.
+    system    = system_t();
+    structure = structure_t();
+    solution  = solved_systyem_t();
+    kfl_rows.clear();
+    touched_nodes.clear();
+    kpl_outdated = true;
+    // The support values take the names they had the previous time.
+    support_count = 0;
     this->setup();
-    this->solve(replacement);
+    is_setup = true;
+    this->solve(replacement, options);
+}
+
+void analog_model_t::resolve(const GiNaC::exmap &replacement, const solver_options_t &options)
+{
+    if (!is_setup) {
+        this->run_solver(replacement, options);
+        return;
+    }
+    this->solve(replacement, options);
+}
+
+bool analog_model_t::add_equation(const GiNaC::ex &e)
+{
+    std::size_t size = system.equations.size();
+    this->equations(e);
+    return system.equations.size() != size;
+}
+
+bool analog_model_t::remove_equation(const GiNaC::ex &e)
+{
+    auto it = __find_equation(system.equations, e);
+    if (it == system.equations.end())
+        return false;
+    system.equations.erase(it);
+    this->__remove_unused_support();
+    return true;
+}
+
+bool analog_model_t::replace_equation(const GiNaC::ex &previous, const GiNaC::ex &e)
+{
+    // The new equation is added first, so that the system does not change if
+    // it is rejected.
+    if ((__find_equation(system.equations, previous) == system.equations.end()) || !this->add_equation(e))
+        return false;
+    return this->remove_equation(previous);
+}
+
+void analog_model_t::add_edge(const edge_t &edge)
+{
+    if (collection_contains_edge(structure.edges, edge))
+        return;
+    this->unknowns(P(edge), F(edge));
+}
+
+bool analog_model_t::remove_edge(const edge_t &edge)
+{
+    auto it = std::find(structure.edges.begin(), structure.edges.end(), edge);
+    if (it == structure.edges.end())
+        return false;
+    const GiNaC::ex potential = P(edge), flow = F(edge);
+    structure.edges.erase(it);
+    for (auto *symbols : { &system.unknowns, &system.outputs }) {
+        symbols->erase(std::remove_if(symbols->begin(), symbols->end(), [&](const GiNaC::symbol &symbol) {
+                           return potential.is_equal(symbol) || flow.is_equal(symbol);
+                       }),
+                       symbols->end());
+    }
+    // The nodes left without edges are removed, together with their law.
+    for (const auto &node : { edge.get_first(), edge.get_second() }) {
+        touched_nodes.insert(node.get_name());
+        auto position = std::find(structure.nodes.begin(), structure.nodes.end(), node);
+        if ((position != structure.nodes.end()) && __collection_get_connected_edges(structure.edges, node).empty()) {
+            structure.nodes.erase(position);
+            kfl_rows.erase(node.get_name());
+        }
+    }
+    kpl_outdated = true;
+    return true;
 }
 
 inline void analog_model_t::__register_node(const node_t &node)
@@ -79,6 +197,9 @@ inline void analog_model_t::__register_edge(const edge_t &edge)
         structure.edges.emplace_back(edge);
         __register_node(edge.get_first());
         __register_node(edge.get_second());
+        touched_nodes.insert(edge.get_first().get_name());
+        touched_nodes.insert(edge.get_second().get_name());
+        kpl_outdated = true;
     }
 }
 
@@ -95,11 +216,23 @@ void analog_model_t::unknowns(const GiNaC::symbol &sym)
     system.unknowns.emplace_back(sym);
 }
 
+void analog_model_t::outputs(const GiNaC::symbol &sym)
+{
+    system.outputs.emplace_back(sym);
+}
+
 void analog_model_t::values(const value_t &value)
 {
     __register_value(value);
 }
 
+void analog_model_t::inputs(const value_t &value)
+{
+    if (!collection_contains_value(system.inputs, value)) {
+        system.inputs.emplace_back(value);
+    }
+}
+
 GiNaC::symbol analog_model_t::P(const node_t &n1, const node_t &n2)
 {
     __register_edge(edge_t(n1, n2, n1.get_name() + "_" + n2.get_name()));
@@ -128,9 +261,48 @@ GiNaC::symbol analog_model_t::F(const edge_t &edge)
     return ginac_helper::get_symbol(edge.get_alias() + ".flw");
 }
 
+std::string analog_model_t::__support_name(const std::string &prefix)
+{
+    std::string name;
+    if ((support_count < support_names.size()) && (support_names[support_count].compare(0, prefix.size(), prefix) == 0)) {
+        name = support_names[support_count];
+    } else {
+        name = name_gen::get_name(prefix);
+        if (support_count < support_names.size())
+            support_names[support_count] = name;
+        else
+            support_names.emplace_back(name);
+    }
+    ++support_count;
+    return name;
+}
+
+void analog_model_t::__remove_unused_support()
+{
+    // The symbols read by the equations, directly or through the support
+    // equations of the values they read.
+    GiNaC::exset used;
+    for (const auto &equation : system.equations)
+        __collect_symbols(equation, used);
+    for (std::size_t count = 0; count != used.size();) {
+        count = used.size();
+        for (const auto &equation : solution.support)
+            if (used.count(equation.lhs()))
+                __collect_symbols(equation.rhs(), used);
+    }
+    solution.support.erase(std::remove_if(solution.support.begin(), solution.support.end(), [&used](const GiNaC::relational &equation) {
+                               return !used.count(equation.lhs());
+                           }),
+                           solution.support.end());
+    solution.values.erase(std::remove_if(solution.values.begin(), solution.values.end(), [&used](const value_t &value) {
+                              return !used.count(value.get_symbol());
+                          }),
+                          solution.values.end());
+}
+
 GiNaC::ex analog_model_t::idt(const GiNaC::ex &e)
 {
-    auto idt    = value_t(name_gen::get_name("idt"));
+    auto idt    = value_t(this->__support_name("idt"));
     auto result = (idt + e * ts);
     solution.support.emplace_back(GiNaC::ex_to<GiNaC::relational>(idt == e * ts));
     if (!collection_contains_value(solution.values, idt)) {
@@ -141,7 +313,7 @@ GiNaC::ex analog_model_t::idt(const GiNaC::ex &e)
 
 GiNaC::ex analog_model_t::ddt(const GiNaC::ex &e)
 {
-    auto ddt    = value_t(name_gen::get_name("ddt"));
+    auto ddt    = value_t(this->__support_name("ddt"));
     auto result = ((e - ddt) / ts);
     solution.support.emplace_back(GiNaC::ex_to<GiNaC::relational>(ddt == (e - ddt) / ts));
     if (!collection_contains_value(solution.values, ddt)) {
@@ -187,6 +359,10 @@ std::ostream &operator<<(std::ostream &lhs, const analog_model_t &rhs)
     for (const auto &it : rhs.system.values)
         lhs << " " << it;
     lhs << "\n";
+    lhs << "    Inputs : ";
+    for (const auto &it : rhs.system.inputs)
+        lhs << " " << it;
+    lhs << "\n";
     lhs << "    Equations\n";
     for (const auto &it : rhs.system.equations)
         lhs << "        " << it << "\n";
@@ -199,6 +375,37 @@ std::ostream &operator<<(std::ostream &lhs, const analog_model_t &rhs)
     lhs << "    Unknowns\n";
     for (const auto &it : rhs.system.unknowns)
         lhs << "        " << it << "\n";
+    if (!rhs.system.outputs.empty()) {
+        lhs << "    Outputs\n";
+        for (const auto &it : rhs.system.outputs)
+            lhs << "        " << it << "\n";
+    }
+    if (rhs.solution.blocks.size() > 1) {
+        lhs << "    Blocks : ";
+        for (const auto &it : rhs.solution.blocks)
+            lhs << " " << it;
+        lhs << "\n";
+    }
+    for (const auto &choice : rhs.solution.choices) {
+        // The blocks solved with a fixed algorithm are not measured.
+        if (choice.shape.size == 0)
+            continue;
+        lhs << "    Block " << choice.block << " (" << choice.shape.size << " unknowns, density " << choice.shape.density()
+            << ", degree " << choice.shape.degree << ") : " << algorithm_name(choice.algorithm)
+            << (choice.remembered ? " (remembered)" : "") << "\n";
+        for (const auto &timing : choice.timings) {
+            lhs << "        " << algorithm_name(timing.first) << " : ";
+            if (timing.second < 0)
+                lhs << "failed\n";
+            else
+                lhs << timing.second << " s\n";
+        }
+    }
+    if (!rhs.solution.elimination.empty()) {
+        lhs << "    Elimination\n";
+        for (const auto &it : rhs.solution.elimination)
+            lhs << "        " << it << "\n";
+    }
     if (!rhs.solution.equations.empty()) {
         lhs << "    Results\n";
         for (const auto &it : rhs.solution.equations)
@@ -207,42 +414,505 @@ std::ostream &operator<<(std::ostream &lhs, const analog_model_t &rhs)
     return lhs;
 }
 
-void analog_model_t::solve(const GiNaC::exmap &replacement)
+/// @brief The blocks solved by the previous call of the solver, which are
+/// reused, and the ones of the current call, which are kept for the next.
+struct block_memo_t {
+    std::map<std::string, solved_block_t> previous;
+    std::map<std::string, solved_block_t> current;
+};
+
+/// @brief Returns the key of a block inside the solved blocks of the model:
+/// its equations and unknowns, in sorted order, and the method.
+static inline std::string __block_key(const blt_block_t &block, const solver_options_t &options)
+{
+    std::vector<std::string> items;
+    for (const auto &equation : block.equations) {
+        std::stringstream ss;
+        ss << equation;
+        items.emplace_back(ss.str());
+    }
+    std::sort(items.begin(), items.end());
+    std::vector<std::string> unknowns;
+    for (const auto &unknown : block.unknowns)
+        unknowns.emplace_back(unknown.get_name());
+    std::sort(unknowns.begin(), unknowns.end());
+    items.insert(items.end(), unknowns.begin(), unknowns.end());
+    std::string key = std::to_string(static_cast<int>(options.method));
+    for (const auto &item : items)
+        key += "\n" + item;
+    return key;
+}
+
+/// @brief Solves a block of the system.
+/// @param block the block.
+/// @param options the options of the solver.
+/// @param solution the solution, where the choice of the algorithm is stored.
+/// @return the solution of the block, with all its unknowns.
+static inline solved_block_t __compute_block(const blt_block_t &block,
+                                             const solver_options_t &options,
+                                             solved_systyem_t &solution)
+{
+    solved_block_t solved;
+    if (options.method == solve_method_t::elimination) {
+        elimination_t elimination;
+        if (eliminate(block.equations, block.unknowns, elimination)) {
+            solved.elimination = elimination.temporaries;
+            solved.equations   = elimination.equations;
+            solved.complete    = true;
+            return solved;
+        }
+        std::cerr << "The elimination failed, falling back to the closed form.\n";
+    }
+    if ((options.method == solve_method_t::sparse) && !sparse_solve(block.equations, block.unknowns, solved.equations))
+        std::cerr << "The sparse solver failed, falling back to GiNaC.\n";
+    if (solved.equations.empty()) {
+        GiNaC::lst equations, unknowns;
+        for (const auto &it : block.equations)
+            equations.append(it);
+        for (const auto &it : block.unknowns)
+            unknowns.append(it);
+        solver_choice_t choice = tune_algorithm(block.equations, block.unknowns, options.tuning, options.algorithm, options.tuning_budget,
+                                                options.cache ? solution_cache_directory(options) : std::string());
+        choice.block           = solution.blocks.size();
+        // The winner of a race has already solved the block.
+        if (choice.solution.empty())
+            solved.equations = ginac_helper::split_solved(ginac_helper::solve(equations, unknowns, choice.algorithm));
+        else
+            solved.equations.swap(choice.solution);
+        solution.choices.emplace_back(choice);
+    }
+    return solved;
+}
+
+/// @brief Solves a block of the system, appending the results to the solution.
+/// @param block the block.
+/// @param options the options of the solver.
+/// @param required the unknowns that must be computed.
+/// @param solution the solution.
+/// @param memo if set, the blocks solved by the previous call, which are
+/// reused, and the ones of this call, where the block is stored.
+static inline void __solve_block(const blt_block_t &block,
+                                 const solver_options_t &options,
+                                 const GiNaC::exset &required,
+                                 solved_systyem_t &solution,
+                                 block_memo_t *memo)
+{
+    const std::string key = memo ? __block_key(block, options) : std::string();
+    solved_block_t solved;
+    if (memo && memo->previous.count(key))
+        solved = memo->previous.at(key);
+    else
+        solved = __compute_block(block, options, solution);
+    if (memo)
+        memo->current[key] = solved;
+    solution.elimination.insert(solution.elimination.end(), solved.elimination.begin(), solved.elimination.end());
+    // Each closed form reads only the previous blocks, so the unknowns that
+    // are not required can be dropped.
+    std::size_t count = 0;
+    for (const auto &equation : solved.equations) {
+        if (solved.complete || required.count(equation.lhs())) {
+            solution.equations.emplace_back(equation);
+            ++count;
+        }
+    }
+    solution.blocks.emplace_back(count);
+}
+
+/// @brief Solves a part of the system which shares no unknown with the rest,
+/// appending the results to the solution.
+/// @param part the equations and the unknowns of the part.
+/// @param options the options of the solver.
+/// @param required the unknowns that must be computed.
+/// @param solution the solution.
+/// @param memo if set, the blocks solved before, see __solve_block().
+static inline void __solve_part(const blt_block_t &part,
+                                const solver_options_t &options,
+                                GiNaC::exset required,
+                                solved_systyem_t &solution,
+                                block_memo_t *memo)
+{
+    // Split the part in blocks, each one is solved on its own and reads the
+    // unknowns of the previous ones as if they were known.
+    std::vector<blt_block_t> blocks;
+    if (!options.blt || !blt_decompose(part.equations, part.unknowns, blocks))
+        blocks = { part };
+
+    // Going backwards, a block is needed if it computes a required unknown,
+    // and then the unknowns it reads from the previous blocks become required
+    // too. Its own unknowns are not, so that the ones nobody reads can be
+    // dropped from its closed form.
+    std::vector<bool> needed(blocks.size(), false);
+    for (std::size_t i = blocks.size(); i-- > 0;) {
+        for (const auto &unknown : blocks[i].unknowns)
+            needed[i] = needed[i] || required.count(unknown);
+        if (!needed[i])
+            continue;
+        GiNaC::exset own(blocks[i].unknowns.begin(), blocks[i].unknowns.end());
+        for (const auto &equation : blocks[i].equations)
+            for (const auto &unknown : part.unknowns)
+                if (!own.count(unknown) && (equation.lhs().has(unknown) || equation.rhs().has(unknown)))
+                    required.insert(unknown);
+    }
+    for (std::size_t i = 0; i < blocks.size(); ++i)
+        if (needed[i])
+            __solve_block(blocks[i], options, required, solution, memo);
+}
+
+/// @brief Splits the system in its connected components, i.e., the parts
+/// which share no unknown with each other, in the order of their first
+/// equation.
+/// @return the components, or the whole system if one of them is not square.
+static inline std::vector<blt_block_t> __split_components(const equation_set_t &equations,
+                                                          const std::vector<GiNaC::symbol> &unknowns)
+{
+    // Union-find over the equations, followed by the unknowns.
+    std::vector<std::size_t> parent(equations.size() + unknowns.size());
+    for (std::size_t i = 0; i < parent.size(); ++i)
+        parent[i] = i;
+    auto find = [&parent](std::size_t i) {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+    for (std::size_t r = 0; r < equations.size(); ++r)
+        for (std::size_t c = 0; c < unknowns.size(); ++c)
+            if (equations[r].lhs().has(unknowns[c]) || equations[r].rhs().has(unknowns[c]))
+                parent[find(equations.size() + c)] = find(r);
+    std::map<std::size_t, std::size_t> index;
+    std::vector<blt_block_t> components;
+    for (std::size_t r = 0; r < equations.size(); ++r) {
+        auto it = index.emplace(find(r), components.size()).first;
+        if (it->second == components.size())
+            components.emplace_back();
+        components[it->second].equations.emplace_back(equations[r]);
+    }
+    for (std::size_t c = 0; c < unknowns.size(); ++c) {
+        auto it = index.find(find(equations.size() + c));
+        if (it == index.end())
+            return { blt_block_t{ equations, unknowns } };
+        components[it->second].unknowns.emplace_back(unknowns[c]);
+    }
+    for (const auto &component : components)
+        if (component.equations.size() != component.unknowns.size())
+            return { blt_block_t{ equations, unknowns } };
+    return components;
+}
+
+/// @brief Stores the results of a worker inside a GiNaC archive, preceded
+/// by the keys of the blocks it solved, each one after its length, since a
+/// key spans several lines.
+/// @param result the results.
+/// @param blocks the blocks solved by the worker, by key.
+/// @return the data.
+static inline std::string __archive_solution(const solved_systyem_t &result, const std::map<std::string, solved_block_t> &blocks)
+{
+    GiNaC::lst elimination, equations, counts, choices, solved;
+    for (const auto &equation : result.elimination)
+        elimination.append(equation);
+    for (const auto &equation : result.equations)
+        equations.append(equation);
+    for (std::size_t count : result.blocks)
+        counts.append(GiNaC::numeric(static_cast<long>(count)));
+    for (const auto &choice : result.choices) {
+        GiNaC::lst timings;
+        for (const auto &timing : choice.timings)
+            timings.append(GiNaC::lst{ GiNaC::numeric(static_cast<long>(timing.first)), GiNaC::numeric(timing.second) });
+        choices.append(GiNaC::lst{
+            GiNaC::numeric(static_cast<long>(choice.block)),
+            GiNaC::numeric(static_cast<long>(choice.shape.size)),
+            GiNaC::numeric(static_cast<long>(choice.shape.nonzeros)),
+            GiNaC::numeric(static_cast<long>(choice.shape.symbolic)),
+            GiNaC::numeric(choice.shape.degree),
+            GiNaC::numeric(static_cast<long>(choice.algorithm)),
+            GiNaC::numeric(choice.remembered ? 1 : 0),
+            timings });
+    }
+    std::stringstream ss;
+    ss << blocks.size() << "\n";
+    for (const auto &block : blocks) {
+        GiNaC::lst block_elimination, block_equations;
+        for (const auto &equation : block.second.elimination)
+            block_elimination.append(equation);
+        for (const auto &equation : block.second.equations)
+            block_equations.append(equation);
+        solved.append(GiNaC::lst{ block_elimination, block_equations, GiNaC::numeric(block.second.complete ? 1 : 0) });
+        ss << block.first.size() << "\n"
+           << block.first;
+    }
+    GiNaC::archive archive;
+    archive.archive_ex(elimination, "elimination");
+    archive.archive_ex(equations, "equations");
+    archive.archive_ex(counts, "blocks");
+    archive.archive_ex(choices, "choices");
+    archive.archive_ex(solved, "solved");
+    ss << archive;
+    return ss.str();
+}
+
+/// @brief Restores the results of a worker from a GiNaC archive. The
+/// intermediate values of the elimination are renamed, since each worker
+/// names its own starting from the same counter.
+/// @param data the archive.
+/// @param part the part solved by the worker, whose symbols are shared.
+/// @param result the results.
+/// @param blocks where the blocks solved by the worker are added, by key.
+/// @return true on success.
+static inline bool __unarchive_solution(const std::string &data,
+                                        const blt_block_t &part,
+                                        solved_systyem_t &result,
+                                        std::map<std::string, solved_block_t> &blocks)
+{
+    GiNaC::exset used;
+    for (const auto &unknown : part.unknowns)
+        used.insert(unknown);
+    for (const auto &equation : part.equations)
+        __collect_symbols(equation, used);
+    GiNaC::lst symbols;
+    for (const auto &symbol : used)
+        symbols.append(symbol);
+    std::stringstream ss(data);
+    std::size_t count = 0;
+    std::vector<std::string> keys;
+    if (!(ss >> count) || (ss.get() != '\n'))
+        return false;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::size_t length = 0;
+        if (!(ss >> length) || (ss.get() != '\n'))
+            return false;
+        std::string key(length, '\0');
+        if (!ss.read(&key[0], static_cast<std::streamsize>(length)))
+            return false;
+        keys.emplace_back(key);
+    }
+    GiNaC::archive archive;
+    ss >> archive;
+    if (!ss)
+        return false;
+    auto to_size = [](const GiNaC::ex &e) {
+        return static_cast<std::size_t>(GiNaC::ex_to<GiNaC::numeric>(e).to_long());
+    };
+    GiNaC::exmap renamed;
+    for (const auto &e : archive.unarchive_ex(symbols, "elimination"))
+        renamed[e.lhs()] = ginac_helper::get_symbol(name_gen::get_name("elim"));
+    auto restore = [&renamed](const GiNaC::ex &e) {
+        return GiNaC::ex_to<GiNaC::relational>(e.subs(renamed));
+    };
+    for (const auto &e : archive.unarchive_ex(symbols, "elimination"))
+        result.elimination.emplace_back(restore(e));
+    for (const auto &e : archive.unarchive_ex(symbols, "equations"))
+        result.equations.emplace_back(restore(e));
+    for (const auto &e : archive.unarchive_ex(symbols, "blocks"))
+        result.blocks.emplace_back(to_size(e));
+    for (const auto &e : archive.unarchive_ex(symbols, "choices")) {
+        solver_choice_t choice;
+        choice.block          = to_size(e.op(0));
+        choice.shape.size     = to_size(e.op(1));
+        choice.shape.nonzeros = to_size(e.op(2));
+        choice.shape.symbolic = to_size(e.op(3));
+        choice.shape.degree   = GiNaC::ex_to<GiNaC::numeric>(e.op(4)).to_int();
+        choice.algorithm      = static_cast<unsigned>(to_size(e.op(5)));
+        choice.remembered     = !e.op(6).is_zero();
+        for (const auto &timing : e.op(7))
+            choice.timings.emplace_back(static_cast<unsigned>(to_size(timing.op(0))), GiNaC::ex_to<GiNaC::numeric>(timing.op(1)).to_double());
+        result.choices.emplace_back(choice);
+    }
+    // The blocks share the intermediate values of the results.
+    const GiNaC::ex solved = archive.unarchive_ex(symbols, "solved");
+    if (solved.nops() != keys.size())
+        return false;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        solved_block_t block;
+        for (const auto &e : solved.op(i).op(0))
+            block.elimination.emplace_back(restore(e));
+        for (const auto &e : solved.op(i).op(1))
+            block.equations.emplace_back(restore(e));
+        block.complete = !solved.op(i).op(2).is_zero();
+        blocks[keys[i]] = block;
+    }
+    return true;
+}
+
+/// @brief Writes all the data to a file descriptor.
+static inline bool __write_all(int fd, const std::string &data)
+{
+    for (std::size_t written = 0; written < data.size();) {
+        ssize_t count = write(fd, data.data() + written, data.size() - written);
+        if ((count < 0) && (errno != EINTR))
+            return false;
+        if (count > 0)
+            written += static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+/// @brief Reads from a file descriptor until its end.
+static inline std::string __read_all(int fd)
+{
+    std::string data;
+    char buffer[4096];
+    for (;;) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if ((count < 0) && (errno == EINTR))
+            continue;
+        if (count <= 0)
+            break;
+        data.append(buffer, static_cast<std::size_t>(count));
+    }
+    return data;
+}
+
+/// @brief Appends the results of a part to the solution.
+static inline void __merge_solution(const solved_systyem_t &part, solved_systyem_t &solution)
+{
+    for (auto choice : part.choices) {
+        choice.block += solution.blocks.size();
+        solution.choices.emplace_back(choice);
+    }
+    solution.elimination.insert(solution.elimination.end(), part.elimination.begin(), part.elimination.end());
+    solution.equations.insert(solution.equations.end(), part.equations.begin(), part.equations.end());
+    solution.blocks.insert(solution.blocks.end(), part.blocks.begin(), part.blocks.end());
+}
+
+/// @brief Solves the parts at the same time, each one inside a forked
+/// worker, since GiNaC is not thread-safe. The results come back through a
+/// pipe, as a GiNaC archive, and the parts whose worker fails are solved by
+/// the calling process.
+/// @param parts the parts.
+/// @param options the options of the solver.
+/// @param required the unknowns that must be computed.
+/// @param solution the solution.
+/// @param memo if set, the blocks solved before, see __solve_block(). The
+/// workers send back the blocks they solved, with their keys.
+static inline void __solve_parts_in_parallel(const std::vector<blt_block_t> &parts,
+                                             const solver_options_t &options,
+                                             const GiNaC::exset &required,
+                                             solved_systyem_t &solution,
+                                             block_memo_t *memo)
+{
+    std::size_t workers = options.workers;
+    if (workers == 0)
+        workers = std::max(1U, std::thread::hardware_concurrency());
+    // Otherwise, the buffered output would be written by every worker too.
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    for (std::size_t first = 0; first < parts.size(); first += workers) {
+        const std::size_t last = std::min(parts.size(), first + workers);
+        std::vector<pid_t> children;
+        std::vector<int> pipes;
+        for (std::size_t i = first; i < last; ++i) {
+            int fds[2];
+            pid_t pid = -1;
+            if (pipe(fds) == 0) {
+                pid = fork();
+                if (pid == 0) {
+                    close(fds[0]);
+                    solved_systyem_t result;
+                    block_memo_t local;
+                    if (memo)
+                        local.previous.swap(memo->previous);
+                    __solve_part(parts[i], options, required, result, memo ? &local : nullptr);
+                    bool success = __write_all(fds[1], __archive_solution(result, local.current));
+                    close(fds[1]);
+                    _exit(success ? 0 : 1);
+                }
+                close(fds[1]);
+                if (pid < 0)
+                    close(fds[0]);
+            }
+            children.emplace_back(pid);
+            pipes.emplace_back((pid > 0) ? fds[0] : -1);
+        }
+        // Each worker writes only to its own pipe, so they can be drained in
+        // order.
+        for (std::size_t i = first; i < last; ++i) {
+            std::string data;
+            int status = 0;
+            if (pipes[i - first] >= 0) {
+                data = __read_all(pipes[i - first]);
+                close(pipes[i - first]);
+            }
+            bool success = (children[i - first] > 0) &&
+                           (waitpid(children[i - first], &status, 0) == children[i - first]) &&
+                           WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+            solved_systyem_t result;
+            std::map<std::string, solved_block_t> blocks;
+            if (!success || !__unarchive_solution(data, parts[i], result, blocks)) {
+                std::cerr << "The worker of component " << i << " failed, solving it here.\n";
+                result = solved_systyem_t();
+                blocks.clear();
+                __solve_part(parts[i], options, required, result, memo);
+            }
+            if (memo)
+                memo->current.insert(blocks.begin(), blocks.end());
+            __merge_solution(result, solution);
+        }
+    }
+}
+
+void analog_model_t::solve(const GiNaC::exmap &replacement, const solver_options_t &options)
 {
     this->compute_kfl();
     this->compute_kpl();
 
     // Gather the equations.
-    GiNaC::lst equations;
-    for (const auto &it : system.equations)
-        equations.append(it);
-    for (const auto &it : system.kpl)
-        equations.append(it);
-    for (const auto &it : system.kfl)
-        equations.append(it);
-
-    // Gather the unknowns.
-    GiNaC::lst unknowns;
-    for (const auto &it : system.unknowns)
-        unknowns.append(it);
-
-    // Run the solver.
-    solution.equations =
-        ginac_helper::split_solved(
-            ginac_helper::solve(
-                equations,
-                unknowns,
-                GiNaC::solve_algo::automatic,
-                replacement));
+    equation_set_t equations = system.equations;
+    equations.insert(equations.end(), system.kpl.begin(), system.kpl.end());
+    equations.insert(equations.end(), system.kfl.begin(), system.kfl.end());
+    if (!replacement.empty())
+        equations = this->replace_symbols(equations, replacement);
+
+    // The required unknowns are the outputs, or all of them, and the ones
+    // read by the support equations.
+    GiNaC::exset required;
+    for (const auto &unknown : system.unknowns) {
+        bool is_output = system.outputs.empty();
+        for (const auto &output : system.outputs)
+            is_output |= GiNaC::ex(unknown).is_equal(output);
+        for (const auto &equation : solution.support)
+            is_output |= equation.rhs().has(unknown);
+        if (is_output)
+            required.insert(unknown);
+    }
+
+    solution.replacement = replacement;
+
+    // A system solved before is loaded from the cache.
+    std::string directory, key;
+    if (options.cache) {
+        directory = solution_cache_directory(options);
+        key       = solution_key(equations, system, solution, replacement, options);
+        if (!directory.empty() && load_solution(directory, key, equations, system, solution))
+            return;
+    }
+
+    // Run the solver, the blocks which are not solved again are dropped.
+    block_memo_t memo;
+    memo.previous.swap(solved_blocks);
+    solution.elimination.clear();
+    solution.equations.clear();
+    solution.blocks.clear();
+    solution.choices.clear();
+    std::vector<blt_block_t> components;
+    if (options.parallel)
+        components = __split_components(equations, system.unknowns);
+    if (components.size() > 1)
+        __solve_parts_in_parallel(components, options, required, solution, &memo);
+    else
+        __solve_part(blt_block_t{ equations, system.unknowns }, options, required, solution, &memo);
+    solved_blocks.swap(memo.current);
+    if (options.cache && !directory.empty())
+        store_solution(directory, key, solution);
 }
 
 void analog_model_t::compute_kfl()
 {
-    system.kfl.clear();
-
+    // Only the law of the nodes whose edges changed is computed again.
     for (const auto &node : structure.nodes) {
         if (node.is_ground())
             continue;
+        if (kfl_rows.count(node.get_name()) && !touched_nodes.count(node.get_name()))
+            continue;
         GiNaC::ex sum;
         for (const auto &edge : structure.edges) {
             if (edge.get_first() == node) {
@@ -251,8 +921,14 @@ void analog_model_t::compute_kfl()
                 sum = sum + F(edge);
             }
         }
-        system.kfl.emplace_back(sum == 0);
+        kfl_rows[node.get_name()] = (sum == 0);
     }
+    touched_nodes.clear();
+
+    system.kfl.clear();
+    for (const auto &node : structure.nodes)
+        if (!node.is_ground())
+            system.kfl.emplace_back(GiNaC::ex_to<GiNaC::relational>(kfl_rows[node.get_name()]));
 }
 
 struct parallel_info_t {
@@ -549,6 +1225,9 @@ std::vector<parallel_info_t> __find_parallel_edges(const edge_list_t &edges)
 
 void analog_model_t::compute_kpl()
 {
+    if (!kpl_outdated)
+        return;
+    kpl_outdated = false;
     system.kpl.clear();
     auto selected = __find_minimum_spanning_tree(structure.edges, structure.nodes);
     auto loops    = __find_graph_loops(structure.edges, structure.nodes, selected);
@@ -0,0 +1,188 @@
+/// @file blt.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Block-lower-triangular decomposition of a system of equations.
+
+#include "symsolbin/solver/blt.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace symsolbin
+{
+
+/// @brief Looks for an augmenting path starting from an equation (Kuhn's
+/// algorithm), i.e., an unknown for the equation, possibly stealing it from
+/// another equation that can be matched to something else. The path is
+/// followed with an explicit stack, since it can be as long as the system.
+static bool __augment(std::size_t equation,
+                      const std::vector<std::vector<std::size_t>> &incidence,
+                      std::vector<bool> &visited,
+                      std::vector<std::size_t> &matched_equation)
+{
+    // The equations along the path, each one with the position of the next
+    // unknown it tries.
+    std::vector<std::pair<std::size_t, std::size_t>> path;
+    path.emplace_back(equation, 0);
+    while (!path.empty()) {
+        const std::size_t current = path.back().first;
+        if (path.back().second == incidence[current].size()) {
+            path.pop_back();
+            continue;
+        }
+        const std::size_t unknown = incidence[current][path.back().second++];
+        if (visited[unknown])
+            continue;
+        visited[unknown] = true;
+        if (matched_equation[unknown] == incidence.size()) {
+            // Each equation along the path takes the unknown it was trying.
+            for (const auto &step : path)
+                matched_equation[incidence[step.first][step.second - 1]] = step.first;
+            return true;
+        }
+        path.emplace_back(matched_equation[unknown], 0);
+    }
+    return false;
+}
+
+/// @brief State of Tarjan's algorithm.
+struct tarjan_t {
+    /// The equations each equation depends on.
+    const std::vector<std::vector<std::size_t>> &graph;
+    /// The discovery index of each equation, zero if not visited yet.
+    std::vector<std::size_t> index;
+    /// The smallest index reachable from each equation.
+    std::vector<std::size_t> lowlink;
+    /// If the equation is on the stack.
+    std::vector<bool> on_stack;
+    /// The stack of visited equations.
+    std::vector<std::size_t> stack;
+    /// The next discovery index.
+    std::size_t counter;
+    /// The components, each one after the components it depends on.
+    std::vector<std::vector<std::size_t>> components;
+
+    explicit tarjan_t(const std::vector<std::vector<std::size_t>> &_graph)
+        : graph(_graph),
+          index(_graph.size(), 0),
+          lowlink(_graph.size(), 0),
+          on_stack(_graph.size(), false),
+          stack(),
+          counter(1),
+          components()
+    {
+        // Nothing to do.
+    }
+
+    /// @brief Visits all the equations reachable from the given one, with an
+    /// explicit stack instead of recursion, since the chain of dependencies
+    /// can be as long as the system.
+    void visit(std::size_t root)
+    {
+        // The equations being visited, each one with the position of the
+        // next dependency to follow.
+        std::vector<std::pair<std::size_t, std::size_t>> calls;
+        this->enter(root);
+        calls.emplace_back(root, 0);
+        while (!calls.empty()) {
+            const std::size_t node = calls.back().first;
+            if (calls.back().second < graph[node].size()) {
+                const std::size_t next = graph[node][calls.back().second++];
+                if (index[next] == 0) {
+                    this->enter(next);
+                    calls.emplace_back(next, 0);
+                } else if (on_stack[next]) {
+                    lowlink[node] = std::min(lowlink[node], index[next]);
+                }
+                continue;
+            }
+            calls.pop_back();
+            this->leave(node);
+            if (!calls.empty()) {
+                const std::size_t parent = calls.back().first;
+                lowlink[parent]          = std::min(lowlink[parent], lowlink[node]);
+            }
+        }
+    }
+
+    /// @brief Gives the equation its discovery index and pushes it.
+    void enter(std::size_t node)
+    {
+        index[node] = lowlink[node] = counter++;
+        stack.emplace_back(node);
+        on_stack[node] = true;
+    }
+
+    /// @brief Pops the component rooted in the equation, if it is a root,
+    /// once all its dependencies have been visited.
+    void leave(std::size_t node)
+    {
+        if (lowlink[node] == index[node]) {
+            std::vector<std::size_t> component;
+            std::size_t other;
+            do {
+                other = stack.back();
+                stack.pop_back();
+                on_stack[other] = false;
+                component.emplace_back(other);
+            } while (other != node);
+            // Keep the original order inside the block.
+            std::sort(component.begin(), component.end());
+            components.emplace_back(component);
+        }
+    }
+};
+
+bool blt_decompose(const equation_set_t &equations,
+                   const std::vector<GiNaC::symbol> &unknowns,
+                   std::vector<blt_block_t> &blocks)
+{
+    blocks.clear();
+    const std::size_t n = equations.size();
+    if (n != unknowns.size()) {
+        std::cerr << "Cannot decompose " << n << " equations in " << unknowns.size() << " unknowns.\n";
+        return false;
+    }
+    // The unknowns appearing inside each equation.
+    std::vector<std::vector<std::size_t>> incidence(n);
+    for (std::size_t e = 0; e < n; ++e) {
+        GiNaC::ex expression = equations[e].lhs() - equations[e].rhs();
+        for (std::size_t u = 0; u < n; ++u)
+            if (expression.has(unknowns[u]))
+                incidence[e].emplace_back(u);
+    }
+    // Match each unknown to the equation that computes it.
+    std::vector<std::size_t> matched_equation(n, n);
+    for (std::size_t e = 0; e < n; ++e) {
+        std::vector<bool> visited(n, false);
+        if (!__augment(e, incidence, visited, matched_equation)) {
+            std::cerr << "The system is structurally singular, equation `" << equations[e] << "` cannot be matched to any unknown.\n";
+            return false;
+        }
+    }
+    // An equation depends on the equations computing its other unknowns.
+    std::vector<std::vector<std::size_t>> graph(n);
+    for (std::size_t e = 0; e < n; ++e)
+        for (std::size_t u : incidence[e])
+            if (matched_equation[u] != e)
+                graph[e].emplace_back(matched_equation[u]);
+    // Tarjan's algorithm gives the components with dependencies first.
+    tarjan_t tarjan(graph);
+    for (std::size_t e = 0; e < n; ++e)
+        if (tarjan.index[e] == 0)
+            tarjan.visit(e);
+    std::vector<std::size_t> matched_unknown(n);
+    for (std::size_t u = 0; u < n; ++u)
+        matched_unknown[matched_equation[u]] = u;
+    for (const auto &component : tarjan.components) {
+        blt_block_t block;
+        for (std::size_t e : component) {
+            block.equations.emplace_back(equations[e]);
+            block.unknowns.emplace_back(unknowns[matched_unknown[e]]);
+        }
+        blocks.emplace_back(block);
+    }
+    return true;
+}
+
+} // namespace symsolbin
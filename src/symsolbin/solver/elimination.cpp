@@ -0,0 +1,327 @@
+/// @file elimination.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Symbolic Gaussian elimination, recorded as a sequence of steps,
+/// and a sparse fraction-free solver.
+
+#include "symsolbin/solver/elimination.hpp"
+
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <tuple>
+
+namespace symsolbin
+{
+
+/// @brief Stores a non-trivial expression inside a new intermediate value.
+/// @param e the expression.
+/// @param temporaries where the intermediate value is appended.
+/// @return the symbol of the intermediate value, or the expression itself if
+/// it is a number or a symbol.
+static inline GiNaC::ex __temporary(const GiNaC::ex &e, equation_set_t &temporaries)
+{
+    if (GiNaC::is_a<GiNaC::numeric>(e) || GiNaC::is_a<GiNaC::symbol>(e))
+        return e;
+    GiNaC::symbol &symbol = ginac_helper::get_symbol(name_gen::get_name("elim"));
+    temporaries.emplace_back(GiNaC::ex_to<GiNaC::relational>(symbol == e));
+    return symbol;
+}
+
+/// @brief Counts the non-zero entries of a row, starting from a column.
+static inline unsigned __row_count(const GiNaC::matrix &A, unsigned row, unsigned column)
+{
+    unsigned count = 0;
+    for (unsigned c = column; c < A.cols(); ++c)
+        if (!A(row, c).is_zero())
+            ++count;
+    return count;
+}
+
+/// @brief Ranks a candidate pivot, the lower the safer: numbers never
+/// vanish, the coefficients of the system vanish only for some values of
+/// the parameters, while an intermediate value hides its expression, which
+/// may cancel out.
+static inline unsigned __pivot_rank(const GiNaC::ex &e, const GiNaC::exset &intermediates)
+{
+    if (GiNaC::is_a<GiNaC::numeric>(e))
+        return 0;
+    return intermediates.count(e) ? 2 : 1;
+}
+
+/// @brief Selects the pivot of a column. Numerical entries are preferred,
+/// since Kirchhoff's laws give plenty of them and they never vanish, a
+/// symbolic entry is chosen only when the column has no numerical one.
+/// Among the candidates with the same rank, the rows with the fewest
+/// non-zeros win, since they cause the least fill-in.
+/// @return false if every candidate is zero.
+static inline bool __select_pivot(const GiNaC::matrix &A, unsigned column, const GiNaC::exset &intermediates, unsigned &pivot)
+{
+    bool found         = false;
+    unsigned best_rank = 0, best_count = 0;
+    for (unsigned r = column; r < A.rows(); ++r) {
+        if (A(r, column).is_zero())
+            continue;
+        unsigned rank  = __pivot_rank(A(r, column), intermediates);
+        unsigned count = __row_count(A, r, column);
+        if (!found || (rank < best_rank) || ((rank == best_rank) && (count < best_count))) {
+            found      = true;
+            best_rank  = rank;
+            best_count = count;
+            pivot      = r;
+        }
+    }
+    return found;
+}
+
+bool eliminate(const equation_set_t &equations,
+               const std::vector<GiNaC::symbol> &unknowns,
+               elimination_t &result)
+{
+    result.temporaries.clear();
+    result.equations.clear();
+    if (equations.size() != unknowns.size()) {
+        std::cerr << "Cannot eliminate " << equations.size() << " equations in " << unknowns.size() << " unknowns.\n";
+        return false;
+    }
+    GiNaC::matrix A, b;
+    if (!ginac_helper::matrix_from_equations(equations, unknowns, A, b)) {
+        std::cerr << "The system is not linear in its unknowns.\n";
+        return false;
+    }
+    const unsigned n = A.rows();
+
+    // The reciprocal of each pivot, shared by the whole column and by the
+    // back substitution.
+    std::vector<GiNaC::ex> reciprocals(n);
+    // The symbols of the intermediate values, whose expression is hidden
+    // to the choice of the pivots.
+    GiNaC::exset intermediates;
+    for (unsigned k = 0; k < n; ++k) {
+        for (std::size_t i = intermediates.size(); i < result.temporaries.size(); ++i)
+            intermediates.insert(result.temporaries[i].lhs());
+        unsigned pivot = k;
+        if (!__select_pivot(A, k, intermediates, pivot)) {
+            std::cerr << "The system is singular, no pivot for `" << unknowns[k] << "`.\n";
+            return false;
+        }
+        if (pivot != k) {
+            for (unsigned c = k; c < n; ++c)
+                std::swap(A(k, c), A(pivot, c));
+            std::swap(b(k, 0), b(pivot, 0));
+        }
+        reciprocals[k] = __temporary(1 / A(k, k), result.temporaries);
+        for (unsigned r = k + 1; r < n; ++r) {
+            if (A(r, k).is_zero())
+                continue;
+            GiNaC::ex factor = __temporary(A(r, k) * reciprocals[k], result.temporaries);
+            for (unsigned c = k + 1; c < n; ++c)
+                if (!A(k, c).is_zero())
+                    A(r, c) = __temporary(A(r, c) - factor * A(k, c), result.temporaries);
+            if (!b(k, 0).is_zero())
+                b(r, 0) = __temporary(b(r, 0) - factor * b(k, 0), result.temporaries);
+            A(r, k) = 0;
+        }
+    }
+    // Back substitution, the last unknown first.
+    for (unsigned k = n; k-- > 0;) {
+        GiNaC::ex rhs = b(k, 0);
+        for (unsigned c = k + 1; c < n; ++c)
+            if (!A(k, c).is_zero())
+                rhs -= A(k, c) * unknowns[c];
+        result.equations.emplace_back(GiNaC::ex_to<GiNaC::relational>(unknowns[k] == rhs * reciprocals[k]));
+    }
+    return true;
+}
+
+/// @brief A row of a sparse system, the non-zero coefficients by column.
+using sparse_row_t = std::map<unsigned, GiNaC::ex>;
+
+/// @brief Checks if both expressions are polynomials over the rationals,
+/// the only ones GiNaC can divide exactly.
+static inline bool __are_polynomials(const GiNaC::ex &a, const GiNaC::ex &b)
+{
+    return a.info(GiNaC::info_flags::rational_polynomial) && b.info(GiNaC::info_flags::rational_polynomial);
+}
+
+/// @brief Returns the greatest common divisor of two polynomials, or one if
+/// they are not polynomials.
+static inline GiNaC::ex __gcd(const GiNaC::ex &a, const GiNaC::ex &b)
+{
+    return __are_polynomials(a, b) ? GiNaC::gcd(a, b) : GiNaC::ex(1);
+}
+
+/// @brief Divides a by b, exactly if they are polynomials.
+static inline GiNaC::ex __quotient(const GiNaC::ex &a, const GiNaC::ex &b)
+{
+    GiNaC::ex quotient;
+    if (__are_polynomials(a, b) && GiNaC::divide(a, b, quotient))
+        return quotient;
+    return (a / b).normal();
+}
+
+/// @brief Multiplies a row by the least common multiple of the denominators
+/// of its entries, so that they become polynomials.
+static inline void __clear_denominators(sparse_row_t &row, GiNaC::ex &rhs)
+{
+    GiNaC::ex multiple = 1;
+    auto update        = [&multiple](GiNaC::ex &e) {
+        e                       = e.normal();
+        const GiNaC::ex divisor = e.denom();
+        multiple                = __quotient(multiple * divisor, __gcd(multiple, divisor));
+    };
+    for (auto &entry : row)
+        update(entry.second);
+    update(rhs);
+    if (multiple.is_equal(1))
+        return;
+    for (auto &entry : row)
+        entry.second = (entry.second * multiple).normal();
+    rhs = (rhs * multiple).normal();
+}
+
+/// @brief Divides a row by the greatest common divisor of its entries.
+static inline void __make_primitive(sparse_row_t &row, GiNaC::ex &rhs)
+{
+    GiNaC::ex content = rhs;
+    for (const auto &entry : row)
+        content = __gcd(content, entry.second);
+    if (content.is_zero() || content.is_equal(1) || content.is_equal(-1))
+        return;
+    for (auto &entry : row)
+        entry.second = __quotient(entry.second, content);
+    rhs = __quotient(rhs, content);
+}
+
+/// @brief Checks if an expression contains one of the unknowns.
+static inline bool __has_unknowns(const GiNaC::ex &e, const std::vector<GiNaC::symbol> &unknowns)
+{
+    for (const auto &unknown : unknowns)
+        if (e.has(unknown))
+            return true;
+    return false;
+}
+
+bool sparse_solve(const equation_set_t &equations,
+                  const std::vector<GiNaC::symbol> &unknowns,
+                  equation_set_t &result)
+{
+    result.clear();
+    if (equations.size() != unknowns.size()) {
+        std::cerr << "Cannot solve " << equations.size() << " equations in " << unknowns.size() << " unknowns.\n";
+        return false;
+    }
+    const unsigned n = static_cast<unsigned>(unknowns.size());
+
+    // Build the rows, and the rows where each column is not zero.
+    std::vector<sparse_row_t> rows(n);
+    std::vector<GiNaC::ex> rhs(n);
+    std::vector<std::set<unsigned>> columns(n);
+    for (unsigned r = 0; r < n; ++r) {
+        const GiNaC::ex e = (equations[r].lhs() - equations[r].rhs()).expand();
+        GiNaC::ex rest    = e;
+        for (unsigned c = 0; c < n; ++c) {
+            if (!e.has(unknowns[c]))
+                continue;
+            const GiNaC::ex coefficient = e.coeff(unknowns[c], 1);
+            if (coefficient.is_zero())
+                continue;
+            rows[r][c] = coefficient;
+            rest -= coefficient * unknowns[c];
+        }
+        rhs[r] = -rest.expand();
+        bool linear = !__has_unknowns(rhs[r], unknowns);
+        for (const auto &entry : rows[r])
+            linear = linear && !__has_unknowns(entry.second, unknowns);
+        if (!linear) {
+            std::cerr << "The system is not linear in its unknowns, see `" << equations[r] << "`.\n";
+            return false;
+        }
+        __clear_denominators(rows[r], rhs[r]);
+        __make_primitive(rows[r], rhs[r]);
+        for (const auto &entry : rows[r])
+            columns[entry.first].insert(r);
+    }
+
+    // The rows and columns of the pivots, in the order they are chosen.
+    std::vector<std::pair<unsigned, unsigned>> pivots;
+    std::vector<bool> active(n, true);
+    for (unsigned k = 0; k < n; ++k) {
+        // The Markowitz cost bounds the fill-in caused by the pivot, ties
+        // prefer numerical pivots, which never vanish, and then the name of
+        // the unknown, so that the order of the unknowns does not matter.
+        bool found = false;
+        std::tuple<std::size_t, bool, std::string> best;
+        unsigned pivot_row = 0, pivot_column = 0;
+        for (unsigned r = 0; r < n; ++r) {
+            if (!active[r])
+                continue;
+            for (const auto &entry : rows[r]) {
+                auto candidate = std::make_tuple((rows[r].size() - 1) * (columns[entry.first].size() - 1),
+                                                 !GiNaC::is_a<GiNaC::numeric>(entry.second),
+                                                 unknowns[entry.first].get_name());
+                if (!found || (candidate < best)) {
+                    found        = true;
+                    best         = candidate;
+                    pivot_row    = r;
+                    pivot_column = entry.first;
+                }
+            }
+        }
+        if (!found) {
+            std::cerr << "The system is singular, " << (n - k) << " unknowns have no pivot.\n";
+            return false;
+        }
+        const GiNaC::ex pivot = rows[pivot_row][pivot_column];
+        // Remove the column from the other rows, scaling each one only by the
+        // part of the pivot it does not share with its own entry.
+        const std::set<unsigned> targets = columns[pivot_column];
+        for (unsigned r : targets) {
+            if (r == pivot_row)
+                continue;
+            const GiNaC::ex entry   = rows[r][pivot_column];
+            const GiNaC::ex divisor = __gcd(pivot, entry);
+            const GiNaC::ex scale   = __quotient(pivot, divisor);
+            const GiNaC::ex factor  = __quotient(entry, divisor);
+            sparse_row_t updated;
+            for (const auto &it : rows[r])
+                if (it.first != pivot_column)
+                    updated[it.first] = scale * it.second;
+            for (const auto &it : rows[pivot_row])
+                if (it.first != pivot_column)
+                    updated[it.first] -= factor * it.second;
+            for (auto it = updated.begin(); it != updated.end();) {
+                it->second = it->second.expand();
+                it         = it->second.is_zero() ? updated.erase(it) : std::next(it);
+            }
+            rhs[r] = (scale * rhs[r] - factor * rhs[pivot_row]).expand();
+            __make_primitive(updated, rhs[r]);
+            for (const auto &it : rows[r])
+                columns[it.first].erase(r);
+            rows[r] = std::move(updated);
+            for (const auto &it : rows[r])
+                columns[it.first].insert(r);
+        }
+        for (const auto &it : rows[pivot_row])
+            columns[it.first].erase(pivot_row);
+        active[pivot_row] = false;
+        pivots.emplace_back(pivot_row, pivot_column);
+    }
+
+    // Back substitution, each pivot row reads only the unknowns of the
+    // pivots chosen after it.
+    std::vector<GiNaC::ex> solutions(n);
+    for (std::size_t k = pivots.size(); k-- > 0;) {
+        const unsigned r = pivots[k].first, c = pivots[k].second;
+        GiNaC::ex numerator = rhs[r];
+        for (const auto &it : rows[r])
+            if (it.first != c)
+                numerator -= it.second * solutions[it.first];
+        solutions[c] = (numerator / rows[r][c]).normal();
+    }
+    for (unsigned c = 0; c < n; ++c)
+        result.emplace_back(GiNaC::ex_to<GiNaC::relational>(unknowns[c] == solutions[c]));
+    return true;
+}
+
+} // namespace symsolbin
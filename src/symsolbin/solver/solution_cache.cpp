@@ -0,0 +1,294 @@
+/// @file solution_cache.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Persistent cache of the solutions, keyed by a canonical hash of
+/// the system they solve.
+
+#include "symsolbin/solver/solution_cache.hpp"
+#include "symsolbin/solver/hash.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace symsolbin
+{
+
+/// @brief Changes every time the content of the cached files changes.
+#define SOLUTION_CACHE_VERSION "symsolbin-solution-1"
+
+/// @brief The names given to the support values inside the cache, by their
+/// position, so that they do not depend on the numbers chosen by name_gen.
+static inline std::string __placeholder(std::size_t index)
+{
+    return "$support" + std::to_string(index);
+}
+
+/// @brief Prints an expression in a canonical form: the operands of sums
+/// and products are sorted by their own canonical form, instead of by the
+/// order in which GiNaC created their symbols, which changes between runs.
+/// @param e the expression.
+/// @param renamed the names which replace the ones of some symbols.
+/// @return the canonical form.
+static inline std::string __canonical(const GiNaC::ex &e, const std::map<std::string, std::string> &renamed)
+{
+    if (GiNaC::is_a<GiNaC::symbol>(e)) {
+        const std::string name = GiNaC::ex_to<GiNaC::symbol>(e).get_name();
+        auto it                = renamed.find(name);
+        return (it == renamed.end()) ? name : it->second;
+    }
+    if (GiNaC::is_a<GiNaC::numeric>(e)) {
+        std::stringstream ss;
+        ss << e;
+        return ss.str();
+    }
+    std::vector<std::string> operands;
+    for (std::size_t i = 0; i < e.nops(); ++i)
+        operands.emplace_back(__canonical(e.op(i), renamed));
+    std::string head;
+    if (GiNaC::is_a<GiNaC::add>(e) || GiNaC::is_a<GiNaC::mul>(e)) {
+        head = GiNaC::is_a<GiNaC::add>(e) ? "add" : "mul";
+        std::sort(operands.begin(), operands.end());
+    } else if (GiNaC::is_a<GiNaC::relational>(e)) {
+        // Both sides of an equation are interchangeable.
+        head = "eq";
+        std::sort(operands.begin(), operands.end());
+    } else if (GiNaC::is_a<GiNaC::power>(e)) {
+        head = "pow";
+    } else if (GiNaC::is_a<GiNaC::function>(e)) {
+        head = GiNaC::ex_to<GiNaC::function>(e).get_name();
+    } else {
+        std::stringstream ss;
+        ss << e;
+        return ss.str();
+    }
+    std::string result = head + "(";
+    for (std::size_t i = 0; i < operands.size(); ++i)
+        result += ((i > 0) ? "," : "") + operands[i];
+    return result + ")";
+}
+
+/// @brief Adds the canonical forms of a set of expressions to the hash, in
+/// sorted order.
+static inline void __update(hash_t &hash, std::vector<std::string> items)
+{
+    std::sort(items.begin(), items.end());
+    hash.update(std::to_string(items.size()));
+    for (const auto &item : items)
+        hash.update(item);
+}
+
+/// @brief Creates a directory and its parents, like `mkdir -p`.
+static inline bool __make_directories(const std::string &path)
+{
+    for (std::size_t position = 1; position <= path.size(); ++position) {
+        if ((position == path.size()) || (path[position] == '/')) {
+            std::string parent = path.substr(0, position);
+            if ((mkdir(parent.c_str(), 0755) != 0) && (errno != EEXIST))
+                return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Collects the symbols inside an expression.
+static inline void __collect_symbols(const GiNaC::ex &e, GiNaC::exset &symbols)
+{
+    if (GiNaC::is_a<GiNaC::symbol>(e)) {
+        symbols.insert(e);
+        return;
+    }
+    for (std::size_t i = 0; i < e.nops(); ++i)
+        __collect_symbols(e.op(i), symbols);
+}
+
+std::string solution_cache_directory(const solver_options_t &options)
+{
+    if (!options.cache_directory.empty())
+        return options.cache_directory;
+    if (const char *path = std::getenv("SYMSOLBIN_SOLVER_CACHE"))
+        return path;
+    if (const char *path = std::getenv("XDG_CACHE_HOME"))
+        return std::string(path) + "/symsolbin/solutions";
+    if (const char *path = std::getenv("HOME"))
+        return std::string(path) + "/.cache/symsolbin/solutions";
+    // A shared directory like /tmp would let other users plant solutions,
+    // so without a directory of the user the cache is disabled.
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true))
+        std::cerr << "No directory for the solution cache, set $SYMSOLBIN_SOLVER_CACHE or $HOME, the cache is disabled.\n";
+    return std::string();
+}
+
+std::string solution_key(const equation_set_t &equations,
+                         const system_t &system,
+                         const solved_systyem_t &solution,
+                         const GiNaC::exmap &replacement,
+                         const solver_options_t &options)
+{
+    std::map<std::string, std::string> renamed;
+    for (std::size_t i = 0; i < solution.values.size(); ++i)
+        renamed[solution.values[i].get_name()] = __placeholder(i);
+    auto canonical = [&renamed](const GiNaC::ex &e) {
+        return __canonical(e, renamed);
+    };
+    std::vector<std::string> items;
+    hash_t hash;
+    hash.update(SOLUTION_CACHE_VERSION);
+    // Only the options which change the solution, the algorithm used by
+    // GiNaC changes only the time it takes.
+    hash.update(std::to_string(static_cast<int>(options.method)) + (options.blt ? "blt" : ""));
+    for (const auto *group : { &equations, &solution.support }) {
+        items.clear();
+        for (const auto &equation : *group)
+            items.emplace_back(canonical(equation));
+        __update(hash, items);
+    }
+    for (const auto *group : { &system.unknowns, &system.outputs }) {
+        items.clear();
+        for (const auto &symbol : *group)
+            items.emplace_back(canonical(symbol));
+        __update(hash, items);
+    }
+    for (const auto *group : { &system.values, &system.inputs }) {
+        items.clear();
+        for (const auto &value : *group)
+            items.emplace_back(value.get_name());
+        __update(hash, items);
+    }
+    items.clear();
+    for (const auto &it : replacement)
+        items.emplace_back(canonical(it.first) + "->" + canonical(it.second));
+    __update(hash, items);
+    return hash.str();
+}
+
+bool load_solution(const std::string &directory,
+                   const std::string &key,
+                   const equation_set_t &equations,
+                   const system_t &system,
+                   solved_systyem_t &solution)
+{
+    std::ifstream in(directory + "/" + key + ".gar", std::ios::binary);
+    if (!in)
+        return false;
+    // The symbols of the system keep their names, the support values are
+    // stored with the name of their position.
+    GiNaC::exset used;
+    for (const auto &equation : equations)
+        __collect_symbols(equation, used);
+    for (const auto &unknown : system.unknowns)
+        used.insert(unknown);
+    GiNaC::exmap restore;
+    for (std::size_t i = 0; i < solution.values.size(); ++i) {
+        used.erase(solution.values[i].get_symbol());
+        restore[GiNaC::symbol(__placeholder(i))] = solution.values[i].get_symbol();
+    }
+    GiNaC::lst symbols;
+    for (const auto &symbol : used)
+        symbols.append(symbol);
+    for (const auto &it : restore)
+        symbols.append(it.first);
+    GiNaC::archive archive;
+    GiNaC::ex elimination, solved, blocks;
+    // GiNaC reports a damaged archive with an exception.
+    try {
+        in >> archive;
+        elimination = archive.unarchive_ex(symbols, "elimination");
+        solved      = archive.unarchive_ex(symbols, "equations");
+        blocks      = archive.unarchive_ex(symbols, "blocks");
+    } catch (const std::exception &e) {
+        std::cerr << "Failed to load the cached solution " << key << ": " << e.what() << "\n";
+        return false;
+    }
+    // The intermediate values get new names, which may have been taken by
+    // the time the solution is loaded.
+    for (const auto &equation : elimination)
+        restore[equation.lhs()] = ginac_helper::get_symbol(name_gen::get_name("elim"));
+    solution.elimination.clear();
+    solution.equations.clear();
+    solution.blocks.clear();
+    solution.choices.clear();
+    for (const auto &equation : elimination)
+        solution.elimination.emplace_back(GiNaC::ex_to<GiNaC::relational>(equation.subs(restore)));
+    for (const auto &equation : solved)
+        solution.equations.emplace_back(GiNaC::ex_to<GiNaC::relational>(equation.subs(restore)));
+    for (const auto &count : blocks)
+        solution.blocks.emplace_back(static_cast<std::size_t>(GiNaC::ex_to<GiNaC::numeric>(count).to_long()));
+    return true;
+}
+
+bool store_solution(const std::string &directory, const std::string &key, const solved_systyem_t &solution)
+{
+    if (!__make_directories(directory)) {
+        std::cerr << "Failed to create the cache directory " << directory << "\n";
+        return false;
+    }
+    GiNaC::exmap placeholders;
+    for (std::size_t i = 0; i < solution.values.size(); ++i)
+        placeholders[solution.values[i].get_symbol()] = GiNaC::symbol(__placeholder(i));
+    GiNaC::lst elimination, equations, blocks;
+    for (const auto &equation : solution.elimination)
+        elimination.append(GiNaC::ex(equation).subs(placeholders));
+    for (const auto &equation : solution.equations)
+        equations.append(GiNaC::ex(equation).subs(placeholders));
+    for (std::size_t count : solution.blocks)
+        blocks.append(GiNaC::numeric(static_cast<long>(count)));
+    GiNaC::archive archive;
+    archive.archive_ex(elimination, "elimination");
+    archive.archive_ex(equations, "equations");
+    archive.archive_ex(blocks, "blocks");
+    // Through a temporary file, so that concurrent processes never load a
+    // partial solution.
+    std::string path      = directory + "/" + key + ".gar";
+    std::string temporary = path + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream out(temporary, std::ios::binary);
+    out << archive;
+    out.close();
+    if (!out || (std::rename(temporary.c_str(), path.c_str()) != 0)) {
+        std::cerr << "Failed to write the cached solution " << path << "\n";
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool load_winner(const std::string &directory, const std::string &hash, unsigned &algorithm)
+{
+    std::ifstream in(directory + "/" + hash + ".winner");
+    std::string version;
+    if (!std::getline(in, version) || (version != SOLUTION_CACHE_VERSION))
+        return false;
+    return static_cast<bool>(in >> algorithm);
+}
+
+bool store_winner(const std::string &directory, const std::string &hash, unsigned algorithm)
+{
+    if (!__make_directories(directory)) {
+        std::cerr << "Failed to create the cache directory " << directory << "\n";
+        return false;
+    }
+    // Through a temporary file, as the solutions.
+    std::string path      = directory + "/" + hash + ".winner";
+    std::string temporary = path + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream out(temporary);
+    out << SOLUTION_CACHE_VERSION << "\n"
+        << algorithm << "\n";
+    out.close();
+    if (!out || (std::rename(temporary.c_str(), path.c_str()) != 0)) {
+        std::cerr << "Failed to write the race winner " << path << "\n";
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace symsolbin
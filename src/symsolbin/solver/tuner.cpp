@@ -0,0 +1,350 @@
+/// @file tuner.cpp
+/// @author Enrico Fraccaroli (enry.frak@gmail.com)
+/// @brief Chooses the algorithm used by GiNaC to solve a system, from its
+/// shape or by racing the algorithms against each other.
+
+#include "symsolbin/solver/tuner.hpp"
+#include "symsolbin/solver/hash.hpp"
+#include "symsolbin/solver/solution_cache.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace symsolbin
+{
+
+/// @brief The algorithms which take part in a race.
+static const unsigned __algorithms[] = {
+    GiNaC::solve_algo::gauss,
+    GiNaC::solve_algo::divfree,
+    GiNaC::solve_algo::bareiss,
+    GiNaC::solve_algo::markowitz,
+};
+
+/// @brief Collects the symbols inside an expression.
+static inline void __collect_symbols(const GiNaC::ex &e, GiNaC::exset &symbols)
+{
+    if (GiNaC::is_a<GiNaC::symbol>(e)) {
+        symbols.insert(e);
+        return;
+    }
+    for (std::size_t i = 0; i < e.nops(); ++i)
+        __collect_symbols(e.op(i), symbols);
+}
+
+/// @brief Returns the highest degree of a symbol inside a coefficient,
+/// either in its numerator or in its denominator.
+static inline int __degree(const GiNaC::ex &coefficient)
+{
+    GiNaC::exset symbols;
+    __collect_symbols(coefficient, symbols);
+    const GiNaC::ex fraction = coefficient.normal().numer_denom();
+    int degree               = 0;
+    for (const auto &symbol : symbols)
+        for (std::size_t i = 0; i < 2; ++i)
+            if (fraction.op(i).is_polynomial(symbol))
+                degree = std::max(degree, fraction.op(i).degree(symbol));
+    return degree;
+}
+
+/// @brief Calls the function on each non-zero coefficient of the system,
+/// with the indices of its equation and unknown.
+template <typename Function>
+static inline void __for_each_coefficient(const equation_set_t &equations,
+                                          const std::vector<GiNaC::symbol> &unknowns,
+                                          Function function)
+{
+    for (std::size_t r = 0; r < equations.size(); ++r) {
+        const GiNaC::ex e = (equations[r].lhs() - equations[r].rhs()).expand();
+        for (std::size_t c = 0; c < unknowns.size(); ++c) {
+            if (!e.has(unknowns[c]))
+                continue;
+            const GiNaC::ex coefficient = e.coeff(unknowns[c], 1);
+            if (!coefficient.is_zero())
+                function(r, c, coefficient);
+        }
+    }
+}
+
+/// @brief Hashes the structure of a system: the position of its non-zero
+/// coefficients, their value when they are numbers, and their degree when
+/// they are not. Systems which differ only by the names of their symbols
+/// have the same hash.
+static inline std::string __structural_hash(const equation_set_t &equations, const std::vector<GiNaC::symbol> &unknowns)
+{
+    hash_t hash;
+    hash.update(std::to_string(equations.size()) + "x" + std::to_string(unknowns.size()));
+    __for_each_coefficient(equations, unknowns, [&hash](std::size_t r, std::size_t c, const GiNaC::ex &coefficient) {
+        std::stringstream ss;
+        ss << r << "," << c << ":";
+        if (GiNaC::is_a<GiNaC::numeric>(coefficient))
+            ss << coefficient;
+        else
+            ss << "d" << __degree(coefficient);
+        hash.update(ss.str());
+    });
+    return hash.str();
+}
+
+/// @brief Writes all the data to a file descriptor.
+static inline bool __write_all(int fd, const std::string &data)
+{
+    for (std::size_t written = 0; written < data.size();) {
+        ssize_t count = write(fd, data.data() + written, data.size() - written);
+        if ((count < 0) && (errno != EINTR))
+            return false;
+        if (count > 0)
+            written += static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+/// @brief Reads from a file descriptor until its end, waiting for the data
+/// without polling.
+/// @return false if the deadline passed before the end.
+static inline bool __read_until(int fd, std::chrono::steady_clock::time_point deadline, std::string &data)
+{
+    char buffer[4096];
+    for (;;) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining < 0)
+            return false;
+        struct pollfd descriptor = { fd, POLLIN, 0 };
+        int ready                = poll(&descriptor, 1, static_cast<int>(std::min<long long>(remaining + 1, INT_MAX)));
+        if ((ready < 0) && (errno != EINTR))
+            return false;
+        if (ready <= 0)
+            continue;
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if ((count < 0) && (errno == EINTR))
+            continue;
+        if (count <= 0)
+            return true;
+        data.append(buffer, static_cast<std::size_t>(count));
+    }
+}
+
+/// @brief Solves the system with one algorithm inside a forked process,
+/// which measures its own time and sends back the solution.
+/// @param system the equations.
+/// @param unknowns the unknowns.
+/// @param symbols all the symbols of the system, shared with the solution.
+/// @param algorithm the algorithm.
+/// @param budget the seconds the algorithm can run.
+/// @param solution the solution.
+/// @return the seconds taken by the algorithm, negative if it failed or ran
+/// out of time.
+static inline double __run(const GiNaC::lst &system,
+                           const GiNaC::lst &unknowns,
+                           const GiNaC::lst &symbols,
+                           unsigned algorithm,
+                           double budget,
+                           equation_set_t &solution)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cerr << "Failed to start the race of " << algorithm_name(algorithm) << ".\n";
+        return -1.0;
+    }
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget));
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        GiNaC::archive archive;
+        // GiNaC reports the singular systems with an exception.
+        try {
+            auto start                            = std::chrono::steady_clock::now();
+            GiNaC::ex result                      = GiNaC::lsolve(system, unknowns, algorithm);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            archive.archive_ex(result, "solution");
+            archive.archive_ex(GiNaC::numeric(elapsed.count()), "seconds");
+        } catch (...) {
+            _exit(1);
+        }
+        std::stringstream ss;
+        ss << archive;
+        bool success = __write_all(fds[1], ss.str());
+        close(fds[1]);
+        _exit(success ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        std::cerr << "Failed to start the race of " << algorithm_name(algorithm) << ".\n";
+        return -1.0;
+    }
+    std::string data;
+    bool finished = __read_until(fds[0], deadline, data);
+    close(fds[0]);
+    if (!finished)
+        kill(pid, SIGKILL);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!finished || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+        return -1.0;
+    GiNaC::archive archive;
+    std::stringstream ss(data);
+    ss >> archive;
+    if (!ss)
+        return -1.0;
+    GiNaC::ex result = archive.unarchive_ex(symbols, "solution");
+    if (result.nops() != unknowns.nops())
+        return -1.0;
+    solution = ginac_helper::split_solved(result);
+    return GiNaC::ex_to<GiNaC::numeric>(archive.unarchive_ex(symbols, "seconds")).to_double();
+}
+
+/// @brief Solves the system with every algorithm, one after the other, each
+/// one inside its own process. An algorithm is stopped once it is slower
+/// than the fastest one so far, so the race takes at most the budget plus
+/// the time of the winner for each other algorithm.
+/// @param equations the equations.
+/// @param unknowns the unknowns.
+/// @param first the algorithm which runs first, i.e., the predicted one.
+/// @param budget the seconds each algorithm can run.
+/// @param solution the solution found by the fastest algorithm.
+/// @return the seconds taken by each algorithm, negative if it failed, ran
+/// out of time, or was slower than the fastest one.
+static inline std::vector<std::pair<unsigned, double>> __race(const equation_set_t &equations,
+                                                              const std::vector<GiNaC::symbol> &unknowns,
+                                                              unsigned first,
+                                                              double budget,
+                                                              equation_set_t &solution)
+{
+    GiNaC::lst system, targets, symbols;
+    GiNaC::exset used;
+    for (const auto &equation : equations) {
+        system.append(equation);
+        __collect_symbols(equation, used);
+    }
+    for (const auto &unknown : unknowns) {
+        targets.append(unknown);
+        used.insert(unknown);
+    }
+    for (const auto &symbol : used)
+        symbols.append(symbol);
+    // Otherwise, the buffered output would be written by every child too.
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+
+    std::vector<unsigned> order(1, first);
+    for (unsigned algorithm : __algorithms)
+        if (algorithm != first)
+            order.emplace_back(algorithm);
+    std::vector<std::pair<unsigned, double>> timings;
+    double best = -1.0;
+    for (unsigned algorithm : order) {
+        equation_set_t result;
+        double seconds = __run(system, targets, symbols, algorithm, (best < 0) ? budget : std::min(budget, best), result);
+        if ((seconds >= 0) && ((best < 0) || (seconds < best))) {
+            best     = seconds;
+            solution = result;
+        } else {
+            seconds = -1.0;
+        }
+        timings.emplace_back(algorithm, seconds);
+    }
+    return timings;
+}
+
+const char *algorithm_name(unsigned algorithm)
+{
+    switch (algorithm) {
+    case GiNaC::solve_algo::automatic: return "automatic";
+    case GiNaC::solve_algo::gauss: return "gauss";
+    case GiNaC::solve_algo::divfree: return "divfree";
+    case GiNaC::solve_algo::bareiss: return "bareiss";
+    case GiNaC::solve_algo::markowitz: return "markowitz";
+    default: return "unknown";
+    }
+}
+
+system_shape_t measure_shape(const equation_set_t &equations, const std::vector<GiNaC::symbol> &unknowns)
+{
+    system_shape_t shape;
+    shape.size = unknowns.size();
+    __for_each_coefficient(equations, unknowns, [&shape](std::size_t, std::size_t, const GiNaC::ex &coefficient) {
+        ++shape.nonzeros;
+        if (!GiNaC::is_a<GiNaC::numeric>(coefficient)) {
+            ++shape.symbolic;
+            shape.degree = std::max(shape.degree, __degree(coefficient));
+        }
+    });
+    return shape;
+}
+
+unsigned predict_algorithm(const system_shape_t &shape)
+{
+    if (shape.symbolic == 0)
+        return GiNaC::solve_algo::gauss;
+    if ((shape.size > 4) && (shape.density() <= 0.3))
+        return GiNaC::solve_algo::markowitz;
+    if (shape.degree > 1)
+        return GiNaC::solve_algo::bareiss;
+    return GiNaC::solve_algo::divfree;
+}
+
+solver_choice_t tune_algorithm(const equation_set_t &equations,
+                               const std::vector<GiNaC::symbol> &unknowns,
+                               solver_tuning_t tuning,
+                               unsigned fallback,
+                               double budget,
+                               const std::string &directory)
+{
+    // The winners of the previous races of this process, by structural hash.
+    static std::map<std::string, unsigned> winners;
+
+    solver_choice_t choice;
+    choice.algorithm = fallback;
+    if (tuning == solver_tuning_t::none)
+        return choice;
+    choice.shape     = measure_shape(equations, unknowns);
+    choice.algorithm = predict_algorithm(choice.shape);
+    if (tuning == solver_tuning_t::predict)
+        return choice;
+    const std::string hash = __structural_hash(equations, unknowns);
+    auto it                = winners.find(hash);
+    unsigned winner        = 0;
+    if (it != winners.end()) {
+        choice.algorithm  = it->second;
+        choice.remembered = true;
+        return choice;
+    }
+    if (!directory.empty() && load_winner(directory, hash, winner)) {
+        winners[hash]     = winner;
+        choice.algorithm  = winner;
+        choice.remembered = true;
+        return choice;
+    }
+    choice.timings = __race(equations, unknowns, choice.algorithm, budget, choice.solution);
+    double best    = -1.0;
+    for (const auto &timing : choice.timings) {
+        if ((timing.second >= 0) && ((best < 0) || (timing.second < best))) {
+            best             = timing.second;
+            choice.algorithm = timing.first;
+        }
+    }
+    if (best < 0) {
+        std::cerr << "No algorithm solved the system within " << budget << " s, using " << algorithm_name(choice.algorithm) << ".\n";
+    } else {
+        winners[hash] = choice.algorithm;
+        if (!directory.empty())
+            store_winner(directory, hash, choice.algorithm);
+    }
+    return choice;
+}
+
+} // namespace symsolbin
@@ -13,7 +13,9 @@ namespace symsolbin
 value_t::value_t(std::string name, double value, bool replace)
     : _symbol(GiNaC::symbol(ginac_helper::get_symbol(name))),
       _value(value),
-      _replace(replace)
+      _replace(replace),
+      _min(),
+      _max()
 {
     // Nothing to do.
 }